@@ -7,70 +7,59 @@
  */
 
 #include "attiny13_hal.h"
-#include <util/delay.h>
 
-volatile uint16_t attiny13_ir_counter = 0U;
-volatile uint16_t attiny13_ir_timeout = 0U;
+volatile uint8_t attiny13_ir_overflows = 0U;
+uint8_t attiny13_carrier_top = ATTINY13_CARRIER_TOP_DEFAULT;
 
 void attiny13_timer_start(void)
 {
-    // Configure Timer0 for 38.222kHz
-    TCCR0A |= _BV(WGM01);       // set timer counter mode to CTC
-    TCCR0B |= _BV(CS00);        // set prescaler to 1
-    TIMSK0 |= _BV(OCIE0A);      // enable Timer COMPA interrupt
-    OCR0A = IR_OCR0A;           // set OCR0n to get ~38.222kHz timer frequency
+    IR_hal_timer_start();
 }
 
 void attiny13_timer_stop(void)
 {
-    TCCR0B &= ~_BV(CS00);       // stop timer
-    TIMSK0 &= ~_BV(OCIE0A);     // disable Timer COMPA interrupt
+    IR_hal_timer_stop();
 }
 
 uint16_t attiny13_timer_get_count(void)
 {
-    return attiny13_ir_counter;
+    return IR_hal_timer_get_count();
 }
 
 void attiny13_timer_reset_count(void)
 {
-    attiny13_ir_counter = 0;
+    IR_hal_timer_reset_count();
 }
 
 uint8_t attiny13_pin_read(void)
 {
-    // Read IR_IN_PIN digital value (logical inverse due to sensor used)
-    return ((PINB & (1 << IR_IN_PIN)) > 0) ? IR_LOW : IR_HIGH;
+    return IR_hal_pin_read();
 }
 
 // Transmitter HAL Functions
 void attiny13_carrier_on(void)
 {
-    // Configure Timer0 for 38kHz PWM on OC0A (PB0)
-    DDRB |= _BV(IR_OUT_PIN);        // Set IR output pin as OUTPUT
-    TCCR0A |= _BV(COM0A0) | _BV(WGM01);  // Toggle OC0A on compare match, CTC mode
-    TCCR0B |= _BV(CS00);            // No prescaler
-    OCR0A = 125;                    // 9.6MHz / (2 * 126) = ~38kHz
+    IR_hal_carrier_on();
 }
 
 void attiny13_carrier_off(void)
 {
-    TCCR0A &= ~_BV(COM0A0);         // Disconnect OC0A
-    PORTB &= ~_BV(IR_OUT_PIN);      // Set IR output pin LOW
+    IR_hal_carrier_off();
+}
+
+void attiny13_set_carrier(uint32_t hz)
+{
+    IR_hal_set_carrier(hz);
 }
 
 void attiny13_delay_us(uint16_t us)
 {
-    while(us--) {
-        _delay_us(1);
-    }
+    IR_hal_delay_us(us);
 }
 
 void attiny13_delay_ms(uint16_t ms)
 {
-    while(ms--) {
-        _delay_ms(1);
-    }
+    IR_hal_delay_ms(ms);
 }
 
 void attiny13_hal_init(IR_HAL_t* hal)
@@ -84,7 +73,7 @@ void attiny13_hal_init(IR_HAL_t* hal)
     MCUCR &= ~_BV(ISC01);       // trigger INT0 interrupt on raising and falling edge
     MCUCR |= _BV(ISC00);
     
-    // Initialize HAL function pointers
+    // Initialize HAL function pointers (unused when IR_HAL_STATIC is 1)
     hal->timer_start = attiny13_timer_start;
     hal->timer_stop = attiny13_timer_stop;
     hal->timer_get_count = attiny13_timer_get_count;
@@ -105,20 +94,82 @@ void attiny13_tx_hal_init(IR_TX_HAL_t* tx_hal)
     tx_hal->carrier_off = attiny13_carrier_off;
     tx_hal->delay_us = attiny13_delay_us;
     tx_hal->delay_ms = attiny13_delay_ms;
+    tx_hal->set_carrier = attiny13_set_carrier;
+}
+
+static void attiny13_eeprom_read(uint16_t address, uint8_t* data, uint16_t length)
+{
+    eeprom_read_block(data, (const void*)address, length);
+}
+
+static void attiny13_eeprom_program(uint16_t address, uint8_t value)
+{
+    // Only called once the previous write is done, so this starts the
+    // erase+write and returns without waiting
+    eeprom_write_byte((uint8_t*)address, value);
+}
+
+static uint8_t attiny13_eeprom_busy(void)
+{
+    return !eeprom_is_ready();
+}
+
+void attiny13_store_hal_init(IR_Store_HAL_t* store_hal)
+{
+    // Cells are rewritten in place, so no page erase
+    store_hal->read = attiny13_eeprom_read;
+    store_hal->program = attiny13_eeprom_program;
+    store_hal->erase = 0;
+    store_hal->busy = attiny13_eeprom_busy;
+    store_hal->page_size = ATTINY13_STORE_PAGE_SIZE;
+    store_hal->page_count = ATTINY13_STORE_PAGE_COUNT;
+    store_hal->erase_deferred = 0;
+}
+
+void attiny13_power_down(void)
+{
+    // Edge already latched since the caller checked the decoder: handle it awake
+    if(GIFR & (_BV(INTF0) | _BV(PCIF)))
+    {
+        sei();
+        return;
+    }
+    
+    // Pin change detection is asynchronous and survives power-down; the
+    // core is running again 6 clocks after the leader edge
+    PCMSK |= _BV(IR_IN_PIN);
+    GIMSK |= _BV(PCIE);
+    
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    sleep_enable();
+    sei();                      // sleep executes before any pending interrupt
+    sleep_cpu();
+    sleep_disable();
+}
+
+void attiny13_sleep_idle(void)
+{
+    // Frame in progress: Timer0 and INT0 keep running, only the CPU stops
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
 }
 
 void attiny13_ir_pin_interrupt(void)
 {
-    // This function should be called from the actual ISR in main.c
-    // The pin reading is handled by the HAL pin_read function
+    // The wake edge may latch both INT0 (sampled as the clock restarts) and
+    // the pin change flag: whichever vector runs first takes the edge and
+    // disarms the other. INT0 alone times the rest of the frame
+    GIMSK &= ~_BV(PCIE);
+    GIFR = _BV(INTF0) | _BV(PCIF);
 }
 
 void attiny13_timer_interrupt(void)
 {
-    // Timer interrupt handler for 38.222kHz carrier frequency
-    if(attiny13_ir_counter++ > 10000)
-        attiny13_ir_counter = 0;  // Prevent overflow
-        
-    if(attiny13_ir_timeout && --attiny13_ir_timeout == 0)
-        attiny13_ir_timeout = 0;  // Timeout expired
+    // Timer0 overflow (every 1.71ms): extend TCNT0, saturating so a long
+    // idle gap reads as the longest interval rather than wrapping
+    if(attiny13_ir_overflows < 0xFFU)
+        attiny13_ir_overflows++;
 }
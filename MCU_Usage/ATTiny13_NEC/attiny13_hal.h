@@ -11,17 +11,13 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/eeprom.h>
 #include <stdint.h>
 #include "ir_decoder.h"
-
-// Hardware Configuration
-#define IR_IN_PIN       PB1
-#define IR_OCR0A        (122)
-#define IR_OUT_PIN      PB0     // IR LED output pin
-
-// Global variables for ATTiny13 HAL
-extern volatile uint16_t attiny13_ir_counter;
-extern volatile uint16_t attiny13_ir_timeout;
+#include "ir_transmitter.h"
+#include "ir_store.h"
+#include "attiny13_hal_static.h"   // Hardware configuration and IR_hal_*() bodies
 
 // HAL Function Declarations
 void attiny13_timer_start(void);
@@ -35,6 +31,7 @@ void attiny13_carrier_on(void);
 void attiny13_carrier_off(void);
 void attiny13_delay_us(uint16_t us);
 void attiny13_delay_ms(uint16_t ms);
+void attiny13_set_carrier(uint32_t hz);
 
 // HAL Initialization
 void attiny13_hal_init(IR_HAL_t* hal);
@@ -42,7 +39,26 @@ void attiny13_hal_init(IR_HAL_t* hal);
 // Transmitter HAL Initialization
 void attiny13_tx_hal_init(IR_TX_HAL_t* tx_hal);
 
-// Interrupt handlers (to be called from main application)
+// Learned-code store in EEPROM: one record per page, 7 pages = 63 of the 64
+// bytes, so up to 5 slots (IR_STORE_SLOTS). Every cell is rewritten once
+// per 7 records stored. A byte program takes 3.4ms; IR_store_service()
+// starts one and returns
+#define ATTINY13_STORE_PAGE_SIZE    (IR_STORE_RECORD_SIZE)
+#define ATTINY13_STORE_PAGE_COUNT   ((E2END + 1U) / ATTINY13_STORE_PAGE_SIZE)
+
+// Store HAL Initialization
+void attiny13_store_hal_init(IR_Store_HAL_t* store_hal);
+
+// Low-power receive: call with interrupts disabled, return with them enabled.
+// Power-down stops Timer0 and the INT0 edge detector, so the receiver pin
+// change interrupt wakes the core on the leader edge; PCINT0_vect must run
+// the same handler as INT0_vect (ISR_ALIASOF)
+void attiny13_power_down(void);
+void attiny13_sleep_idle(void);
+
+// Interrupt handlers (to be called from main application; attiny13_ir_pin_interrupt
+// from INT0_vect/PCINT0_vect before the decoder, attiny13_timer_interrupt from
+// TIM0_OVF_vect, followed by IR_decoder_timeout_advance(..., ATTINY13_OVERFLOW_IR_TICKS))
 void attiny13_ir_pin_interrupt(void);
 void attiny13_timer_interrupt(void);
 
@@ -0,0 +1,132 @@
+/**
+ * attiny13_hal_static.h - Compile-time HAL Binding for ATTiny13
+ * 
+ * static inline IR_hal_*() functions for IR_HAL_STATIC builds, inlined
+ * straight into ir_decoder.c and ir_transmitter.c. The attiny13_*()
+ * functions in attiny13_hal.c wrap the same code for the runtime HAL.
+ * Build with: -DIR_HAL_STATIC=1 -DIR_HAL_STATIC_HEADER='"attiny13_hal_static.h"'
+ * Author: Nghia Taarabt
+ */
+
+#ifndef ATTINY13_HAL_STATIC_H_
+#define ATTINY13_HAL_STATIC_H_
+
+#include <avr/io.h>
+#include <util/delay.h>
+#include <stdint.h>
+#include "ir_common.h"
+
+// Hardware Configuration
+#define IR_IN_PIN       PB1
+#define IR_OUT_PIN      PB0     // IR LED output pin
+
+// Edge timing: Timer0 in normal mode at clk/64 (6.67us per count) with the
+// overflow interrupt (every 1.71ms) extending TCNT0 to 16 bits, instead of a
+// CTC interrupt per 12.8us decoder tick
+#define ATTINY13_TIMER_CS           (_BV(CS01) | _BV(CS00))
+
+// Decoder ticks (123 CPU cycles) per Timer0 overflow: 256 * 64 / 123.
+// Pass to IR_decoder_timeout_advance() from the overflow interrupt
+#define ATTINY13_OVERFLOW_IR_TICKS  (133U)
+
+// Timer0 counts (64 cycles) to decoder ticks: x * 64/123 ~= x * 133/256,
+// as shifts since the ATTiny13 has no multiplier
+#define ATTINY13_COUNTS_TO_IR_TICKS(x)  (uint16_t)(((x) >> 1) + ((x) >> 6) + ((x) >> 8))
+
+// Carrier compare value for 38kHz: 9.6MHz / (2 * 126)
+#define ATTINY13_CARRIER_TOP_DEFAULT    (125U)
+
+extern volatile uint8_t attiny13_ir_overflows;
+extern uint8_t attiny13_carrier_top;        // OCR0A of the carrier, 0 = unmodulated
+
+// Decoder HAL
+static inline void IR_hal_timer_start(void)
+{
+    TCCR0A = 0;                             // normal mode
+    TCCR0B = ATTINY13_TIMER_CS;             // clk/64
+    TIMSK0 |= _BV(TOIE0);                   // enable Timer0 overflow interrupt
+}
+
+static inline void IR_hal_timer_stop(void)
+{
+    TCCR0B &= ~(_BV(CS02) | _BV(CS01) | _BV(CS00));     // stop timer
+    TIMSK0 &= ~_BV(TOIE0);                  // disable Timer0 overflow interrupt
+}
+
+static inline uint16_t IR_hal_timer_get_count(void)
+{
+    uint8_t low = TCNT0;
+    uint8_t high = attiny13_ir_overflows;
+    
+    // Called from INT0: an overflow may be pending with its interrupt not yet run
+    if((TIFR0 & _BV(TOV0)) && low < 0x80U && high < 0xFFU)
+        high++;
+    
+    uint16_t counts = ((uint16_t)high << 8) | low;
+    return ATTINY13_COUNTS_TO_IR_TICKS(counts);
+}
+
+static inline void IR_hal_timer_reset_count(void)
+{
+    TCNT0 = 0;
+    TIFR0 = _BV(TOV0);                      // drop a pending overflow
+    attiny13_ir_overflows = 0;
+}
+
+static inline uint8_t IR_hal_pin_read(void)
+{
+    // Read IR_IN_PIN digital value (logical inverse due to sensor used)
+    return (PINB & _BV(IR_IN_PIN)) ? IR_LOW : IR_HIGH;
+}
+
+// Transmitter HAL
+static inline void IR_hal_carrier_on(void)
+{
+    DDRB |= _BV(IR_OUT_PIN);        // Set IR output pin as OUTPUT
+    if(attiny13_carrier_top == 0U)
+    {
+        PORTB |= _BV(IR_OUT_PIN);   // Unmodulated: steady output
+        return;
+    }
+    
+    // Configure Timer0 for carrier PWM on OC0A (PB0)
+    TCCR0A = _BV(COM0A0) | _BV(WGM01);  // Toggle OC0A on compare match, CTC mode
+    TCCR0B = _BV(CS00);             // No prescaler
+    OCR0A = attiny13_carrier_top;   // 9.6MHz / (2 * (OCR0A + 1)), ~38kHz by default
+}
+
+static inline void IR_hal_carrier_off(void)
+{
+    TCCR0A = 0;                     // Disconnect OC0A, back to normal mode
+    TCCR0B = ATTINY13_TIMER_CS;     // Receive time base (clk/64)
+    PORTB &= ~_BV(IR_OUT_PIN);      // Set IR output pin LOW
+}
+
+static inline void IR_hal_set_carrier(uint32_t hz)
+{
+    // OCR0A = F_CPU / (2 * hz) - 1 with hz / 128 in 16 bits: under 1% error
+    // and no 32-bit division. Clamped to 18.8kHz..2.4MHz
+    uint16_t divisor = (hz > 0xFFFFFFUL) ? 0xFFFFU : (uint16_t)(hz >> 7);
+    uint16_t half_period = (divisor > (uint16_t)(F_CPU / 65536U)) ? (uint16_t)(F_CPU / 256U) / divisor : 256U;
+    
+    if(hz == 0U)
+        attiny13_carrier_top = 0U;
+    else
+        attiny13_carrier_top = (half_period > 2U) ? (uint8_t)(half_period - 1U) : 1U;
+}
+
+static inline void IR_hal_delay_us(uint16_t us)
+{
+    while(us--) {
+        _delay_us(1);
+    }
+}
+
+static inline void IR_hal_delay_ms(uint16_t ms)
+{
+    while(ms--) {
+        _delay_ms(1);
+    }
+}
+
+#endif /* ATTINY13_HAL_STATIC_H_ */
@@ -10,11 +10,14 @@
 
 // Hardware Configuration
 #define IR_IN_PIN       PB1
-#define IR_OCR0A        (122)
+
+// Timer0 counts (clk/64) to 12.8us NEC counter units: x * 64/123 ~= x * 133/256
+#define IR_COUNTS_TO_TICKS(x)   (uint16_t)(((x) >> 1) + ((x) >> 6) + ((x) >> 8))
+#define IR_OVERFLOW_TICKS       (133U)  // Counter units per Timer0 overflow
 
 // Global Variables
 volatile uint16_t IR_timeout = 0U;
-volatile uint16_t IR_Counter = 0U;
+volatile uint8_t IR_Overflows = 0U;
 volatile uint32_t IR_rawdata = 0U;
 
 // Static Variables
@@ -29,11 +32,11 @@ void IR_init(void)
     DDRB &= ~_BV(IR_IN_PIN);    // set IR IN pin as INPUT
     PORTB &= ~_BV(IR_IN_PIN);   // set LOW level to IR IN pin
     
-    // Configure Timer0 for 38.222kHz
-    TCCR0A |= _BV(WGM01);       // set timer counter mode to CTC
-    TCCR0B |= _BV(CS00);        // set prescaler to 1
-    TIMSK0 |= _BV(OCIE0A);      // enable Timer COMPA interrupt
-    OCR0A = IR_OCR0A;           // set OCR0n to get ~38.222kHz timer frequency
+    // Configure Timer0 in normal mode at clk/64; edges read TCNT0 and the
+    // overflow count instead of a 38kHz tick interrupt
+    TCCR0A = 0;                 // normal mode
+    TCCR0B = _BV(CS01) | _BV(CS00); // set prescaler to 64
+    TIMSK0 |= _BV(TOIE0);       // enable Timer0 overflow interrupt
     
     // Configure External Interrupt INT0
     GIMSK |= _BV(INT0);         // enable INT0 interrupt handler
@@ -80,16 +83,13 @@ int8_t IR_NEC_process(uint16_t counter, uint8_t value)
             /* expecting a final 562.5µs pulse burst to signify the end of message transmission */
             if(value == LOW)
             {
+                /* copying data to volatile variable; raw data is ready */
+                IR_rawdata = IR_data;
                 IR_proto_event = IR_PROTO_EVENT_FINISH;
                 retval = IR_SUCCESS;
             }
             break;
             
-        case IR_PROTO_EVENT_FINISH:
-            /* copying data to volatile variable; raw data is ready */
-            IR_rawdata = IR_data;
-            break;
-            
         default:
             break;
     }
@@ -99,9 +99,15 @@ int8_t IR_NEC_process(uint16_t counter, uint8_t value)
 
 void IR_process(uint8_t pinIRValue)
 {
-    /* load IR counter value to local variable, then reset counter */
-    uint16_t counter = IR_Counter;
-    IR_Counter = 0;
+    /* measure time since the previous edge from TCNT0 + overflows, then restart it */
+    uint8_t low = TCNT0;
+    uint8_t high = IR_Overflows;
+    if((TIFR0 & _BV(TOV0)) && low < 0x80U && high < 0xFFU)
+        high++;                 /* overflow pending behind this interrupt */
+    uint16_t counter = IR_COUNTS_TO_TICKS(((uint16_t)high << 8) | low);
+    TCNT0 = 0;
+    TIFR0 = _BV(TOV0);
+    IR_Overflows = 0;
 
     switch(IR_State)
     {
@@ -147,6 +153,12 @@ void IR_process(uint8_t pinIRValue)
             {
                 IR_State = IR_STATE_FINISH;
             }
+            else if(IR_proto_event == IR_PROTO_EVENT_FINISH)
+            {
+                /* frame complete: next edge is the leader of the next frame */
+                IR_State = IR_STATE_IDLE;
+                IR_timeout = 0U;
+            }
             break;
             
         case IR_STATE_FINISH:
@@ -181,13 +193,23 @@ ISR(INT0_vect)
     IR_process(pinIRValue);
 }
 
-ISR(TIM0_COMPA_vect)
+ISR(TIM0_OVF_vect)
 {
-    /* When transmitting or receiving remote control codes using the NEC IR transmission protocol,
-    the communications performs optimally when the carrier frequency (used for modulation/demodulation)
-    is set to 38.222kHz. */
-    if(IR_Counter++ > 10000)
-        IR_State = IR_STATE_IDLE;
-    if(IR_timeout && --IR_timeout == 0)
+    /* Timer0 overflow every 1.71ms (256 counts at clk/64), saturating */
+    if(IR_Overflows < 0xFFU)
+        IR_Overflows++;
+    if(IR_Overflows > 10000U / IR_OVERFLOW_TICKS)
         IR_State = IR_STATE_IDLE;
+    if(IR_timeout)
+    {
+        if(IR_timeout <= IR_OVERFLOW_TICKS)
+        {
+            IR_timeout = 0U;
+            IR_State = IR_STATE_IDLE;
+        }
+        else
+        {
+            IR_timeout -= IR_OVERFLOW_TICKS;
+        }
+    }
 }
@@ -25,7 +25,7 @@ typedef enum {
 #define IR_PROTO_EVENT_FINISH   (2)
 #define IR_PROTO_EVENT_HOOK     (3)
 
-// NEC Protocol Timing Constants (for 38.222kHz)
+// NEC Protocol Timing Constants (12.8us counter units)
 #define IR_NEC_START_BURST_MIN      (655U)
 #define IR_NEC_START_BURST_MAX      (815U)
 #define IR_NEC_START_SPACE_MIN      (330U)
@@ -50,7 +50,7 @@ typedef enum {
 
 // Global Variables (extern declarations)
 extern volatile uint16_t IR_timeout;
-extern volatile uint16_t IR_Counter;
+extern volatile uint8_t IR_Overflows;
 extern volatile uint32_t IR_rawdata;
 
 // Function Declarations
@@ -120,14 +120,18 @@ void process_ir_command(uint8_t address, uint8_t command)
 
 ISR(INT0_vect)
 {
+    attiny13_ir_pin_interrupt();
     uint8_t pin_value = attiny13_pin_read();
     IR_decoder_process(&ir_decoder, pin_value);
 }
 
-ISR(TIM0_COMPA_vect)
+// Wakes the core from power-down on the leader edge
+ISR(PCINT0_vect, ISR_ALIASOF(INT0_vect));
+
+ISR(TIM0_OVF_vect)
 {
     attiny13_timer_interrupt();
-    IR_decoder_timeout_handler(&ir_decoder);
+    IR_decoder_timeout_advance(&ir_decoder, ATTINY13_OVERFLOW_IR_TICKS);
 }
 
 int main(void)
@@ -146,14 +150,22 @@ int main(void)
     while(1)
     {
         // Check for received IR data
-        if(IR_decoder_get_data(&ir_decoder, &ir_data) == IR_SUCCESS)
+        // Repeat codes of a held key would keep toggling the LEDs
+        if(IR_decoder_get_data(&ir_decoder, &ir_data) == IR_SUCCESS &&
+           !(ir_data.flags & IR_DATA_FLAG_REPEAT))
         {
             // Process the received command
             process_ir_command(ir_data.address, ir_data.command);
         }
         
-        // Small delay to prevent excessive polling
-        _delay_ms(1);
+        // Sleep until the next edge: power-down between frames (a frame
+        // timeout returns the decoder to idle), idle mode while one arrives
+        cli();
+        if(IR_decoder_is_idle(&ir_decoder))
+            attiny13_power_down();
+        else if(!ir_decoder.decoded_data.valid)
+            attiny13_sleep_idle();
+        sei();
     }
     
     return 0;
@@ -5,8 +5,11 @@
  * Supports multiple IR protocols: NEC, RC5, RC6, Sony SIRC, Samsung, LG
  * 
  * Hardware Setup:
- * - PA0: IR receiver data pin (with pull-up)
- * - PA2: UART2 TX for debug output (115200 baud)
+ * - PA0: IR receiver data pin (with pull-up), EXTI0 or TIM2_CH1 input capture
+ *        when built with STM32_IR_USE_CAPTURE=1
+ * - PA2: UART2 TX for debug output (115200 baud), text or IR_RECORD_SIZE-byte
+ *        binary records when built with STM32_IR_BINARY_OUTPUT=1, or an
+ *        ir_trace.h edge trace of everything received with STM32_IR_TRACE_OUTPUT=1
  * - PA3: UART2 RX (optional)
  * - Connect IR receiver VCC to 3.3V, GND to GND
  * 
@@ -15,21 +18,85 @@
 
 #include "stm32f4xx.h"
 #include "ir_decoder.h"
+#include "ir_profile.h"
 #include "stm32f401_hal.h"
+#include "stm32f401_capture.h"
+#include "stm32f401_uart.h"
+#include "stm32f401_trace.h"
+#include "ir_record.h"
 #include <stdio.h>
 #include <string.h>
 
 // Global variables
 IR_Decoder_t ir_decoder;
 IR_HAL_t ir_hal;
-volatile uint8_t ir_data_ready = 0;
-IR_Data_t received_data;
+
+// Receive backend: 0 = EXTI0 + timer read per edge, 1 = TIM2 input capture + DMA
+#ifndef STM32_IR_USE_CAPTURE
+#define STM32_IR_USE_CAPTURE    0
+#endif
+
+// Sleep between edges: STOP while no frame is in progress, EXTI0 wakes on the
+// leader edge. Needs the EXTI0 backend; the capture backend sleeps in WFI only
+#ifndef STM32_IR_LOW_POWER
+#define STM32_IR_LOW_POWER      0
+#endif
+
+// Output format: 0 = text per frame, 1 = ir_record.h binary records
+// (tools/ir_record_parse turns them back into text on the host)
+#ifndef STM32_IR_BINARY_OUTPUT
+#define STM32_IR_BINARY_OUTPUT  0
+#endif
+
+// Raw edge trace instead of decoded frames: every captured edge goes out as an
+// ir_trace.h record for replay on the host (tools/ir_trace). Needs the capture
+// backend, and nothing else is written to the UART
+#ifndef STM32_IR_TRACE_OUTPUT
+#define STM32_IR_TRACE_OUTPUT   0
+#endif
+
+#if STM32_IR_TRACE_OUTPUT && !STM32_IR_USE_CAPTURE
+#error "STM32_IR_TRACE_OUTPUT=1 records the TIM2 capture backend's edges: build with STM32_IR_USE_CAPTURE=1"
+#endif
+
+// Profiling commands over UART2 RX ('p' dump, 'r' reset). Not in trace mode:
+// the capture interrupt is then the UART ring's only writer, and a dump
+// would break the record stream
+#define STM32_IR_UART_COMMANDS  (IR_ENABLE_PROFILING && !STM32_IR_TRACE_OUTPUT)
+
+#if !IR_DECODER_ENABLE_CALLBACK
+#error "main_stm32.c receives frames through the decoder callback: build with IR_DECODER_ENABLE_CALLBACK=1"
+#endif
+#if !IR_DECODER_ENABLE_TIMESTAMPS
+#error "main_stm32.c reports frame timestamps: build with IR_DECODER_ENABLE_TIMESTAMPS=1"
+#endif
 
 // UART configuration for debug output
 #define UART_BAUDRATE   115200
 #define UART_TX_PIN     GPIO_PIN_2  // PA2
 #define UART_RX_PIN     GPIO_PIN_3  // PA3
 
+// Pipeline: decoder callback (edge ISR) -> frame queue -> formatting (main
+// loop) -> UART ring -> DMA1 Stream6. The queue size is a power of two and
+// its free-running indices are written by one side each
+#define FRAME_QUEUE_SIZE    8U
+#if STM32_IR_BINARY_OUTPUT
+#define FRAME_TEXT_MAX      IR_RECORD_SIZE
+#else
+#define FRAME_TEXT_MAX      160U        // Longest text print_ir_data() produces
+#endif
+
+#if !STM32_IR_TRACE_OUTPUT
+static IR_Data_t frame_queue[FRAME_QUEUE_SIZE];
+#endif
+static volatile uint8_t frame_head = 0;     // Written by the decoder callback
+static volatile uint8_t frame_tail = 0;     // Written by the main loop
+static volatile uint16_t frames_dropped = 0;
+
+#if STM32_IR_UART_COMMANDS
+static volatile char uart_rx_cmd = 0;
+#endif
+
 // Function prototypes
 void SystemClock_Config(void);
 void UART2_Init(void);
@@ -39,6 +106,9 @@ void GPIO_Init(void);
 void NVIC_Init(void);
 const char* get_protocol_name(IR_Protocol_t protocol);
 void print_ir_data(IR_Data_t* data);
+#if !STM32_IR_TRACE_OUTPUT
+static void on_ir_frame(IR_Decoder_t* decoder, const IR_Data_t* data);
+#endif
 
 int main(void)
 {
@@ -48,38 +118,115 @@ int main(void)
     UART2_Init();
     NVIC_Init();
     
+#if STM32_IR_TRACE_OUTPUT
+    // The UART carries only the trace: frames are decoded but not queued
+    IR_decoder_init(&ir_decoder, IR_PROTOCOL_NEC, &ir_hal);
+    stm32f401_trace_start();
+    stm32f401_capture_set_tap(stm32f401_trace_edge);
+    stm32f401_capture_init(&ir_decoder);
+#elif STM32_IR_USE_CAPTURE
+    // Edges are timed by hardware; the decoder needs no timer functions
+    IR_decoder_init(&ir_decoder, IR_PROTOCOL_NEC, &ir_hal);
+    IR_decoder_set_callback(&ir_decoder, on_ir_frame);
+    stm32f401_capture_init(&ir_decoder);
+#else
     // Initialize STM32F401 HAL for IR decoder
     stm32f401_hal_init(&ir_hal);
     stm32f401_hardware_init();
+#endif
     
+#if IR_ENABLE_PROFILING
+    stm32f401_profile_init();
+#endif
+    
+#if !STM32_IR_USE_CAPTURE
     // Initialize IR decoder with NEC protocol (can be changed)
     IR_decoder_init(&ir_decoder, IR_PROTOCOL_NEC, &ir_hal);
+    IR_decoder_set_callback(&ir_decoder, on_ir_frame);
+#endif
     
+#if !STM32_IR_TRACE_OUTPUT
     UART2_SendString("\r\n=== STM32F401 IR Decoder Demo ===\r\n");
     UART2_SendString("Waiting for IR signals...\r\n");
     UART2_SendString("Supported protocols: NEC, RC5, RC6, Sony SIRC, Samsung, LG\r\n\r\n");
+#endif
     
     while (1)
     {
-        // Check if IR data is ready
-        if (ir_data_ready)
+#if !STM32_IR_TRACE_OUTPUT
+        // Format stage: one queued frame per pass, and only once its whole
+        // text fits, so the loop never waits on the UART. The decoder keeps
+        // queueing frames from the edge interrupt meanwhile
+        if (frame_tail != frame_head && stm32f401_uart_tx_free() >= FRAME_TEXT_MAX)
         {
-            ir_data_ready = 0;
+            IR_Data_t frame = frame_queue[frame_tail & (FRAME_QUEUE_SIZE - 1U)];
+            __DMB();
+            frame_tail++;
             
-            // Get decoded data
-            if (IR_decoder_get_data(&ir_decoder, &received_data) == 0)
+            print_ir_data(&frame);
+        }
+#endif
+        
+#if STM32_IR_UART_COMMANDS
+        // Send 'p' to dump ISR cycle statistics, 'r' to clear them
+        if (uart_rx_cmd)
+        {
+            char cmd = uart_rx_cmd;
+            uart_rx_cmd = 0;
+            if (cmd == 'p')
             {
-                print_ir_data(&received_data);
+                IR_profile_dump(UART2_SendString);
+            }
+            else if (cmd == 'r')
+            {
+                IR_profile_reset();
             }
-            
-            // Reset decoder for next signal
-            IR_decoder_reset(&ir_decoder);
         }
+#endif
         
-        // Add small delay to prevent excessive polling
-        for (volatile uint32_t i = 0; i < 10000; i++);
+        // Wait for the next event: an edge, a queued frame or UART room.
+        // Masked so an interrupt between the checks and WFI still wakes the core
+        __disable_irq();
+        if (frame_tail == frame_head || stm32f401_uart_tx_free() < FRAME_TEXT_MAX)
+        {
+#if STM32_IR_LOW_POWER && !STM32_IR_USE_CAPTURE
+            // STOP gates the USART clock: only once the last character is out
+            if (frame_tail == frame_head && stm32f401_uart_tx_idle() &&
+                IR_decoder_is_idle(&ir_decoder))
+            {
+                stm32f401_stop_mode_enter();
+            }
+            else
+#endif
+            {
+                __WFI();
+            }
+        }
+        __enable_irq();
+    }
+}
+
+#if !STM32_IR_TRACE_OUTPUT
+/**
+ * Decoder completion callback (edge or capture interrupt context)
+ */
+static void on_ir_frame(IR_Decoder_t* decoder, const IR_Data_t* data)
+{
+    uint8_t head = frame_head;
+    
+    (void)decoder;                          // Only ir_decoder is registered
+    
+    if ((uint8_t)(head - frame_tail) >= FRAME_QUEUE_SIZE)
+    {
+        frames_dropped++;
+        return;
     }
+    
+    frame_queue[head & (FRAME_QUEUE_SIZE - 1U)] = *data;
+    __DMB();                                // Frame stored before it is published
+    frame_head = head + 1U;
 }
+#endif
 
 /**
  * System Clock Configuration
@@ -138,17 +285,15 @@ void GPIO_Init(void)
  */
 void UART2_Init(void)
 {
-    // Enable USART2 clock
-    RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
-    
-    // Configure UART: 115200 baud, 8N1
-    // Baud rate = fCK / (16 * USARTDIV)
-    // USARTDIV = 84000000 / (16 * 115200) = 45.57 ≈ 45.625
-    // Mantissa = 45, Fraction = 0.625 * 16 = 10
-    USART2->BRR = (45 << 4) | 10;
+    // 115200 baud 8N1, transmit through the DMA ring
+    stm32f401_uart_init(UART_BAUDRATE);
     
-    // Enable UART, transmitter and receiver
-    USART2->CR1 = USART_CR1_UE | USART_CR1_TE | USART_CR1_RE;
+#if STM32_IR_UART_COMMANDS
+    // Commands arrive by interrupt so the main loop can sleep
+    USART2->CR1 |= USART_CR1_RXNEIE;
+    NVIC_SetPriority(USART2_IRQn, 3);
+    NVIC_EnableIRQ(USART2_IRQn);
+#endif
 }
 
 /**
@@ -156,6 +301,8 @@ void UART2_Init(void)
  */
 void NVIC_Init(void)
 {
+    // The TIM2 capture backend configures its own interrupt
+#if !STM32_IR_USE_CAPTURE
     // Enable EXTI0 interrupt (PA0 - IR input)
     NVIC_EnableIRQ(EXTI0_IRQn);
     NVIC_SetPriority(EXTI0_IRQn, 1);
@@ -170,6 +317,7 @@ void NVIC_Init(void)
     EXTI->IMR |= EXTI_IMR_MR0;                    // Enable interrupt
     EXTI->RTSR |= EXTI_RTSR_TR0;                  // Rising edge
     EXTI->FTSR |= EXTI_FTSR_TR0;                  // Falling edge
+#endif
 }
 
 /**
@@ -184,12 +332,11 @@ void UART2_SendString(const char* str)
 }
 
 /**
- * Send character via UART2
+ * Queue character for UART2, waiting only while the ring is full
  */
 void UART2_SendChar(char ch)
 {
-    while (!(USART2->SR & USART_SR_TXE));
-    USART2->DR = ch;
+    while (stm32f401_uart_write(&ch, 1) == 0);
 }
 
 /**
@@ -202,44 +349,76 @@ const char* get_protocol_name(IR_Protocol_t protocol)
         case IR_PROTOCOL_NEC:       return "NEC";
         case IR_PROTOCOL_RC5:       return "RC5";
         case IR_PROTOCOL_RC6:       return "RC6";
-        case IR_PROTOCOL_SONY_SIRC: return "Sony SIRC";
+        case IR_PROTOCOL_SONY:      return "Sony SIRC";
         case IR_PROTOCOL_SAMSUNG:   return "Samsung";
         case IR_PROTOCOL_LG:        return "LG";
+        case IR_PROTOCOL_PANASONIC: return "Panasonic";
+        case IR_PROTOCOL_JVC:       return "JVC";
+        case IR_PROTOCOL_DENON:     return "Denon";
+        case IR_PROTOCOL_PPM:       return "PPM";
         default:                    return "Unknown";
     }
 }
 
 /**
- * Print decoded IR data
+ * Format decoded IR data into the UART ring (needs FRAME_TEXT_MAX free)
  */
 void print_ir_data(IR_Data_t* data)
 {
-    char buffer[100];
+#if STM32_IR_BINARY_OUTPUT
+    uint8_t record[IR_RECORD_SIZE];
     
-    sprintf(buffer, "Protocol: %s\r\n", get_protocol_name(data->protocol));
-    UART2_SendString(buffer);
+    stm32f401_uart_write(record, IR_record_encode(data, data->timestamp, record));
+#else
+    char buffer[FRAME_TEXT_MAX];
+    int length;
     
-    sprintf(buffer, "Address: 0x%04X\r\n", data->address);
-    UART2_SendString(buffer);
+    length = snprintf(buffer, sizeof(buffer),
+                      "Protocol: %s\r\n"
+                      "Address: 0x%04X\r\n"
+                      "Command: 0x%02X\r\n"
+                      "Raw Data: 0x%08lX\r\n"
+                      "Type: %s\r\n"
+                      "Time: %lu us\r\n"
+                      "Dropped: %u\r\n"
+                      "------------------------\r\n",
+                      get_protocol_name(data->protocol),
+                      data->address,
+                      data->command,
+                      data->raw_data,
+                      (data->flags & IR_DATA_FLAG_REPEAT) ? "REPEAT" : "NEW",
+                      data->timestamp,
+                      frames_dropped);
     
-    sprintf(buffer, "Command: 0x%02X\r\n", data->command);
-    UART2_SendString(buffer);
-    
-    sprintf(buffer, "Raw Data: 0x%08lX\r\n", data->raw_data);
-    UART2_SendString(buffer);
-    
-    if (data->repeat)
+    if (length > 0)
     {
-        UART2_SendString("Type: REPEAT\r\n");
+        stm32f401_uart_write(buffer, (length < (int)sizeof(buffer)) ? (uint16_t)length : (uint16_t)(sizeof(buffer) - 1U));
     }
-    else
+#endif
+}
+
+/**
+ * DMA1 Stream6 Interrupt Handler - UART transmit run complete
+ */
+void DMA1_Stream6_IRQHandler(void)
+{
+    stm32f401_uart_dma_interrupt();
+}
+
+#if STM32_IR_UART_COMMANDS
+/**
+ * USART2 Interrupt Handler - profiling commands
+ */
+void USART2_IRQHandler(void)
+{
+    if (USART2->SR & USART_SR_RXNE)
     {
-        UART2_SendString("Type: NEW\r\n");
+        uart_rx_cmd = (char)USART2->DR;
     }
-    
-    UART2_SendString("------------------------\r\n");
 }
+#endif
 
+#if !STM32_IR_USE_CAPTURE
 /**
  * EXTI0 Interrupt Handler - IR Pin Change
  */
@@ -252,43 +431,51 @@ void EXTI0_IRQHandler(void)
         // Call STM32 HAL interrupt handler
         stm32f401_ir_pin_interrupt();
         
-        // Process IR signal
+        // Process IR signal (completed frames go to on_ir_frame)
         uint8_t pin_state = stm32f401_pin_read();
         IR_decoder_process(&ir_decoder, pin_state);
-        
-        // Check if decoding is complete
-        if (ir_decoder.state == IR_STATE_FINISH)
-        {
-            ir_data_ready = 1;
-        }
     }
 }
+#endif
 
+#if STM32_IR_USE_CAPTURE
+/**
+ * TIM2 Interrupt Handler - one per frame, after the line goes quiet
+ */
+void TIM2_IRQHandler(void)
+{
+    stm32f401_capture_interrupt();
+}
+#else
 /**
- * TIM2 Interrupt Handler - IR Timeout
+ * TIM2 Interrupt Handler - IR Timeout (CC2, line quiet for IR_TIMEOUT_VALUE)
  */
 void TIM2_IRQHandler(void)
 {
-    if (TIM2->SR & TIM_SR_UIF)
+    if (TIM2->SR & TIM_SR_CC2IF)
     {
-        TIM2->SR &= ~TIM_SR_UIF;  // Clear interrupt flag
-        
-        // Call STM32 HAL interrupt handler
+        // Call STM32 HAL interrupt handler (clears the flag)
         stm32f401_timer_interrupt();
         
-        // Handle timeout
-        IR_decoder_timeout_handler(&ir_decoder);
-        
-        // Reset decoder on timeout
-        IR_decoder_reset(&ir_decoder);
+        // No frame has a gap this long: abandon one in progress
+        IR_decoder_expire(&ir_decoder);
     }
 }
+#endif
 
 /**
  * Hard Fault Handler for debugging
  */
 void HardFault_Handler(void)
 {
-    UART2_SendString("Hard Fault occurred!\r\n");
+    const char* str = "Hard Fault occurred!\r\n";
+    
+    // No interrupts here: stop the DMA ring and write the register directly
+    USART2->CR3 &= ~USART_CR3_DMAT;
+    while (*str)
+    {
+        while (!(USART2->SR & USART_SR_TXE));
+        USART2->DR = *str++;
+    }
     while (1);
 }
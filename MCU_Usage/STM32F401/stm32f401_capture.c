@@ -0,0 +1,142 @@
+/**
+ * stm32f401_capture.c - TIM2 Input Capture Receive Backend Implementation
+ *
+ * Author: Nghia Taarabt
+ */
+
+#include "stm32f401_capture.h"
+
+#define IR_CAPTURE_BUFFER_MASK  (IR_CAPTURE_BUFFER_SIZE - 1U)
+
+static volatile uint32_t capture_buffer[IR_CAPTURE_BUFFER_SIZE];
+static uint16_t capture_read_index = 0;
+static uint16_t capture_errors = 0;
+static IR_Decoder_t* capture_decoder = 0;
+static IR_Capture_Tap_t capture_tap = 0;
+static uint32_t capture_time = 0;           // Sum of all intervals: us since init
+
+/**
+ * Route PA0 to TIM2_CH1, capture both edges through DMA into capture_buffer
+ */
+void stm32f401_capture_init(IR_Decoder_t* decoder) {
+    capture_decoder = decoder;
+    capture_read_index = 0;
+    capture_errors = 0;
+    capture_time = 0;
+
+    // PA0 alternate function AF1 (TIM2_CH1) with pull-up
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
+    GPIOA->MODER = (GPIOA->MODER & ~(3U << (0 * 2))) | (2U << (0 * 2));
+    GPIOA->PUPDR = (GPIOA->PUPDR & ~(3U << (0 * 2))) | (1U << (0 * 2));
+    GPIOA->AFR[0] = (GPIOA->AFR[0] & ~(0xFU << (0 * 4))) | (1U << (0 * 4));
+
+    // TIM2: 1MHz, full 32-bit range
+    RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;
+    TIM2->CR1 = 0;
+    TIM2->PSC = 83;                                 // 84MHz / (83+1) = 1MHz
+    TIM2->ARR = 0xFFFFFFFFUL;
+
+    // IC1 on TI1, both edges, filtered
+    TIM2->CCMR1 = TIM_CCMR1_CC1S_0 | (IR_CAPTURE_INPUT_FILTER << TIM_CCMR1_IC1F_Pos);
+    TIM2->CCER = TIM_CCER_CC1P | TIM_CCER_CC1NP | TIM_CCER_CC1E;
+
+    // Reset slave mode triggered by TI1F_ED: CCR1 latches the interval since
+    // the previous edge, then the counter restarts from zero
+    TIM2->SMCR = (4U << TIM_SMCR_TS_Pos) | (4U << TIM_SMCR_SMS_Pos);
+
+    // CC2 compare fires once the line has been quiet for a whole gap
+    TIM2->CCR2 = IR_CAPTURE_GAP_US;
+
+    // DMA1 Stream5: TIM2->CCR1 to capture_buffer, 32-bit, circular
+    RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+    IR_CAPTURE_DMA_STREAM->CR = 0;
+    while (IR_CAPTURE_DMA_STREAM->CR & DMA_SxCR_EN);
+    IR_CAPTURE_DMA_STREAM->PAR = (uint32_t)&TIM2->CCR1;
+    IR_CAPTURE_DMA_STREAM->M0AR = (uint32_t)capture_buffer;
+    IR_CAPTURE_DMA_STREAM->NDTR = IR_CAPTURE_BUFFER_SIZE;
+    IR_CAPTURE_DMA_STREAM->CR = (IR_CAPTURE_DMA_CHANNEL << DMA_SxCR_CHSEL_Pos) |
+                                DMA_SxCR_MSIZE_1 | DMA_SxCR_PSIZE_1 |
+                                DMA_SxCR_MINC | DMA_SxCR_CIRC;
+    IR_CAPTURE_DMA_STREAM->CR |= DMA_SxCR_EN;
+
+    // Only the DMA request per edge and one compare interrupt per frame
+    TIM2->EGR = TIM_EGR_UG;
+    TIM2->SR = 0;
+    TIM2->DIER = TIM_DIER_CC1DE | TIM_DIER_CC2IE;
+
+    NVIC_SetPriority(TIM2_IRQn, 1);
+    NVIC_EnableIRQ(TIM2_IRQn);
+
+    TIM2->CR1 |= TIM_CR1_CEN;
+}
+
+/**
+ * Feed every interval captured since the last call into the decoder
+ */
+void stm32f401_capture_service(void) {
+    uint16_t write_index = (uint16_t)(IR_CAPTURE_BUFFER_SIZE - IR_CAPTURE_DMA_STREAM->NDTR) & IR_CAPTURE_BUFFER_MASK;
+    uint16_t pending = (write_index - capture_read_index) & IR_CAPTURE_BUFFER_MASK;
+
+    // Called after a quiet gap: the first queued edge starts a burst and
+    // levels alternate from there. An odd count means captures were lost and
+    // the levels after the gap in the batch are unknown: keep the clock, drop
+    // the batch and abandon any frame in progress (an unread one stays)
+    if (pending & 1U) {
+        capture_errors++;
+        while (capture_read_index != write_index) {
+            capture_time += capture_buffer[capture_read_index];
+            capture_read_index = (capture_read_index + 1U) & IR_CAPTURE_BUFFER_MASK;
+        }
+        if (capture_decoder) {
+            IR_decoder_expire(capture_decoder);
+        }
+        return;
+    }
+
+    uint8_t level = IR_HIGH;
+
+    while (capture_read_index != write_index) {
+        uint32_t interval_us = capture_buffer[capture_read_index];
+        capture_read_index = (capture_read_index + 1U) & IR_CAPTURE_BUFFER_MASK;
+
+        capture_time += interval_us;
+
+        if (capture_tap) {
+            capture_tap(level, interval_us);
+        }
+        if (capture_decoder) {
+#if IR_DECODER_ENABLE_TIMESTAMPS
+            // Intervals are exact, so their running sum is an absolute clock
+            IR_decoder_process_time(capture_decoder, level, capture_time);
+#else
+            uint16_t ticks = (interval_us > IR_TICKS_MAX_US) ? 0xFFFFU : IR_US_TO_TICKS(interval_us);
+            IR_decoder_process_duration(capture_decoder, level, ticks);
+#endif
+        }
+        level ^= 1U;
+    }
+}
+
+/**
+ * Install (or clear with 0) the per-edge observer; runs in the TIM2 interrupt
+ */
+void stm32f401_capture_set_tap(IR_Capture_Tap_t tap) {
+    capture_tap = tap;
+}
+
+/**
+ * Capture backend interrupt handler (call from TIM2_IRQHandler)
+ */
+void stm32f401_capture_interrupt(void) {
+    if (TIM2->SR & TIM_SR_CC2IF) {
+        TIM2->SR = ~TIM_SR_CC2IF;                   // rc_w0: clear only CC2IF
+        stm32f401_capture_service();
+    }
+}
+
+/**
+ * Batches dropped since init because captures were lost (odd edge count)
+ */
+uint16_t stm32f401_capture_errors(void) {
+    return capture_errors;
+}
@@ -0,0 +1,48 @@
+/**
+ * stm32f401_capture.h - TIM2 Input Capture Receive Backend for STM32F401
+ *
+ * PA0 is routed to TIM2_CH1 and both edges are captured in hardware. TIM2
+ * runs in reset slave mode on TI1F_ED, so each CCR1 capture is the exact
+ * interval since the previous edge. DMA1 Stream5 moves captures into a
+ * circular buffer and a single TIM2 CC2 compare interrupt fires once the
+ * line has been quiet for IR_CAPTURE_GAP_US, i.e. once per frame.
+ * Author: Nghia Taarabt
+ */
+
+#ifndef STM32F401_CAPTURE_H_
+#define STM32F401_CAPTURE_H_
+
+#include "stm32f4xx.h"
+#include <stdint.h>
+#include "ir_decoder.h"
+
+// Capture buffer length in edges, a power of two (one NEC frame is 68 edges)
+#ifndef IR_CAPTURE_BUFFER_SIZE
+#define IR_CAPTURE_BUFFER_SIZE  (256U)
+#endif
+
+// Quiet time that ends a frame (us): longer than any mark or space inside
+// a frame (9ms NEC leader), shorter than the gap before the next frame
+#ifndef IR_CAPTURE_GAP_US
+#define IR_CAPTURE_GAP_US       (12000U)
+#endif
+
+// Input filter on TI1 (IC1F): 0x3 = 8 timer clocks at 84MHz
+#define IR_CAPTURE_INPUT_FILTER (0x3U)
+
+// DMA1 Stream5 Channel3 is the TIM2_CH1 request on STM32F401
+#define IR_CAPTURE_DMA_STREAM   DMA1_Stream5
+#define IR_CAPTURE_DMA_CHANNEL  (3U)
+
+// Observer of every captured edge, called before the decoder sees it: the
+// level the edge starts and the interval since the previous edge (us)
+typedef void (*IR_Capture_Tap_t)(uint8_t level, uint32_t interval_us);
+
+// Function Declarations
+void stm32f401_capture_init(IR_Decoder_t* decoder);
+void stm32f401_capture_service(void);
+void stm32f401_capture_set_tap(IR_Capture_Tap_t tap);
+void stm32f401_capture_interrupt(void);
+uint16_t stm32f401_capture_errors(void);
+
+#endif /* STM32F401_CAPTURE_H_ */
@@ -13,6 +13,10 @@ volatile uint16_t stm32f401_ir_counter = 0;
 volatile uint16_t stm32f401_ir_timeout = 0;
 volatile uint8_t stm32f401_ir_pin_state = 0;
 
+// Set while STOP wake-up time is still to be credited to the leader mark
+static volatile uint8_t stop_wake_pending = 0;
+static uint8_t flash_dcache_reset = 0;          // Sector erased behind the data cache
+
 /**
  * Initialize STM32F401 hardware for IR decoding
  */
@@ -39,10 +43,14 @@ void stm32f401_hardware_init(void) {
     // Enable Timer clock
     RCC->APB1ENR |= IR_TIMER_CLK;
     
-    // Configure Timer2 for microsecond counting
+    // Configure Timer2 as a free-running 32-bit microsecond clock (wraps
+    // after 71 minutes). Edges are timed by subtraction and it is never
+    // reset; CC2 fires once the line has been quiet for IR_TIMEOUT_VALUE
     IR_TIMER->PSC = IR_TIMER_PRESCALER;             // 1MHz clock (1us resolution)
-    IR_TIMER->ARR = 0xFFFF;                         // Maximum count
-    IR_TIMER->DIER |= TIM_DIER_UIE;                 // Enable update interrupt
+    IR_TIMER->ARR = 0xFFFFFFFFUL;                   // Full 32-bit range
+    IR_TIMER->EGR = TIM_EGR_UG;                     // Load prescaler
+    IR_TIMER->SR = 0;
+    IR_TIMER->DIER |= TIM_DIER_CC2IE;               // Enable timeout compare interrupt
     
     // Enable Timer interrupt in NVIC
     NVIC_EnableIRQ(IR_TIMER_IRQ);
@@ -53,7 +61,6 @@ void stm32f401_hardware_init(void) {
  * Start the timer for IR timing measurements
  */
 void stm32f401_timer_start(void) {
-    IR_TIMER->CNT = 0;                              // Reset counter
     IR_TIMER->CR1 |= TIM_CR1_CEN;                   // Enable timer
 }
 
@@ -71,11 +78,33 @@ uint16_t stm32f401_timer_get_count(void) {
     return (uint16_t)IR_TIMER->CNT;
 }
 
+/**
+ * Get the free-running 32-bit time in microseconds
+ */
+uint32_t stm32f401_timer_get_time(void) {
+    uint32_t now = IR_TIMER->CNT;
+    
+    // The first edge after STOP is the leader edge that woke the core:
+    // TIM2 was stopped for the wake-up, so date the edge that much earlier
+    if (stop_wake_pending) {
+        stop_wake_pending = 0;
+        now -= IR_STOP_WAKE_LATENCY_US;
+    }
+    return now;
+}
+
 /**
  * Reset timer count to zero
  */
 void stm32f401_timer_reset_count(void) {
-    IR_TIMER->CNT = 0;
+    // The first reset after STOP is the leader edge that woke the core:
+    // TIM2 was stopped for the wake-up, so start it that far into the mark
+    if (stop_wake_pending) {
+        stop_wake_pending = 0;
+        IR_TIMER->CNT = IR_STOP_WAKE_LATENCY_US;
+    } else {
+        IR_TIMER->CNT = 0;
+    }
 }
 
 /**
@@ -94,6 +123,190 @@ void stm32f401_hal_init(IR_HAL_t* hal) {
     hal->timer_get_count = stm32f401_timer_get_count;
     hal->timer_reset_count = stm32f401_timer_reset_count;
     hal->pin_read = stm32f401_pin_read;
+#if IR_DECODER_ENABLE_TIMESTAMPS
+    // Used instead of get_count/reset_count: the decoder subtracts timestamps
+    hal->timer_get_time = stm32f401_timer_get_time;
+#endif
+}
+
+/**
+ * Enter STOP until an EXTI line (the IR receiver edge) wakes the core
+ */
+void stm32f401_stop_mode_enter(void) {
+    // Low-power regulator and flash power-down in STOP
+    RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+    PWR->CR = (PWR->CR & ~PWR_CR_PDDS) | PWR_CR_LPDS | PWR_CR_FPDS;
+    
+    // Called with interrupts masked: an edge already pending makes WFI
+    // return at once, and the edge handler waits until the clock is back
+    stop_wake_pending = 1;
+    SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+    __DSB();
+    __WFI();
+    SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+    
+    // STOP leaves HSI as the system clock; TIM2's prescaler assumes 84MHz
+    stm32f401_clock_restore();
+    
+    // Woken by something other than the receiver: nothing to credit
+    if (!(EXTI->PR & EXTI_PR_PR0)) {
+        stop_wake_pending = 0;
+    }
+}
+
+/**
+ * Switch back to the PLL after STOP (PLL configuration is retained)
+ */
+void stm32f401_clock_restore(void) {
+    RCC->CR |= RCC_CR_PLLON;
+    while (!(RCC->CR & RCC_CR_PLLRDY));
+    
+    RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | RCC_CFGR_SW_PLL;
+    while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL);
+}
+
+/**
+ * Initialize PB0..PB(n-1) as IR inputs on EXTI0..EXTI(n-1) sharing TIM2
+ */
+void stm32f401_multi_hardware_init(uint8_t channel_count) {
+    static const IRQn_Type exti_irq[4] = { EXTI0_IRQn, EXTI1_IRQn, EXTI2_IRQn, EXTI3_IRQn };
+    
+    if (channel_count > 4) {
+        channel_count = 4;
+    }
+    
+    RCC->AHB1ENR |= IR_MULTI_GPIO_CLK;
+    RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+    
+    for (uint8_t ch = 0; ch < channel_count; ch++) {
+        IR_MULTI_GPIO_PORT->MODER &= ~(3U << (ch * 2));     // Input mode
+        IR_MULTI_GPIO_PORT->PUPDR |= (1U << (ch * 2));      // Pull-up
+        
+        SYSCFG->EXTICR[0] &= ~(0xFU << (ch * 4));           // Route EXTIn to PBn
+        SYSCFG->EXTICR[0] |= (IR_MULTI_EXTI_PORT << (ch * 4));
+        EXTI->IMR |= (1U << ch);
+        EXTI->FTSR |= (1U << ch);
+        EXTI->RTSR |= (1U << ch);
+        
+        // Same priority for all lines: edge handlers never preempt each other
+        NVIC_SetPriority(exti_irq[ch], 1);
+        NVIC_EnableIRQ(exti_irq[ch]);
+    }
+    
+    // TIM2 free-running at 1MHz; edges are timestamped, the counter is never reset
+    RCC->APB1ENR |= IR_TIMER_CLK;
+    IR_TIMER->PSC = IR_TIMER_PRESCALER;
+    IR_TIMER->ARR = 0xFFFF;
+    IR_TIMER->EGR = TIM_EGR_UG;                     // Load prescaler
+}
+
+/**
+ * Initialize HAL structure for the multi-channel decoder
+ */
+void stm32f401_multi_hal_init(IR_HAL_t* hal) {
+    hal->timer_start = stm32f401_timer_start;
+    hal->timer_stop = stm32f401_timer_stop;
+    hal->timer_get_count = stm32f401_timer_get_count;
+    hal->timer_reset_count = 0;                     // Shared timer is never reset
+    hal->pin_read = 0;
+#if IR_DECODER_ENABLE_TIMESTAMPS
+    hal->timer_get_time = 0;                        // IR_multi_service() computes intervals
+#endif
+}
+
+/**
+ * Read a receiver channel (IR_HIGH while the sensor reports a burst)
+ */
+uint8_t stm32f401_multi_pin_read(uint8_t channel) {
+    // TSOP-style receivers pull the output low during a burst
+    return (IR_MULTI_GPIO_PORT->IDR & (1U << channel)) ? IR_LOW : IR_HIGH;
+}
+
+/**
+ * Multi-channel edge handler (call from EXTIn_IRQHandler with n = channel)
+ */
+void stm32f401_multi_pin_interrupt(IR_Multi_t* multi, uint8_t channel) {
+    uint16_t stamp = (uint16_t)IR_TIMER->CNT;       // Timestamp first, before any other work
+    
+    EXTI->PR = (1U << channel);                     // Clear pending flag (write 1)
+    IR_multi_capture(multi, channel, stm32f401_multi_pin_read(channel), stamp);
+}
+
+/**
+ * Enable the DWT cycle counter used by ir_profile.h
+ */
+void stm32f401_profile_init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;  // Enable trace block
+    DWT->CYCCNT = 0;                                // Reset cycle counter
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;            // Start counting core cycles
+}
+
+/**
+ * Read from the store sectors
+ */
+static void stm32f401_flash_read(uint16_t address, uint8_t* data, uint16_t length) {
+    const volatile uint8_t* src = (const volatile uint8_t*)(IR_STORE_FLASH_BASE + address);
+    
+    for (uint16_t i = 0; i < length; i++) {
+        data[i] = src[i];
+    }
+}
+
+/**
+ * Start programming one byte (x8 parallelism, any supply voltage)
+ */
+static void stm32f401_flash_program(uint16_t address, uint8_t value) {
+    FLASH->CR = FLASH_CR_PG;
+    *(volatile uint8_t*)(IR_STORE_FLASH_BASE + address) = value;
+}
+
+/**
+ * Start erasing one store sector
+ */
+static void stm32f401_flash_erase(uint8_t page) {
+    // Stale lines of the erased sector must not survive in the data cache
+    FLASH->ACR &= ~FLASH_ACR_DCEN;
+    flash_dcache_reset = 1;
+    
+    FLASH->CR = FLASH_CR_SER | ((uint32_t)(IR_STORE_FLASH_SECTOR + page) << FLASH_CR_SNB_Pos);
+    FLASH->CR |= FLASH_CR_STRT;
+}
+
+/**
+ * Program or erase in progress; re-enables the data cache after an erase
+ */
+static uint8_t stm32f401_flash_busy(void) {
+    if (FLASH->SR & FLASH_SR_BSY) {
+        return 1;
+    }
+    
+    if (flash_dcache_reset) {
+        flash_dcache_reset = 0;
+        FLASH->CR = 0;
+        FLASH->ACR |= FLASH_ACR_DCRST;
+        FLASH->ACR &= ~FLASH_ACR_DCRST;
+        FLASH->ACR |= FLASH_ACR_DCEN;
+    }
+    return 0;
+}
+
+/**
+ * Initialize the learned-code store HAL; the flash stays unlocked afterwards
+ */
+void stm32f401_store_hal_init(IR_Store_HAL_t* store_hal) {
+    if (FLASH->CR & FLASH_CR_LOCK) {
+        FLASH->KEYR = 0x45670123UL;
+        FLASH->KEYR = 0xCDEF89ABUL;
+    }
+    FLASH->SR = FLASH_SR_PGSERR | FLASH_SR_PGPERR | FLASH_SR_PGAERR | FLASH_SR_WRPERR | FLASH_SR_OPERR;
+    
+    store_hal->read = stm32f401_flash_read;
+    store_hal->program = stm32f401_flash_program;
+    store_hal->erase = stm32f401_flash_erase;
+    store_hal->busy = stm32f401_flash_busy;
+    store_hal->page_size = IR_STORE_FLASH_PAGE_SIZE;
+    store_hal->page_count = IR_STORE_FLASH_PAGE_COUNT;
+    store_hal->erase_deferred = 1;              // Sector erase stalls the core, see stm32f401_hal.h
 }
 
 /**
@@ -101,16 +314,23 @@ void stm32f401_hal_init(IR_HAL_t* hal) {
  */
 void stm32f401_ir_pin_interrupt(void) {
     stm32f401_ir_pin_state = stm32f401_pin_read();
+    
+    // Push the timeout compare out to IR_TIMEOUT_VALUE after this edge
+#if IR_DECODER_ENABLE_TIMESTAMPS
+    IR_TIMER->CCR2 = IR_TIMER->CNT + IR_TIMEOUT_VALUE;
+#else
     stm32f401_ir_counter = stm32f401_timer_get_count();
-    stm32f401_timer_reset_count();
+    IR_TIMER->CCR2 = IR_TIMEOUT_VALUE;              // The decoder resets the counter next
+#endif
+    IR_TIMER->SR = ~TIM_SR_CC2IF;                   // rc_w0: clear only CC2IF
 }
 
 /**
  * Timer interrupt handler (call from TIM2_IRQHandler)
  */
 void stm32f401_timer_interrupt(void) {
-    if (IR_TIMER->SR & TIM_SR_UIF) {
-        IR_TIMER->SR &= ~TIM_SR_UIF;                // Clear interrupt flag
+    if (IR_TIMER->SR & TIM_SR_CC2IF) {
+        IR_TIMER->SR = ~TIM_SR_CC2IF;               // rc_w0: clear only CC2IF
         stm32f401_ir_timeout++;
     }
 }
@@ -12,6 +12,8 @@
 #include "stm32f4xx.h"
 #include <stdint.h>
 #include "ir_decoder.h"
+#include "ir_multi.h"
+#include "ir_store.h"
 
 // Hardware Configuration for STM32F401
 #define IR_IN_GPIO_PORT     GPIOA
@@ -24,7 +26,29 @@
 
 // Timer configuration (84MHz / 84 = 1MHz = 1us resolution)
 #define IR_TIMER_PRESCALER  83              // 84MHz / (83+1) = 1MHz
-#define IR_TIMEOUT_VALUE    50000           // 50ms timeout
+#define IR_TIMEOUT_VALUE    50000           // 50ms timeout (TIM2 CC2 after the last edge)
+
+// STOP mode wake-up: regulator and flash wake-up plus PLL relock (us) spent
+// between the leader edge and the edge handler reading TIM2
+#ifndef IR_STOP_WAKE_LATENCY_US
+#define IR_STOP_WAKE_LATENCY_US     (200U)
+#endif
+
+// Multi-channel receivers: PB0..PB3 on EXTI0..EXTI3, timestamped by free-running TIM2
+#define IR_MULTI_GPIO_PORT  GPIOB
+#define IR_MULTI_GPIO_CLK   RCC_AHB1ENR_GPIOBEN
+#define IR_MULTI_EXTI_PORT  (1U)            // SYSCFG EXTICR code for GPIOB
+
+// Learned-code store (ir_store.h) in flash sectors 2 and 3 (16KB each at
+// 0x08008000), the sectors ST's EEPROM emulation uses; stm32f401xc_ir.ld
+// keeps code out of them. Erasing a sector stalls every flash fetch,
+// interrupts included, for up to ~0.5s, once per 1820 records. The erase is
+// deferred: call IR_store_erase_now() when IR_store_erase_pending() and a
+// stall is acceptable (no frame being received, UART output idle)
+#define IR_STORE_FLASH_BASE         (0x08008000UL)
+#define IR_STORE_FLASH_SECTOR       (2U)            // First sector of the store
+#define IR_STORE_FLASH_PAGE_SIZE    (0x4000U)
+#define IR_STORE_FLASH_PAGE_COUNT   (2U)
 
 // Global variables for STM32F401 HAL
 extern volatile uint16_t stm32f401_ir_counter;
@@ -35,6 +59,7 @@ extern volatile uint8_t stm32f401_ir_pin_state;
 void stm32f401_timer_start(void);
 void stm32f401_timer_stop(void);
 uint16_t stm32f401_timer_get_count(void);
+uint32_t stm32f401_timer_get_time(void);
 void stm32f401_timer_reset_count(void);
 uint8_t stm32f401_pin_read(void);
 
@@ -42,6 +67,23 @@ uint8_t stm32f401_pin_read(void);
 void stm32f401_hal_init(IR_HAL_t* hal);
 void stm32f401_hardware_init(void);
 
+// Multi-channel receiver support (see ir_multi.h)
+void stm32f401_multi_hardware_init(uint8_t channel_count);
+void stm32f401_multi_hal_init(IR_HAL_t* hal);
+uint8_t stm32f401_multi_pin_read(uint8_t channel);
+void stm32f401_multi_pin_interrupt(IR_Multi_t* multi, uint8_t channel);
+
+// Low-power receive: STOP between frames, EXTI0 wakes on the leader edge
+// (call with interrupts disabled; the edge handler runs once they are re-enabled)
+void stm32f401_stop_mode_enter(void);
+void stm32f401_clock_restore(void);
+
+// DWT cycle counter for ISR profiling (IR_ENABLE_PROFILING with IR_PROFILE_USE_DWT)
+void stm32f401_profile_init(void);
+
+// Learned-code store over the flash sectors above
+void stm32f401_store_hal_init(IR_Store_HAL_t* store_hal);
+
 // Interrupt handlers (to be called from main application)
 void stm32f401_ir_pin_interrupt(void);
 void stm32f401_timer_interrupt(void);
@@ -0,0 +1,44 @@
+/**
+ * stm32f401_trace.c - Edge Trace Output over UART Implementation
+ *
+ * Author: Nghia Taarabt
+ */
+
+#include "stm32f401_trace.h"
+#include "stm32f401_uart.h"
+
+static volatile uint16_t trace_dropped = 0;
+
+/**
+ * Write the trace header, waiting for ring space (call before the tap is set)
+ */
+void stm32f401_trace_start(void) {
+    uint8_t header[IR_TRACE_HEADER_SIZE];
+
+    trace_dropped = 0;
+    IR_trace_header(header, IR_TRACE_UNIT_US);
+    while (stm32f401_uart_tx_free() < IR_TRACE_HEADER_SIZE);
+    stm32f401_uart_write(header, IR_TRACE_HEADER_SIZE);
+}
+
+/**
+ * Capture tap: queue one record, or count it as dropped if the ring is full.
+ * Records are never split, so the stream stays parseable after a drop
+ */
+void stm32f401_trace_edge(uint8_t level, uint32_t interval_us) {
+    uint8_t record[IR_TRACE_RECORD_MAX];
+    uint8_t length = IR_trace_encode(record, level, interval_us);
+
+    if (stm32f401_uart_tx_free() < length) {
+        trace_dropped++;
+        return;
+    }
+    stm32f401_uart_write(record, length);
+}
+
+/**
+ * Records lost to a full UART ring since stm32f401_trace_start()
+ */
+uint16_t stm32f401_trace_dropped(void) {
+    return trace_dropped;
+}
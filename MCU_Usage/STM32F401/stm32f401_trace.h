@@ -0,0 +1,23 @@
+/**
+ * stm32f401_trace.h - Edge Trace Output over UART for STM32F401
+ *
+ * Streams every edge of the TIM2 capture backend as an ir_trace.h record
+ * into the DMA UART ring, after a header with microsecond units. Hook it in
+ * with stm32f401_capture_set_tap(stm32f401_trace_edge); the host side is
+ * tools/ir_trace. At 115200 baud the link carries about 11KB/s, several
+ * times the two bytes per edge of back-to-back NEC frames.
+ * Author: Nghia Taarabt
+ */
+
+#ifndef STM32F401_TRACE_H_
+#define STM32F401_TRACE_H_
+
+#include <stdint.h>
+#include "ir_trace.h"
+
+// Function Declarations
+void stm32f401_trace_start(void);
+void stm32f401_trace_edge(uint8_t level, uint32_t interval_us);
+uint16_t stm32f401_trace_dropped(void);
+
+#endif /* STM32F401_TRACE_H_ */
@@ -0,0 +1,113 @@
+/**
+ * stm32f401_uart.c - DMA UART Transmit Ring Implementation
+ *
+ * Author: Nghia Taarabt
+ */
+
+#include "stm32f401_uart.h"
+
+#define UART_TX_RING_MASK       (UART_TX_RING_SIZE - 1U)
+
+static uint8_t tx_ring[UART_TX_RING_SIZE];
+static volatile uint16_t tx_head = 0;           // Advanced by writers
+static volatile uint16_t tx_tail = 0;           // Advanced on DMA completion
+static volatile uint16_t tx_dma_length = 0;     // Bytes of the transfer in flight
+
+/**
+ * Start a transfer of the next contiguous run unless one is in flight
+ * (interrupts masked or from the DMA interrupt)
+ */
+static void uart_tx_dma_start(void) {
+    uint16_t pending = (uint16_t)(tx_head - tx_tail);
+    uint16_t offset = tx_tail & UART_TX_RING_MASK;
+    uint16_t run = (uint16_t)(UART_TX_RING_SIZE - offset);
+
+    if (tx_dma_length || pending == 0) {
+        return;
+    }
+    if (run > pending) {
+        run = pending;
+    }
+
+    tx_dma_length = run;
+    DMA1->HIFCR = UART_TX_DMA_FLAGS;
+    UART_TX_DMA_STREAM->M0AR = (uint32_t)&tx_ring[offset];
+    UART_TX_DMA_STREAM->NDTR = run;
+    UART_TX_DMA_STREAM->CR |= DMA_SxCR_EN;
+}
+
+/**
+ * Configure USART2 (8N1, TX over DMA); PA2/PA3 alternate functions are set by the caller
+ */
+void stm32f401_uart_init(uint32_t baudrate) {
+    RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
+    RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+
+    // USART2 runs from APB1, left at HCLK by SystemClock_Config()
+    USART2->BRR = (SystemCoreClock + baudrate / 2U) / baudrate;
+    USART2->CR3 = USART_CR3_DMAT;
+    USART2->CR1 = USART_CR1_UE | USART_CR1_TE | USART_CR1_RE;
+
+    // Memory to USART2->DR, bytes, memory increment, interrupt per run
+    UART_TX_DMA_STREAM->CR = 0;
+    while (UART_TX_DMA_STREAM->CR & DMA_SxCR_EN);
+    UART_TX_DMA_STREAM->PAR = (uint32_t)&USART2->DR;
+    UART_TX_DMA_STREAM->CR = (UART_TX_DMA_CHANNEL << DMA_SxCR_CHSEL_Pos) |
+                             DMA_SxCR_DIR_0 | DMA_SxCR_MINC | DMA_SxCR_TCIE;
+
+    // Lowest priority: output never delays edge timing
+    NVIC_SetPriority(UART_TX_DMA_IRQ, 3);
+    NVIC_EnableIRQ(UART_TX_DMA_IRQ);
+}
+
+/**
+ * Free space in the transmit ring
+ */
+uint16_t stm32f401_uart_tx_free(void) {
+    return (uint16_t)(UART_TX_RING_SIZE - (uint16_t)(tx_head - tx_tail));
+}
+
+/**
+ * Queue bytes for transmission without waiting; returns how many fit
+ */
+uint16_t stm32f401_uart_write(const void* data, uint16_t length) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint16_t head = tx_head;
+    uint16_t free = stm32f401_uart_tx_free();
+
+    if (length > free) {
+        length = free;
+    }
+    for (uint16_t i = 0; i < length; i++) {
+        tx_ring[(head + i) & UART_TX_RING_MASK] = bytes[i];
+    }
+
+    // Publish the bytes, then kick the DMA with its interrupt held off
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    __DMB();
+    tx_head = (uint16_t)(head + length);
+    uart_tx_dma_start();
+    __set_PRIMASK(primask);
+
+    return length;
+}
+
+/**
+ * Ring empty and the last byte has left the shift register (safe to STOP)
+ */
+uint8_t stm32f401_uart_tx_idle(void) {
+    return (tx_head == tx_tail && !tx_dma_length && (USART2->SR & USART_SR_TC)) ? 1 : 0;
+}
+
+/**
+ * DMA transfer-complete handler (call from DMA1_Stream6_IRQHandler)
+ */
+void stm32f401_uart_dma_interrupt(void) {
+    if (DMA1->HISR & DMA_HISR_TCIF6) {
+        DMA1->HIFCR = UART_TX_DMA_FLAGS;
+        tx_tail = (uint16_t)(tx_tail + tx_dma_length);
+        tx_dma_length = 0;
+        uart_tx_dma_start();
+    }
+}
@@ -0,0 +1,36 @@
+/**
+ * stm32f401_uart.h - DMA UART Transmit Ring for STM32F401
+ *
+ * USART2 output through a RAM ring drained by DMA1 Stream6 Channel4. Writers
+ * only copy bytes into the ring; each DMA transfer sends the contiguous run
+ * up to the ring's end and its transfer-complete interrupt starts the next,
+ * so the CPU takes one interrupt per run instead of one per byte.
+ * Author: Nghia Taarabt
+ */
+
+#ifndef STM32F401_UART_H_
+#define STM32F401_UART_H_
+
+#include "stm32f4xx.h"
+#include <stdint.h>
+
+// Transmit ring length in bytes, a power of two
+#ifndef UART_TX_RING_SIZE
+#define UART_TX_RING_SIZE       (512U)
+#endif
+
+// DMA1 Stream6 Channel4 is the USART2_TX request on STM32F401
+#define UART_TX_DMA_STREAM      DMA1_Stream6
+#define UART_TX_DMA_CHANNEL     (4U)
+#define UART_TX_DMA_IRQ         DMA1_Stream6_IRQn
+#define UART_TX_DMA_FLAGS       (DMA_HIFCR_CTCIF6 | DMA_HIFCR_CHTIF6 | DMA_HIFCR_CTEIF6 | \
+                                 DMA_HIFCR_CDMEIF6 | DMA_HIFCR_CFEIF6)
+
+// Function Declarations
+void stm32f401_uart_init(uint32_t baudrate);
+uint16_t stm32f401_uart_tx_free(void);
+uint16_t stm32f401_uart_write(const void* data, uint16_t length);
+uint8_t stm32f401_uart_tx_idle(void);
+void stm32f401_uart_dma_interrupt(void);
+
+#endif /* STM32F401_UART_H_ */
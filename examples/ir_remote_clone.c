@@ -2,7 +2,10 @@
  * ir_remote_clone.c - IR Remote Control Cloner
  * 
  * Demonstrates receiving IR commands and retransmitting them
- * Combines both decoder and transmitter functionality
+ * Combines both decoder and transmitter functionality. Learned commands
+ * are kept in EEPROM through ir_store.h and survive power cycles. Build with
+ * -DIR_DECODER_ENABLE_ECHO=1 -DIR_TRANSMITTER_ENABLE_NOTIFY=1 so the
+ * receiver ignores (or, with CLONE_VERIFY_ECHO, checks) our own frames
  * Created: Example for IR cloning functionality
  * Author: Nghia Taarabt
  */
@@ -12,29 +15,44 @@
 #include <avr/interrupt.h>
 #include "../ir_decoder.h"
 #include "../ir_transmitter.h"
+#include "../ir_store.h"
 #include "../attiny13_hal.h"
 
 #define LEARN_BUTTON_PIN    PB2
 #define SEND_BUTTON_PIN     PB3
 #define STATUS_LED_PIN      PB4
 
+// 1: decode our own emission and flash the LED when it does not match
+#ifndef CLONE_VERIFY_ECHO
+#define CLONE_VERIFY_ECHO   0
+#endif
+
+// The ATTiny13 carrier reprograms Timer0, the decoder's timebase, so the
+// echo cannot be timed while we transmit; blanking still works
+#if CLONE_VERIFY_ECHO && (defined(__AVR_ATtiny13__) || defined(__AVR_ATtiny13A__))
+#error "CLONE_VERIFY_ECHO needs a receive timer separate from the carrier timer, not available on the ATTiny13"
+#endif
+
 // Global instances
 IR_Decoder_t ir_decoder;
 IR_Transmitter_t ir_transmitter;
 IR_HAL_t rx_hal;
 IR_TX_HAL_t tx_hal;
+IR_Store_HAL_t store_hal;
 
-// Learned command storage
-typedef struct {
-    uint8_t address;
-    uint8_t command;
-    IR_Protocol_t protocol;
-    uint8_t valid;
-} Learned_Command_t;
-
-Learned_Command_t learned_commands[4];  // Store up to 4 commands
+// Learned command storage (IR_STORE_SLOTS slots in EEPROM)
+IR_Store_t learned_commands;
 uint8_t current_slot = 0;
 
+// Transmitter to decoder: blank (or verify) while our frame is on air.
+// Called from the main loop; INT0 must not see the decoder half updated
+static void transmit_notify(uint8_t event, uint32_t raw_data)
+{
+    cli();
+    IR_decoder_echo(&ir_decoder, event, raw_data);
+    sei();
+}
+
 void setup_hardware(void)
 {
     // Configure button pins
@@ -48,14 +66,20 @@ void setup_hardware(void)
     // Initialize HALs
     attiny13_hal_init(&rx_hal);
     attiny13_tx_hal_init(&tx_hal);
+    attiny13_store_hal_init(&store_hal);
     
     // Initialize decoder and transmitter
     IR_decoder_init(&ir_decoder, IR_PROTOCOL_NEC, &rx_hal);
+    IR_decoder_set_echo_mode(&ir_decoder, CLONE_VERIFY_ECHO ? IR_ECHO_MODE_VERIFY : IR_ECHO_MODE_BLANK);
     IR_transmitter_init(&ir_transmitter, IR_PROTOCOL_NEC, &tx_hal);
     
-    // Clear learned commands
-    for (uint8_t i = 0; i < 4; i++) {
-        learned_commands[i].valid = 0;
+    // Rebuild the slot index from EEPROM and continue at the first empty slot
+    IR_store_init(&learned_commands, &store_hal);
+    
+    IR_Data_t stored;
+    while (current_slot < IR_STORE_SLOTS - 1 &&
+           IR_store_get(&learned_commands, current_slot, &stored) == IR_SUCCESS) {
+        current_slot++;
     }
     
     sei();
@@ -77,11 +101,8 @@ void learn_mode(void)
     
     while (timeout-- > 0) {
         if (IR_decoder_get_data(&ir_decoder, &received_data) == IR_SUCCESS) {
-            // Store learned command
-            learned_commands[current_slot].address = received_data.address;
-            learned_commands[current_slot].command = received_data.command;
-            learned_commands[current_slot].protocol = received_data.protocol;
-            learned_commands[current_slot].valid = 1;
+            // Queue the learned command; the main loop writes it to EEPROM
+            IR_store_put(&learned_commands, current_slot, &received_data);
             
             // Indicate successful learning with 3 quick blinks
             PORTB &= ~_BV(STATUS_LED_PIN);
@@ -92,9 +113,10 @@ void learn_mode(void)
                 _delay_ms(200);
             }
             
-            current_slot = (current_slot + 1) % 4;  // Move to next slot
+            current_slot = (current_slot + 1) % IR_STORE_SLOTS;  // Move to next slot
             return;
         }
+        IR_store_service(&learned_commands);
         _delay_ms(1);
     }
     
@@ -105,37 +127,52 @@ void learn_mode(void)
 
 void send_learned_command(uint8_t slot)
 {
-    if (slot >= 4 || !learned_commands[slot].valid) {
+    IR_Data_t learned;
+    
+    if (IR_store_get(&learned_commands, slot, &learned) != IR_SUCCESS) {
         return;  // Invalid slot or no command learned
     }
     
     // Reconfigure transmitter for the learned protocol
-    IR_transmitter_init(&ir_transmitter, learned_commands[slot].protocol, &tx_hal);
+    IR_transmitter_init(&ir_transmitter, learned.protocol, &tx_hal);
+    IR_transmitter_set_notify(&ir_transmitter, transmit_notify);
     
     // Send the learned command
     PORTB |= _BV(STATUS_LED_PIN);  // LED on during transmission
     
-    IR_transmitter_send(&ir_transmitter, 
-                       learned_commands[slot].address, 
-                       learned_commands[slot].command);
+    IR_transmitter_send(&ir_transmitter, learned.address, learned.command);
     
     while (IR_transmitter_is_busy(&ir_transmitter)) {
         _delay_ms(1);
     }
     
     PORTB &= ~_BV(STATUS_LED_PIN);  // LED off
+    
+#if CLONE_VERIFY_ECHO
+    // Echo decoded within the guard time (the decoder only knows NEC)
+    while (IR_decoder_echo_status(&ir_decoder) == IR_ECHO_PENDING) {
+        _delay_ms(1);
+    }
+    if (learned.protocol == IR_PROTOCOL_NEC && IR_decoder_echo_status(&ir_decoder) != IR_ECHO_MATCH) {
+        for (uint8_t i = 0; i < 6; i++) {
+            PORTB ^= _BV(STATUS_LED_PIN);
+            _delay_ms(50);
+        }
+    }
+#endif
 }
 
 // Interrupt handlers
 ISR(INT0_vect)
 {
-    uint8_t pin_value = ir_decoder.hal.pin_read();
+    uint8_t pin_value = attiny13_pin_read();
     IR_decoder_process(&ir_decoder, pin_value);
 }
 
-ISR(TIM0_COMPA_vect)
+ISR(TIM0_OVF_vect)
 {
-    IR_decoder_timeout_handler(&ir_decoder);
+    attiny13_timer_interrupt();
+    IR_decoder_timeout_advance(&ir_decoder, ATTINY13_OVERFLOW_IR_TICKS);
 }
 
 int main(void)
@@ -144,6 +181,9 @@ int main(void)
     
     while(1)
     {
+        // One EEPROM byte per pass while learned commands are pending
+        IR_store_service(&learned_commands);
+        
         // Check learn button
         if (!(PINB & _BV(LEARN_BUTTON_PIN))) {
             _delay_ms(50);  // Debounce
@@ -1,22 +1,28 @@
 /**
  * protocol_demo.c - Demonstration of multiple IR protocol support
- * 
- * Shows how to use different IR protocols with the generic decoder
+ *
+ * Shows how to receive several IR protocols on one pin: the leader mark
+ * selects which protocol decoders run for each frame. Runs on the STM32F401
+ * port (PA0, EXTI0 and TIM2 as in main_stm32.c), which has the RAM for a
+ * decoder per protocol; build it with `make -f Makefile.stm32 protocol_demo`
+ * in MCU_Usage/STM32F401
  * Author: Nghia Taarabt
  */
 
-#include <avr/io.h>
-#include <avr/interrupt.h>
-#include <util/delay.h>
-#include "../ir_decoder.h"
-#include "../attiny13_hal.h"
+#include "stm32f4xx.h"
+#include "ir_dispatch.h"
+#include "stm32f401_hal.h"
 
-// Example: Auto-detect protocol by trying multiple decoders
+// Example: Auto-detect protocol from the leader mark
 #define MAX_PROTOCOLS 5
 
-static IR_Decoder_t decoders[MAX_PROTOCOLS];
+// Timeout handler period: SysTick every 1ms
+#define DEMO_TIMEOUT_PERIOD_US  (1000U)
+
+static IR_Dispatch_t receiver;
 static IR_HAL_t ir_hal;
-static IR_Protocol_t protocols[] = {
+static uint32_t last_edge_us;
+static const IR_Protocol_t protocols[MAX_PROTOCOLS] = {
     IR_PROTOCOL_NEC,
     IR_PROTOCOL_SAMSUNG,
     IR_PROTOCOL_SONY,
@@ -24,90 +30,99 @@ static IR_Protocol_t protocols[] = {
     IR_PROTOCOL_JVC
 };
 
-void init_multi_protocol_decoder(void)
-{
-    attiny13_hal_init(&ir_hal);
-    
-    // Initialize decoders for different protocols
-    for(uint8_t i = 0; i < MAX_PROTOCOLS; i++)
-    {
-        IR_decoder_init(&decoders[i], protocols[i], &ir_hal);
-    }
+/**
+ * Decoder ticks since the last edge, from the free-running TIM2 microsecond clock
+ */
+static uint16_t demo_timer_get_count(void) {
+    uint32_t elapsed = stm32f401_timer_get_time() - last_edge_us;
+    return (elapsed > IR_TICKS_MAX_US) ? 0xFFFFU : IR_US_TO_TICKS(elapsed);
+}
+
+/**
+ * Start the next interval at this edge; TIM2 itself is never reset
+ */
+static void demo_timer_reset_count(void) {
+    last_edge_us = stm32f401_timer_get_time();
 }
 
-void process_multi_protocol_ir(uint8_t pin_value)
-{
+void init_multi_protocol_decoder(void) {
+    stm32f401_hardware_init();
+
+    // The dispatcher reads the edge timer once per edge, in decoder ticks
+    ir_hal.timer_start = stm32f401_timer_start;
+    ir_hal.timer_stop = stm32f401_timer_stop;
+    ir_hal.timer_get_count = demo_timer_get_count;
+    ir_hal.timer_reset_count = demo_timer_reset_count;
+    ir_hal.pin_read = stm32f401_pin_read;
+
+    // One decoder per protocol, fed only when the leader matches
+    IR_dispatch_init(&receiver, protocols, MAX_PROTOCOLS, &ir_hal);
+
+    SysTick_Config(SystemCoreClock / (1000000U / DEMO_TIMEOUT_PERIOD_US));
+}
+
+void process_multi_protocol_ir(void) {
     IR_Data_t ir_data;
-    
-    // Try all protocol decoders
-    for(uint8_t i = 0; i < MAX_PROTOCOLS; i++)
-    {
-        IR_decoder_process(&decoders[i], pin_value);
-        
-        // Check if this decoder got valid data
-        if(IR_decoder_get_data(&decoders[i], &ir_data) == IR_SUCCESS)
-        {
-            // Found valid data with this protocol
-            // Reset other decoders to prevent false positives
-            for(uint8_t j = 0; j < MAX_PROTOCOLS; j++)
-            {
-                if(j != i)
-                    IR_decoder_reset(&decoders[j]);
-            }
-            
-            // Process the command based on detected protocol
-            switch(ir_data.protocol)
-            {
-                case IR_PROTOCOL_NEC:
-                    // Handle NEC protocol commands
-                    break;
-                case IR_PROTOCOL_SAMSUNG:
-                    // Handle Samsung protocol commands
-                    break;
-                case IR_PROTOCOL_SONY:
-                    // Handle Sony protocol commands
-                    break;
-                case IR_PROTOCOL_LG:
-                    // Handle LG protocol commands
-                    break;
-                case IR_PROTOCOL_JVC:
-                    // Handle JVC protocol commands
-                    break;
-                default:
-                    break;
-            }
-            break; // Exit loop once we found valid data
-        }
+
+    if (IR_dispatch_get_data(&receiver, &ir_data) != IR_SUCCESS)
+        return;
+
+    // Process the command based on detected protocol
+    switch (ir_data.protocol) {
+        case IR_PROTOCOL_NEC:
+            // Handle NEC protocol commands
+            break;
+        case IR_PROTOCOL_SAMSUNG:
+            // Handle Samsung protocol commands
+            break;
+        case IR_PROTOCOL_SONY:
+            // Handle Sony protocol commands
+            break;
+        case IR_PROTOCOL_LG:
+            // Handle LG protocol commands
+            break;
+        case IR_PROTOCOL_JVC:
+            // Handle JVC protocol commands
+            break;
+        default:
+            break;
     }
 }
 
-ISR(INT0_vect)
-{
-    uint8_t pin_value = attiny13_pin_read();
-    process_multi_protocol_ir(pin_value);
-}
+/**
+ * EXTI0 Interrupt Handler - IR Pin Change
+ */
+void EXTI0_IRQHandler(void) {
+    if (EXTI->PR & EXTI_PR_PR0) {
+        EXTI->PR |= EXTI_PR_PR0;                    // Clear interrupt flag
 
-ISR(TIM0_COMPA_vect)
-{
-    attiny13_timer_interrupt();
-    
-    // Handle timeouts for all decoders
-    for(uint8_t i = 0; i < MAX_PROTOCOLS; i++)
-    {
-        IR_decoder_timeout_handler(&decoders[i]);
+        stm32f401_ir_pin_interrupt();
+        IR_dispatch_process(&receiver, stm32f401_pin_read());
     }
 }
 
-int main(void)
-{
-    // Initialize hardware and multi-protocol decoder
-    DDRB |= _BV(PB0) | _BV(PB2) | _BV(PB3) | _BV(PB4); // LED pins
+/**
+ * TIM2 Interrupt Handler - quiet line compare, timeouts run from SysTick
+ */
+void TIM2_IRQHandler(void) {
+    stm32f401_timer_interrupt();
+}
+
+/**
+ * SysTick Handler - timeouts for the decoders of the frame in progress
+ */
+void SysTick_Handler(void) {
+    IR_dispatch_timeout_advance(&receiver, IR_US_TO_TICKS(DEMO_TIMEOUT_PERIOD_US));
+}
+
+int main(void) {
+    SystemCoreClockUpdate();
     init_multi_protocol_decoder();
-    
-    while(1)
-    {
-        _delay_ms(10);
+
+    while (1) {
+        process_multi_protocol_ir();
+        __WFI();                                    // Every frame ends in an interrupt
     }
-    
+
     return 0;
 }
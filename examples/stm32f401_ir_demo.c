@@ -68,14 +68,14 @@ int main(void) {
             uart_send_string("\r\n  Command: 0x");
             uart_send_hex(ir_data.command);
             uart_send_string("\r\n  Repeat: ");
-            uart_send_string(ir_data.repeat ? "YES" : "NO");
+            uart_send_string((ir_data.flags & IR_DATA_FLAG_REPEAT) ? "YES" : "NO");
             uart_send_string("\r\n\r\n");
         }
         
-        // Handle timeout
-        if (stm32f401_ir_timeout > IR_TIMEOUT_VALUE) {
-            IR_decoder_timeout_handler(&ir_decoder);
+        // Handle timeout (TIM2 CC2: line quiet for IR_TIMEOUT_VALUE us)
+        if (stm32f401_ir_timeout) {
             stm32f401_ir_timeout = 0;
+            IR_decoder_expire(&ir_decoder);
         }
         
         // Small delay
@@ -99,7 +99,7 @@ void EXTI0_IRQHandler(void) {
 }
 
 /**
- * TIM2 Interrupt Handler - Timer Overflow
+ * TIM2 Interrupt Handler - IR Timeout
  */
 void TIM2_IRQHandler(void) {
     stm32f401_timer_interrupt();
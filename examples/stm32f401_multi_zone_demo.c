@@ -0,0 +1,110 @@
+/**
+ * stm32f401_multi_zone_demo.c - STM32F401 Multi-zone IR Receiver Demo
+ *
+ * Four IR receivers (one per room zone) on PB0..PB3 decoded by one
+ * IR_Multi_t instance. Edge ISRs only timestamp against TIM2; all
+ * decoding runs in IR_multi_service() from the main loop.
+ * Author: Nghia Taarabt
+ */
+
+#include "stm32f4xx.h"
+#include "ir_multi.h"
+#include "stm32f401_hal.h"
+#include "stm32f401_uart.h"
+
+#define ZONE_COUNT  4
+
+// Global multi-channel decoder instance
+IR_Multi_t ir_zones;
+IR_HAL_t ir_hal;
+
+// Debug output through the USART2 DMA ring (stm32f401_uart.c)
+static void uart_send_string(const char* str);
+static void uart_send_hex(uint32_t value);
+
+int main(void) {
+    SystemCoreClockUpdate();
+
+    // PA2 (TX) and PA3 (RX) as AF7 for USART2, then the DMA ring on top
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
+    GPIOA->MODER |= (2U << (2 * 2)) | (2U << (3 * 2));
+    GPIOA->AFR[0] |= (7U << (2 * 4)) | (7U << (3 * 4));
+    stm32f401_uart_init(115200);
+    uart_send_string("STM32F401 Multi-zone IR Demo\r\n");
+
+    // Receivers on PB0..PB3, one shared TIM2 time base
+    stm32f401_multi_hardware_init(ZONE_COUNT);
+    stm32f401_multi_hal_init(&ir_hal);
+    IR_multi_init(&ir_zones, ZONE_COUNT, IR_PROTOCOL_NEC, &ir_hal);
+
+    while (1) {
+        uint8_t ready = IR_multi_service(&ir_zones);
+
+        for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+            IR_Data_t ir_data;
+
+            if ((ready & (1U << zone)) && IR_multi_get_data(&ir_zones, zone, &ir_data) == IR_SUCCESS) {
+                uart_send_string("Zone ");
+                uart_send_hex(zone);
+                uart_send_string(": Address 0x");
+                uart_send_hex(ir_data.address);
+                uart_send_string(" Command 0x");
+                uart_send_hex(ir_data.command);
+                uart_send_string("\r\n");
+            }
+        }
+    }
+}
+
+/**
+ * EXTI0..EXTI3 Interrupt Handlers - one per zone
+ */
+void EXTI0_IRQHandler(void) {
+    stm32f401_multi_pin_interrupt(&ir_zones, 0);
+}
+
+void EXTI1_IRQHandler(void) {
+    stm32f401_multi_pin_interrupt(&ir_zones, 1);
+}
+
+void EXTI2_IRQHandler(void) {
+    stm32f401_multi_pin_interrupt(&ir_zones, 2);
+}
+
+void EXTI3_IRQHandler(void) {
+    stm32f401_multi_pin_interrupt(&ir_zones, 3);
+}
+
+/**
+ * DMA1 Stream6 Interrupt Handler - UART transmit run complete
+ */
+void DMA1_Stream6_IRQHandler(void) {
+    stm32f401_uart_dma_interrupt();
+}
+
+/**
+ * Queue string for UART2, waiting only while the ring is full
+ */
+static void uart_send_string(const char* str) {
+    while (*str) {
+        if (stm32f401_uart_write(str, 1)) {
+            str++;
+        }
+    }
+}
+
+/**
+ * Queue hex value for UART2
+ */
+static void uart_send_hex(uint32_t value) {
+    char hex_chars[] = "0123456789ABCDEF";
+    char buffer[9];
+    buffer[8] = '\0';
+
+    for (int i = 7; i >= 0; i--) {
+        buffer[i] = hex_chars[value & 0xF];
+        value >>= 4;
+    }
+
+    uart_send_string(buffer);
+}
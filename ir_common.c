@@ -8,8 +8,13 @@
 
 #include "ir_common.h"
 
+// Timer counts of n half PPM slots
+#define IR_PPM_HALF_SLOTS(n)    IR_US_TO_TICKS((uint32_t)IR_PPM_SLOT_US * (n) / 2U)
+
 // Protocol timing definitions (in timer counts for 38.222kHz)
-static const IR_Protocol_Info_t protocol_info_table[IR_PROTOCOL_COUNT] = {
+// Only protocols built in have an entry, so the table is searched by type
+static const IR_Protocol_Info_t protocol_info_table[] = {
+#if IR_ENABLE_NEC
     // NEC Protocol
     {
         .type = IR_PROTOCOL_NEC,
@@ -27,6 +32,8 @@ static const IR_Protocol_Info_t protocol_info_table[IR_PROTOCOL_COUNT] = {
             .carrier_freq = 38000
         }
     },
+#endif
+#if IR_ENABLE_RC5
     // RC5 Protocol
     {
         .type = IR_PROTOCOL_RC5,
@@ -42,6 +49,8 @@ static const IR_Protocol_Info_t protocol_info_table[IR_PROTOCOL_COUNT] = {
             .carrier_freq = 36000
         }
     },
+#endif
+#if IR_ENABLE_SONY
     // Sony SIRC Protocol
     {
         .type = IR_PROTOCOL_SONY,
@@ -57,6 +66,8 @@ static const IR_Protocol_Info_t protocol_info_table[IR_PROTOCOL_COUNT] = {
             .carrier_freq = 40000
         }
     },
+#endif
+#if IR_ENABLE_RC6
     // RC6 Protocol
     {
         .type = IR_PROTOCOL_RC6,
@@ -72,6 +83,8 @@ static const IR_Protocol_Info_t protocol_info_table[IR_PROTOCOL_COUNT] = {
             .carrier_freq = 36000
         }
     },
+#endif
+#if IR_ENABLE_SAMSUNG
     // Samsung Protocol
     {
         .type = IR_PROTOCOL_SAMSUNG,
@@ -87,6 +100,8 @@ static const IR_Protocol_Info_t protocol_info_table[IR_PROTOCOL_COUNT] = {
             .carrier_freq = 38000
         }
     },
+#endif
+#if IR_ENABLE_LG
     // LG Protocol
     {
         .type = IR_PROTOCOL_LG,
@@ -102,6 +117,8 @@ static const IR_Protocol_Info_t protocol_info_table[IR_PROTOCOL_COUNT] = {
             .carrier_freq = 38000
         }
     },
+#endif
+#if IR_ENABLE_PANASONIC
     // Panasonic Protocol
     {
         .type = IR_PROTOCOL_PANASONIC,
@@ -117,6 +134,8 @@ static const IR_Protocol_Info_t protocol_info_table[IR_PROTOCOL_COUNT] = {
             .carrier_freq = 37000
         }
     },
+#endif
+#if IR_ENABLE_JVC
     // JVC Protocol
     {
         .type = IR_PROTOCOL_JVC,
@@ -132,6 +151,8 @@ static const IR_Protocol_Info_t protocol_info_table[IR_PROTOCOL_COUNT] = {
             .carrier_freq = 38000
         }
     },
+#endif
+#if IR_ENABLE_DENON
     // Denon Protocol
     {
         .type = IR_PROTOCOL_DENON,
@@ -146,15 +167,37 @@ static const IR_Protocol_Info_t protocol_info_table[IR_PROTOCOL_COUNT] = {
             .timeout = 5500,
             .carrier_freq = 38000
         }
+    },
+#endif
+#if IR_ENABLE_PPM
+    // Board-to-board PPM: two bits per mark-to-mark period of 2..5 slots,
+    // windows follow IR_PPM_SLOT_US
+    {
+        .type = IR_PROTOCOL_PPM,
+        .name = "PPM",
+        .timing = {
+            .start_burst_min = IR_PPM_HALF_SLOTS(12), .start_burst_max = IR_PPM_HALF_SLOTS(20), // 8 slots burst
+            .start_space_min = IR_PPM_HALF_SLOTS(6), .start_space_max = IR_PPM_HALF_SLOTS(10),  // 4 slots space
+            .bit_burst_min = IR_PPM_HALF_SLOTS(1), .bit_burst_max = IR_PPM_HALF_SLOTS(4),       // 1 slot burst
+            .bit_0_space_min = IR_PPM_HALF_SLOTS(1), .bit_0_space_max = IR_PPM_HALF_SLOTS(3),   // 1 slot space (symbol 0)
+            .bit_1_space_min = IR_PPM_HALF_SLOTS(7), .bit_1_space_max = IR_PPM_HALF_SLOTS(9),   // 4 slots space (symbol 3)
+            .stop_burst_min = IR_PPM_HALF_SLOTS(1), .stop_burst_max = IR_PPM_HALF_SLOTS(4),     // 1 slot stop
+            .bit_count = 32,
+            .timeout = 1000,
+            .carrier_freq = 38000
+        }
     }
+#endif
 };
 
 const IR_Protocol_Info_t* IR_get_protocol_info(IR_Protocol_t protocol)
 {
-    if (protocol >= IR_PROTOCOL_COUNT) {
-        return NULL;
+    for (uint8_t i = 0; i < sizeof(protocol_info_table) / sizeof(protocol_info_table[0]); i++) {
+        if (protocol_info_table[i].type == protocol) {
+            return &protocol_info_table[i];
+        }
     }
-    return &protocol_info_table[protocol];
+    return NULL;
 }
 
 const char* IR_get_protocol_name(IR_Protocol_t protocol)
@@ -170,127 +213,373 @@ uint32_t IR_get_carrier_frequency(IR_Protocol_t protocol)
 }
 
 // Data encoding functions
+#if IR_ENABLE_NEC
 uint32_t IR_encode_nec_data(uint8_t address, uint8_t command)
 {
     return ((uint32_t)address) | 
-           (((uint32_t)(~address)) << 8) | 
+           (((uint32_t)(uint8_t)(~address)) << 8) | 
            (((uint32_t)command) << 16) | 
-           (((uint32_t)(~command)) << 24);
+           (((uint32_t)(uint8_t)(~command)) << 24);
 }
+#endif
 
+#if IR_ENABLE_SONY
 uint32_t IR_encode_sony_data(uint8_t address, uint8_t command)
 {
     return ((uint32_t)command) | (((uint32_t)address) << 7);
 }
+#endif
 
+#if IR_ENABLE_RC5
 uint32_t IR_encode_rc5_data(uint8_t address, uint8_t command)
 {
     return (((uint32_t)address) << 6) | ((uint32_t)command) | 0x3000;
 }
+#endif
 
+#if IR_ENABLE_SAMSUNG
 uint32_t IR_encode_samsung_data(uint8_t address, uint8_t command)
 {
     return ((uint32_t)address) | 
            (((uint32_t)address) << 8) | 
            (((uint32_t)command) << 16) | 
-           (((uint32_t)(~command)) << 24);
+           (((uint32_t)(uint8_t)(~command)) << 24);
 }
+#endif
 
+#if IR_ENABLE_LG
 uint32_t IR_encode_lg_data(uint8_t address, uint8_t command)
 {
     return ((uint32_t)address) | (((uint32_t)command) << 8) | 
            (((uint32_t)IR_calculate_checksum(((uint32_t)address) | (((uint32_t)command) << 8))) << 16);
 }
+#endif
 
+#if IR_ENABLE_PANASONIC
 uint32_t IR_encode_panasonic_data(uint8_t address, uint8_t command)
 {
     return 0x40040100UL | (((uint32_t)address) << 8) | (((uint32_t)command) << 16);
 }
+#endif
 
+#if IR_ENABLE_JVC
 uint32_t IR_encode_jvc_data(uint8_t address, uint8_t command)
 {
     return ((uint32_t)address) | (((uint32_t)command) << 8);
 }
+#endif
 
+#if IR_ENABLE_RC6
 uint32_t IR_encode_rc6_data(uint8_t address, uint8_t command)
 {
     return 0x100000UL | (((uint32_t)address) << 8) | ((uint32_t)command);
 }
+#endif
 
+#if IR_ENABLE_DENON
 uint32_t IR_encode_denon_data(uint8_t address, uint8_t command)
 {
     return ((uint32_t)address) | (((uint32_t)command) << 5);
 }
+#endif
+
+#if IR_ENABLE_PPM
+uint32_t IR_encode_ppm_data(uint8_t address, uint8_t command)
+{
+    // NEC byte layout: the inverses let the decoder reject bad symbols
+    return ((uint32_t)address) | 
+           (((uint32_t)(uint8_t)(~address)) << 8) | 
+           (((uint32_t)command) << 16) | 
+           (((uint32_t)(uint8_t)(~command)) << 24);
+}
+#endif
 
 // Data decoding functions
+#if IR_ENABLE_NEC
 void IR_decode_nec_data(uint32_t raw_data, uint8_t* address, uint8_t* command)
 {
     *address = (uint8_t)(raw_data & 0xFF);
     *command = (uint8_t)((raw_data >> 16) & 0xFF);
 }
+#endif
 
+#if IR_ENABLE_SONY
 void IR_decode_sony_data(uint32_t raw_data, uint8_t* address, uint8_t* command)
 {
     *command = (uint8_t)(raw_data & 0x7F);
     *address = (uint8_t)((raw_data >> 7) & 0x1F);
 }
+#endif
 
+#if IR_ENABLE_RC5
 void IR_decode_rc5_data(uint32_t raw_data, uint8_t* address, uint8_t* command)
 {
     *command = (uint8_t)(raw_data & 0x3F);
     *address = (uint8_t)((raw_data >> 6) & 0x1F);
 }
+#endif
 
+#if IR_ENABLE_SAMSUNG
 void IR_decode_samsung_data(uint32_t raw_data, uint8_t* address, uint8_t* command)
 {
     *address = (uint8_t)(raw_data & 0xFF);
     *command = (uint8_t)((raw_data >> 16) & 0xFF);
 }
+#endif
 
+#if IR_ENABLE_LG
 void IR_decode_lg_data(uint32_t raw_data, uint8_t* address, uint8_t* command)
 {
     *address = (uint8_t)(raw_data & 0xFF);
     *command = (uint8_t)((raw_data >> 8) & 0xFF);
 }
+#endif
 
+#if IR_ENABLE_PANASONIC
 void IR_decode_panasonic_data(uint32_t raw_data, uint8_t* address, uint8_t* command)
 {
     *address = (uint8_t)((raw_data >> 8) & 0xFF);
     *command = (uint8_t)((raw_data >> 16) & 0xFF);
 }
+#endif
 
+#if IR_ENABLE_JVC
 void IR_decode_jvc_data(uint32_t raw_data, uint8_t* address, uint8_t* command)
 {
     *address = (uint8_t)(raw_data & 0xFF);
     *command = (uint8_t)((raw_data >> 8) & 0xFF);
 }
+#endif
 
+#if IR_ENABLE_RC6
 void IR_decode_rc6_data(uint32_t raw_data, uint8_t* address, uint8_t* command)
 {
     *command = (uint8_t)(raw_data & 0xFF);
     *address = (uint8_t)((raw_data >> 8) & 0xFF);
 }
+#endif
 
+#if IR_ENABLE_DENON
 void IR_decode_denon_data(uint32_t raw_data, uint8_t* address, uint8_t* command)
 {
     *address = (uint8_t)(raw_data & 0x1F);
     *command = (uint8_t)((raw_data >> 5) & 0x3FF);
 }
+#endif
+
+#if IR_ENABLE_PPM
+void IR_decode_ppm_data(uint32_t raw_data, uint8_t* address, uint8_t* command)
+{
+    *address = (uint8_t)(raw_data & 0xFF);
+    *command = (uint8_t)((raw_data >> 16) & 0xFF);
+}
+#endif
+
+void IR_decode_protocol_data(IR_Protocol_t protocol, uint32_t raw_data, uint8_t* address, uint8_t* command)
+{
+    switch (protocol) {
+#if IR_ENABLE_NEC
+        case IR_PROTOCOL_NEC:       IR_decode_nec_data(raw_data, address, command); break;
+#endif
+#if IR_ENABLE_RC5
+        case IR_PROTOCOL_RC5:       IR_decode_rc5_data(raw_data, address, command); break;
+#endif
+#if IR_ENABLE_SONY
+        case IR_PROTOCOL_SONY:      IR_decode_sony_data(raw_data, address, command); break;
+#endif
+#if IR_ENABLE_RC6
+        case IR_PROTOCOL_RC6:       IR_decode_rc6_data(raw_data, address, command); break;
+#endif
+#if IR_ENABLE_SAMSUNG
+        case IR_PROTOCOL_SAMSUNG:   IR_decode_samsung_data(raw_data, address, command); break;
+#endif
+#if IR_ENABLE_LG
+        case IR_PROTOCOL_LG:        IR_decode_lg_data(raw_data, address, command); break;
+#endif
+#if IR_ENABLE_PANASONIC
+        case IR_PROTOCOL_PANASONIC: IR_decode_panasonic_data(raw_data, address, command); break;
+#endif
+#if IR_ENABLE_JVC
+        case IR_PROTOCOL_JVC:       IR_decode_jvc_data(raw_data, address, command); break;
+#endif
+#if IR_ENABLE_DENON
+        case IR_PROTOCOL_DENON:     IR_decode_denon_data(raw_data, address, command); break;
+#endif
+#if IR_ENABLE_PPM
+        case IR_PROTOCOL_PPM:       IR_decode_ppm_data(raw_data, address, command); break;
+#endif
+        default:
+#if IR_ENABLE_NEC
+            IR_decode_nec_data(raw_data, address, command);
+#else
+            *address = 0;
+            *command = 0;
+#endif
+            break;
+    }
+}
+
+// Extended data decoding
+void IR_decode_data_ext(IR_Protocol_t protocol, uint32_t raw_data, IR_Data_Ext_t* data)
+{
+    uint8_t address8;
+    uint8_t command8;
+    
+    data->raw_data = raw_data;
+    data->protocol = protocol;
+    data->variant = 0;
+    data->flags = 0;
+    
+    switch (protocol) {
+#if IR_ENABLE_NEC
+        case IR_PROTOCOL_NEC:
+            // Extended NEC sends a 16-bit address in place of address + inverse
+            if ((uint8_t)(raw_data ^ (raw_data >> 8)) != 0xFFU) {
+                data->address = (uint16_t)(raw_data & 0xFFFF);
+                data->variant |= IR_VARIANT_NEC_EXTENDED;
+            } else {
+                data->address = (uint16_t)(raw_data & 0xFF);
+            }
+            data->command = (uint16_t)((raw_data >> 16) & 0xFF);
+            break;
+#endif
+        
+#if IR_ENABLE_SAMSUNG
+        case IR_PROTOCOL_SAMSUNG:
+            // 16-bit custom code
+            data->address = (uint16_t)(raw_data & 0xFFFF);
+            data->command = (uint16_t)((raw_data >> 16) & 0xFF);
+            break;
+#endif
+        
+#if IR_ENABLE_DENON
+        case IR_PROTOCOL_DENON:
+            // 5-bit address, 10-bit command
+            data->address = (uint16_t)(raw_data & 0x1F);
+            data->command = (uint16_t)((raw_data >> 5) & 0x3FF);
+            break;
+#endif
+        
+        default:
+            IR_decode_protocol_data(protocol, raw_data, &address8, &command8);
+            data->address = address8;
+            data->command = command8;
+            break;
+    }
+    
+    if (data->address > 0xFF)
+        data->variant |= IR_VARIANT_WIDE_ADDRESS;
+    if (data->command > 0xFF)
+        data->variant |= IR_VARIANT_WIDE_COMMAND;
+}
+
+uint32_t IR_encode_data_ext(IR_Protocol_t protocol, uint16_t address, uint16_t command)
+{
+    switch (protocol) {
+#if IR_ENABLE_NEC
+        case IR_PROTOCOL_NEC:
+            if (address > 0xFF) {
+                return ((uint32_t)address) |
+                       (((uint32_t)(command & 0xFF)) << 16) |
+                       (((uint32_t)(uint8_t)(~command)) << 24);
+            }
+            return IR_encode_nec_data((uint8_t)address, (uint8_t)command);
+#endif
+        
+#if IR_ENABLE_SAMSUNG
+        case IR_PROTOCOL_SAMSUNG:
+            return ((uint32_t)address) |
+                   (((uint32_t)(command & 0xFF)) << 16) |
+                   (((uint32_t)(uint8_t)(~command)) << 24);
+#endif
+        
+#if IR_ENABLE_DENON
+        case IR_PROTOCOL_DENON:
+            return ((uint32_t)(address & 0x1F)) | (((uint32_t)(command & 0x3FF)) << 5);
+#endif
+        
+#if IR_ENABLE_RC5
+        case IR_PROTOCOL_RC5:       return IR_encode_rc5_data((uint8_t)address, (uint8_t)command);
+#endif
+#if IR_ENABLE_SONY
+        case IR_PROTOCOL_SONY:      return IR_encode_sony_data((uint8_t)address, (uint8_t)command);
+#endif
+#if IR_ENABLE_RC6
+        case IR_PROTOCOL_RC6:       return IR_encode_rc6_data((uint8_t)address, (uint8_t)command);
+#endif
+#if IR_ENABLE_LG
+        case IR_PROTOCOL_LG:        return IR_encode_lg_data((uint8_t)address, (uint8_t)command);
+#endif
+#if IR_ENABLE_PANASONIC
+        case IR_PROTOCOL_PANASONIC: return IR_encode_panasonic_data((uint8_t)address, (uint8_t)command);
+#endif
+#if IR_ENABLE_JVC
+        case IR_PROTOCOL_JVC:       return IR_encode_jvc_data((uint8_t)address, (uint8_t)command);
+#endif
+#if IR_ENABLE_PPM
+        case IR_PROTOCOL_PPM:       return IR_encode_ppm_data((uint8_t)address, (uint8_t)command);
+#endif
+        default:
+#if IR_ENABLE_NEC
+            return IR_encode_nec_data((uint8_t)address, (uint8_t)command);
+#else
+            return 0;
+#endif
+    }
+}
 
 // Utility functions
 uint8_t IR_validate_protocol_data(IR_Protocol_t protocol, uint32_t raw_data)
+{
+    return IR_validate_partial_data(protocol, raw_data, 32U);
+}
+
+// Check the redundancy carried by the first bit_count bits (LSB first) of a
+// frame still being received. Bytes not yet complete are not checked.
+uint8_t IR_validate_partial_data(IR_Protocol_t protocol, uint32_t raw_data, uint8_t bit_count)
 {
     switch (protocol) {
+#if IR_ENABLE_NEC
         case IR_PROTOCOL_NEC:
-            // Check if address and command inverse are correct
-            return ((raw_data & 0xFF) == (~((raw_data >> 8) & 0xFF) & 0xFF)) &&
-                   (((raw_data >> 16) & 0xFF) == (~((raw_data >> 24) & 0xFF) & 0xFF));
+            // Address inverse (unless extended NEC is accepted), then command inverse
+#if !IR_ACCEPT_EXTENDED_NEC
+            if (bit_count >= 16U && (uint8_t)(raw_data ^ (raw_data >> 8)) != 0xFFU)
+                return 0;
+#endif
+            if (bit_count >= 32U && (uint8_t)((raw_data >> 16) ^ (raw_data >> 24)) != 0xFFU)
+                return 0;
+            return 1;
+#endif
         
+#if IR_ENABLE_PPM
+        case IR_PROTOCOL_PPM:
+            // Address inverse, then command inverse
+            if (bit_count >= 16U && (uint8_t)(raw_data ^ (raw_data >> 8)) != 0xFFU)
+                return 0;
+            if (bit_count >= 32U && (uint8_t)((raw_data >> 16) ^ (raw_data >> 24)) != 0xFFU)
+                return 0;
+            return 1;
+#endif
+        
+#if IR_ENABLE_SAMSUNG
         case IR_PROTOCOL_SAMSUNG:
-            // Check if command inverse is correct
-            return (((raw_data >> 16) & 0xFF) == (~((raw_data >> 24) & 0xFF) & 0xFF));
+            // Command inverse
+            if (bit_count >= 32U && (uint8_t)((raw_data >> 16) ^ (raw_data >> 24)) != 0xFFU)
+                return 0;
+            return 1;
+#endif
+        
+#if IR_ENABLE_LG
+        case IR_PROTOCOL_LG:
+            // Checksum byte over address and command
+            if (bit_count >= 24U && ((raw_data >> 16) & 0xFF) != IR_calculate_checksum(raw_data & 0xFFFF))
+                return 0;
+            return 1;
+#endif
         
         default:
+            (void)raw_data;
+            (void)bit_count;
             return 1; // Assume valid for other protocols
     }
 }
@@ -303,3 +592,69 @@ uint16_t IR_calculate_checksum(uint32_t data)
     }
     return checksum & 0xFF;
 }
+
+uint8_t IR_crc8(const uint8_t* data, uint16_t length)
+{
+    // CRC-8, polynomial x^8 + x^2 + x + 1 (0x07), init 0: bitwise, no table
+    uint8_t crc = 0;
+    while (length--) {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80U) ? (uint8_t)((crc << 1) ^ 0x07U) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+uint16_t IR_crc16(const uint8_t* data, uint16_t length)
+{
+    // CRC-16/CCITT-FALSE, polynomial 0x1021, init 0xFFFF: bitwise, no table
+    uint16_t crc = 0xFFFFU;
+    while (length--) {
+        crc ^= (uint16_t)(*data++ << 8);
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ 0x1021U) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+void IR_pulse_train_init(IR_Pulse_Train_t* train, uint16_t* buffer, uint16_t capacity, uint32_t carrier_freq)
+{
+    train->durations = buffer;
+    train->capacity = capacity;
+    train->count = 0;
+    train->repeat_index = IR_PULSE_NO_REPEAT;
+    train->carrier_freq = carrier_freq;
+}
+
+int8_t IR_pulse_train_append(IR_Pulse_Train_t* train, uint8_t level, uint32_t duration_us)
+{
+    if (duration_us > IR_PULSE_MAX_US) {
+        duration_us = IR_PULSE_MAX_US;
+    }
+
+    // Even entries are marks: a space before the first mark is silence
+    if (train->count == 0 && level != IR_HIGH) {
+        return IR_SUCCESS;
+    }
+
+    // Same level as the last entry: lengthen it
+    if (train->count > 0 && ((train->count - 1U) & 1U) == (level == IR_HIGH ? 0U : 1U)) {
+        uint32_t total = (uint32_t)train->durations[train->count - 1U] + duration_us;
+        train->durations[train->count - 1U] = (total > IR_PULSE_MAX_US) ? IR_PULSE_MAX_US : (uint16_t)total;
+        return IR_SUCCESS;
+    }
+
+    if (train->count >= train->capacity) {
+        return IR_ERROR;
+    }
+
+    train->durations[train->count++] = (uint16_t)duration_us;
+    return IR_SUCCESS;
+}
+
+int8_t IR_pulse_train_capture(IR_Pulse_Train_t* train, uint8_t pin_value, uint32_t duration_us)
+{
+    return IR_pulse_train_append(train, (pin_value == IR_HIGH) ? IR_LOW : IR_HIGH, duration_us);
+}
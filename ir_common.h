@@ -10,6 +10,8 @@
 #define IR_COMMON_H_
 
 #include <stdint.h>
+#include <stddef.h>
+#include "ir_config.h"
 
 // Return Values
 #define IR_SUCCESS  (0)
@@ -30,9 +32,23 @@ typedef enum {
     IR_PROTOCOL_PANASONIC = 6,
     IR_PROTOCOL_JVC     = 7,
     IR_PROTOCOL_DENON   = 8,
-    IR_PROTOCOL_COUNT   = 9
+    IR_PROTOCOL_PPM     = 9,    // Board-to-board 2-bit pulse position, see IR_PPM_SLOT_US
+    IR_PROTOCOL_COUNT   = 10
 } IR_Protocol_t;
 
+// IR_PROTOCOL_PPM slot (us). Every symbol is a one-slot mark followed by a
+// space of 1..4 slots carrying two bits, LSB pair first. 100us bursts are
+// about four cycles of a 38kHz carrier: ordinary AGC receiver modules want
+// ten or more, so raise this to ~260 unless the receiver passes short bursts
+#ifndef IR_PPM_SLOT_US
+#define IR_PPM_SLOT_US      (100U)
+#endif
+
+// Decoder timing unit: one count is 123 CPU cycles at 9.6MHz (~12.8us, the
+// ATTiny13 Timer0 CTC tick). Backends timestamping in microseconds convert
+// edge intervals with IR_US_TO_TICKS() before IR_decoder_process_duration()
+#define IR_US_TO_TICKS(us)  ((uint16_t)(((uint32_t)(us) * 5U) >> 6))
+
 // IR Data Structure (used by both decoder and transmitter)
 typedef struct {
     uint32_t raw_data;
@@ -40,8 +56,62 @@ typedef struct {
     uint8_t command;
     uint8_t protocol;
     uint8_t valid;
+    uint8_t flags;          // IR_DATA_FLAG_* describing how the frame was received
+#if IR_DECODER_ENABLE_CONFIDENCE
+    uint8_t min_margin;     // Smallest |space - bit threshold| of any data bit (timer counts)
+    uint8_t marginal_bits;  // Data bits decided closer than IR_DECODER_MARGINAL_TICKS
+#endif
+#if IR_DECODER_ENABLE_TIMESTAMPS
+    uint32_t timestamp;     // Leader edge of the frame or repeat (us, IR_HAL_t.timer_get_time)
+#endif
 } IR_Data_t;
 
+// IR_Data_t flags
+#define IR_DATA_FLAG_CORRECTED      (0x01U)     // A single-bit error was repaired from redundancy
+#define IR_DATA_FLAG_LOW_CONFIDENCE (0x02U)     // Marginal or corrected bits: wait for a repeat to confirm
+#define IR_DATA_FLAG_REPEAT         (0x04U)     // Repeat code: address/command repeat the last frame
+
+// Transmission events, IR_TX_Notify_t to IR_decoder_echo()
+#define IR_TX_EVENT_END             (0U)        // Last burst sent
+#define IR_TX_EVENT_FRAME           (1U)        // Frame about to start
+#define IR_TX_EVENT_REPEAT          (2U)        // Repeat code about to start
+
+// Extended decoded frame: full-width fields for protocols carrying more than
+// 8 bits of address or command (extended NEC, Samsung custom code, Denon)
+typedef struct {
+    uint32_t raw_data;
+    uint16_t address;
+    uint16_t command;
+    uint8_t protocol;
+    uint8_t variant;        // IR_VARIANT_* flags
+    uint8_t flags;          // IR_DATA_FLAG_* copied from the decoded frame
+} IR_Data_Ext_t;
+
+// IR_Data_Ext_t variant flags
+#define IR_VARIANT_NEC_EXTENDED     (0x01U)     // 16-bit NEC address, second byte is not an inverse
+#define IR_VARIANT_WIDE_ADDRESS     (0x02U)     // Address does not fit IR_Data_t.address
+#define IR_VARIANT_WIDE_COMMAND     (0x04U)     // Command does not fit IR_Data_t.command
+
+// 8-bit view of an extended frame, identical to what IR_Data_t reports
+static inline uint8_t IR_data_ext_address8(const IR_Data_Ext_t* data) { return (uint8_t)data->address; }
+static inline uint8_t IR_data_ext_command8(const IR_Data_Ext_t* data) { return (uint8_t)data->command; }
+
+// Pulse train: alternating mark and space durations in microseconds,
+// starting with a mark, in a caller-supplied buffer. Durations at or above
+// IR_PULSE_MAX_US are clamped to it. durations[0..repeat_index) is sent
+// once, durations[repeat_index..count) per repeat (Pronto's two sequences):
+// set repeat_index = count before appending the repeat sequence
+typedef struct {
+    uint16_t* durations;
+    uint16_t capacity;
+    uint16_t count;
+    uint16_t repeat_index;  // IR_PULSE_NO_REPEAT: everything is sent once
+    uint32_t carrier_freq;  // Carrier frequency in Hz, 0 = unmodulated
+} IR_Pulse_Train_t;
+
+#define IR_PULSE_MAX_US             (0xFFFFU)
+#define IR_PULSE_NO_REPEAT          (0xFFFFU)
+
 // Common Protocol Timing Structure (in timer counts for decoder, microseconds for transmitter)
 typedef struct {
     uint16_t start_burst_min;
@@ -75,7 +145,8 @@ const IR_Protocol_Info_t* IR_get_protocol_info(IR_Protocol_t protocol);
 const char* IR_get_protocol_name(IR_Protocol_t protocol);
 uint32_t IR_get_carrier_frequency(IR_Protocol_t protocol);
 
-// Data encoding/decoding utilities
+// Data encoding/decoding utilities (per-protocol functions exist only when
+// the protocol's IR_ENABLE_<PROTOCOL> is set, see ir_config.h)
 uint32_t IR_encode_nec_data(uint8_t address, uint8_t command);
 uint32_t IR_encode_sony_data(uint8_t address, uint8_t command);
 uint32_t IR_encode_rc5_data(uint8_t address, uint8_t command);
@@ -85,6 +156,7 @@ uint32_t IR_encode_panasonic_data(uint8_t address, uint8_t command);
 uint32_t IR_encode_jvc_data(uint8_t address, uint8_t command);
 uint32_t IR_encode_rc6_data(uint8_t address, uint8_t command);
 uint32_t IR_encode_denon_data(uint8_t address, uint8_t command);
+uint32_t IR_encode_ppm_data(uint8_t address, uint8_t command);
 
 void IR_decode_nec_data(uint32_t raw_data, uint8_t* address, uint8_t* command);
 void IR_decode_sony_data(uint32_t raw_data, uint8_t* address, uint8_t* command);
@@ -95,10 +167,27 @@ void IR_decode_panasonic_data(uint32_t raw_data, uint8_t* address, uint8_t* comm
 void IR_decode_jvc_data(uint32_t raw_data, uint8_t* address, uint8_t* command);
 void IR_decode_rc6_data(uint32_t raw_data, uint8_t* address, uint8_t* command);
 void IR_decode_denon_data(uint32_t raw_data, uint8_t* address, uint8_t* command);
+void IR_decode_ppm_data(uint32_t raw_data, uint8_t* address, uint8_t* command);
+void IR_decode_protocol_data(IR_Protocol_t protocol, uint32_t raw_data, uint8_t* address, uint8_t* command);
+
+// Full-width decode/encode (extended NEC, 16-bit Samsung custom code, 10-bit Denon command)
+void IR_decode_data_ext(IR_Protocol_t protocol, uint32_t raw_data, IR_Data_Ext_t* data);
+uint32_t IR_encode_data_ext(IR_Protocol_t protocol, uint16_t address, uint16_t command);
 
 // Utility functions
 uint8_t IR_validate_protocol_data(IR_Protocol_t protocol, uint32_t raw_data);
+uint8_t IR_validate_partial_data(IR_Protocol_t protocol, uint32_t raw_data, uint8_t bit_count);
 uint16_t IR_calculate_checksum(uint32_t data);
+uint8_t IR_crc8(const uint8_t* data, uint16_t length);
+uint16_t IR_crc16(const uint8_t* data, uint16_t length);
+
+// Pulse trains (see IR_Pulse_Train_t). IR_pulse_train_capture() follows the
+// decoder's edge convention: pin_value is the new level, duration_us how
+// long the previous one lasted. Leading silence is skipped, equal levels
+// merge; both return IR_ERROR once the buffer is full
+void IR_pulse_train_init(IR_Pulse_Train_t* train, uint16_t* buffer, uint16_t capacity, uint32_t carrier_freq);
+int8_t IR_pulse_train_append(IR_Pulse_Train_t* train, uint8_t level, uint32_t duration_us);
+int8_t IR_pulse_train_capture(IR_Pulse_Train_t* train, uint8_t pin_value, uint32_t duration_us);
 
 // IR Transmitter Protocol Configuration (timing in microseconds)
 typedef struct {
@@ -0,0 +1,159 @@
+/**
+ * ir_config.h - Build-time Configuration for the IR Library
+ *
+ * Feature switches shared by decoder and transmitter. Every option has a
+ * default here and can be overridden from the compiler command line,
+ * e.g. -DIR_DECODER_ENABLE_STATS=1
+ * Author: Nghia Taarabt
+ */
+
+#ifndef IR_CONFIG_H_
+#define IR_CONFIG_H_
+
+// HAL binding (0 = runtime, 1 = compile time)
+// 0: IR_HAL_t / IR_TX_HAL_t function pointers copied into every context
+// 1: the port header IR_HAL_STATIC_HEADER supplies static inline IR_hal_*()
+//    functions that are inlined into ir_decoder.c and ir_transmitter.c; the
+//    hal member is dropped from the contexts and one port is fixed per build
+#ifndef IR_HAL_STATIC
+#define IR_HAL_STATIC               (0)
+#endif
+
+#if IR_HAL_STATIC && !defined(IR_HAL_STATIC_HEADER)
+#error "IR_HAL_STATIC needs IR_HAL_STATIC_HEADER, e.g. -DIR_HAL_STATIC_HEADER='\"attiny13_hal_static.h\"'"
+#endif
+
+// Protocols built in, one bit per IR_Protocol_t (bit 0 = NEC ... bit 9 = PPM).
+// Disabled protocols lose their configs, encode/decode functions, table
+// entries and switch cases. Each IR_ENABLE_<PROTOCOL> can also be set directly.
+// The default leaves out the board-to-board PPM protocol, which no remote
+// sends (0x3FF adds it; ir_link.h has its own PPM coding and needs neither)
+#ifndef IR_PROTOCOL_MASK
+#define IR_PROTOCOL_MASK            (0x1FFU)
+#endif
+
+#ifndef IR_ENABLE_NEC
+#define IR_ENABLE_NEC               ((IR_PROTOCOL_MASK >> 0) & 1U)
+#endif
+#ifndef IR_ENABLE_RC5
+#define IR_ENABLE_RC5               ((IR_PROTOCOL_MASK >> 1) & 1U)
+#endif
+#ifndef IR_ENABLE_SONY
+#define IR_ENABLE_SONY              ((IR_PROTOCOL_MASK >> 2) & 1U)
+#endif
+#ifndef IR_ENABLE_RC6
+#define IR_ENABLE_RC6               ((IR_PROTOCOL_MASK >> 3) & 1U)
+#endif
+#ifndef IR_ENABLE_SAMSUNG
+#define IR_ENABLE_SAMSUNG           ((IR_PROTOCOL_MASK >> 4) & 1U)
+#endif
+#ifndef IR_ENABLE_LG
+#define IR_ENABLE_LG                ((IR_PROTOCOL_MASK >> 5) & 1U)
+#endif
+#ifndef IR_ENABLE_PANASONIC
+#define IR_ENABLE_PANASONIC         ((IR_PROTOCOL_MASK >> 6) & 1U)
+#endif
+#ifndef IR_ENABLE_JVC
+#define IR_ENABLE_JVC               ((IR_PROTOCOL_MASK >> 7) & 1U)
+#endif
+#ifndef IR_ENABLE_DENON
+#define IR_ENABLE_DENON             ((IR_PROTOCOL_MASK >> 8) & 1U)
+#endif
+#ifndef IR_ENABLE_PPM
+#define IR_ENABLE_PPM               ((IR_PROTOCOL_MASK >> 9) & 1U)
+#endif
+
+#if !(IR_ENABLE_NEC || IR_ENABLE_RC5 || IR_ENABLE_SONY || IR_ENABLE_RC6 || IR_ENABLE_SAMSUNG || \
+      IR_ENABLE_LG || IR_ENABLE_PANASONIC || IR_ENABLE_JVC || IR_ENABLE_DENON || IR_ENABLE_PPM)
+#error "No IR protocol enabled: set IR_PROTOCOL_MASK or an IR_ENABLE_<PROTOCOL>"
+#endif
+
+// Accept extended NEC frames, whose second byte is the high address byte
+// instead of the address inverse (0 = reject them at the 16th bit). Enabling it
+// drops the address inverse check; the command inverse is always checked
+#ifndef IR_ACCEPT_EXTENDED_NEC
+#define IR_ACCEPT_EXTENDED_NEC      (0)
+#endif
+
+// Decoder statistics counters (0 = disabled, 1 = enabled)
+// Adds 16 bytes of RAM per IR_Decoder_t and one increment per counted event
+#ifndef IR_DECODER_ENABLE_STATS
+#define IR_DECODER_ENABLE_STATS     (0)
+#endif
+
+// 32-bit timestamps (0 = disabled, 1 = enabled)
+// Adds IR_HAL_t.timer_get_time, a free-running microsecond clock the decoder
+// subtracts instead of resetting a 16-bit counter, IR_Data_t.timestamp, and a
+// check that repeat codes follow their frame within the repeat period
+#ifndef IR_DECODER_ENABLE_TIMESTAMPS
+#define IR_DECODER_ENABLE_TIMESTAMPS    (0)
+#endif
+
+// Frame completion callback (0 = disabled, 1 = enabled)
+// Adds one function pointer per IR_Decoder_t, see IR_decoder_set_callback()
+#ifndef IR_DECODER_ENABLE_CALLBACK
+#define IR_DECODER_ENABLE_CALLBACK  (0)
+#endif
+
+// Own-transmission echo handling (0 = disabled, 1 = enabled)
+// Adds IR_decoder_echo(): the decoder blanks its input, or checks the echo
+// against the frame sent, while the local transmitter is on air plus a guard
+#ifndef IR_DECODER_ENABLE_ECHO
+#define IR_DECODER_ENABLE_ECHO      (0)
+#endif
+
+// Quiet time after an own transmission before edges are decoded again (us):
+// receiver output lag and AGC recovery
+#ifndef IR_DECODER_ECHO_GUARD_US
+#define IR_DECODER_ECHO_GUARD_US    (3000U)
+#endif
+
+// Transmission notification callback (0 = disabled, 1 = enabled)
+// Adds one function pointer per IR_Transmitter_t, see IR_transmitter_set_notify()
+#ifndef IR_TRANSMITTER_ENABLE_NOTIFY
+#define IR_TRANSMITTER_ENABLE_NOTIFY    (0)
+#endif
+
+// Two edges closer than this many timer counts inside a frame are a receiver
+// spike and both are dropped (0 = no filter, e.g. 4 for receivers that chatter
+// on weak signals). Each edge is decoded once the next edge, or the timeout
+// handler, shows no spike follows it; 5-9 bytes per decoder
+#ifndef IR_DECODER_GLITCH_TICKS
+#define IR_DECODER_GLITCH_TICKS     (0U)
+#endif
+
+// Per-frame bit decision confidence in IR_Data_t (0 = disabled, 1 = enabled)
+// Adds a margin computation to every data bit in the edge ISR
+#ifndef IR_DECODER_ENABLE_CONFIDENCE
+#define IR_DECODER_ENABLE_CONFIDENCE    (0)
+#endif
+
+// A data bit whose space lies closer than this many timer counts to the 0/1
+// threshold is counted as marginal and marks the frame IR_DATA_FLAG_LOW_CONFIDENCE
+// (IR_DECODER_ENABLE_CONFIDENCE only)
+#ifndef IR_DECODER_MARGINAL_TICKS
+#define IR_DECODER_MARGINAL_TICKS   (16U)
+#endif
+
+// Single-bit error correction from NEC/Samsung inverse bytes (0 = disabled, 1 = enabled)
+// Records a timing margin per data bit: adds 32 bytes of RAM per IR_Decoder_t
+#ifndef IR_DECODER_ENABLE_CORRECTION
+#define IR_DECODER_ENABLE_CORRECTION    (0)
+#endif
+
+// Cycle profiling of IR_decoder_process() per state/event (0 = disabled, 1 = enabled)
+#ifndef IR_ENABLE_PROFILING
+#define IR_ENABLE_PROFILING         (0)
+#endif
+
+// Profiling time source: 1 = Cortex-M DWT cycle counter, 0 = host mock counter
+#ifndef IR_PROFILE_USE_DWT
+#define IR_PROFILE_USE_DWT          (0)
+#endif
+
+// CMSIS device header providing DWT and the PRIMASK intrinsics (IR_PROFILE_USE_DWT)
+#ifndef IR_PROFILE_DEVICE_HEADER
+#define IR_PROFILE_DEVICE_HEADER    "stm32f4xx.h"
+#endif
+
+#endif /* IR_CONFIG_H_ */
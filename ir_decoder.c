@@ -7,15 +7,111 @@
  */
 
 #include "ir_decoder.h"
+#include "ir_profile.h"
+#include <string.h>
+
+#if IR_HAL_STATIC
+#include IR_HAL_STATIC_HEADER
+#define IR_HAL_TIMER_START(decoder)         IR_hal_timer_start()
+#define IR_HAL_TIMER_GET_COUNT(decoder)     IR_hal_timer_get_count()
+#define IR_HAL_TIMER_RESET_COUNT(decoder)   IR_hal_timer_reset_count()
+#define IR_HAL_HAS_TIMER_GET_TIME(decoder)  (1)
+#define IR_HAL_TIMER_GET_TIME(decoder)      IR_hal_timer_get_time()
+#else
+#define IR_HAL_TIMER_START(decoder)         do { if((decoder)->hal.timer_start) (decoder)->hal.timer_start(); } while(0)
+#define IR_HAL_TIMER_GET_COUNT(decoder)     ((decoder)->hal.timer_get_count ? (decoder)->hal.timer_get_count() : 0U)
+#define IR_HAL_TIMER_RESET_COUNT(decoder)   do { if((decoder)->hal.timer_reset_count) (decoder)->hal.timer_reset_count(); } while(0)
+#define IR_HAL_HAS_TIMER_GET_TIME(decoder)  ((decoder)->hal.timer_get_time != 0)
+#define IR_HAL_TIMER_GET_TIME(decoder)      ((decoder)->hal.timer_get_time())
+#endif
+
+#if IR_DECODER_ENABLE_TIMESTAMPS
+#define IR_FRAME_START(decoder)         ((decoder)->frame_time = (decoder)->edge_time)
+#define IR_REPEAT_IN_PERIOD(decoder)    ((uint32_t)((decoder)->frame_time - (decoder)->last_frame_time) <= IR_REPEAT_PERIOD_MAX_US)
+#else
+#define IR_FRAME_START(decoder)         ((void)0)
+#define IR_REPEAT_IN_PERIOD(decoder)    (1)
+#endif
+
+#if IR_DECODER_ENABLE_STATS
+#define IR_STATS_INC(decoder, counter)  ((decoder)->stats.counter++)
+#else
+#define IR_STATS_INC(decoder, counter)  ((void)0)
+#endif
+
+#if (IR_DECODER_GLITCH_TICKS > 0)
+#define IR_GLITCH_CLEAR(decoder) \
+    do { (decoder)->glitch_level = IR_GLITCH_NONE; (decoder)->glitch_ticks = 0U; } while(0)
+#else
+#define IR_GLITCH_CLEAR(decoder) ((void)0)
+#endif
 
 static int8_t IR_process_protocol_data(IR_Decoder_t* decoder, uint16_t counter, uint8_t value);
 
+#if IR_DECODER_ENABLE_ECHO
+#define IR_ECHO_BLANKED(decoder)        ((decoder)->echo_active && (decoder)->echo_mode == IR_ECHO_MODE_BLANK)
+#define IR_ECHO_TAKEN(decoder, repeat)  IR_decoder_take_echo((decoder), (repeat))
+
+// A frame or repeat completing while our own transmission is on air is its
+// echo: check it against what was sent instead of delivering it
+static uint8_t IR_decoder_take_echo(IR_Decoder_t* decoder, uint8_t repeat)
+{
+    if(!decoder->echo_active || decoder->echo_mode != IR_ECHO_MODE_VERIFY)
+        return 0U;
+    
+    if(decoder->echo_status == IR_ECHO_PENDING)
+    {
+        uint8_t bits = decoder->protocol_config.bit_count;
+        uint32_t mask = (bits < 32U) ? (((uint32_t)1U << bits) - 1U) : 0xFFFFFFFFUL;
+        uint8_t match = repeat ? decoder->echo_repeat
+                               : (!decoder->echo_repeat && ((decoder->data_buffer ^ decoder->echo_raw) & mask) == 0U);
+        decoder->echo_status = match ? IR_ECHO_MATCH : IR_ECHO_MISMATCH;
+    }
+#if IR_DECODER_ENABLE_TIMESTAMPS
+    decoder->last_frame_time = decoder->frame_time;
+#endif
+    return 1U;
+}
+
+// Guard time over: decode normally again
+static void IR_decoder_echo_done(IR_Decoder_t* decoder)
+{
+    if(decoder->echo_status == IR_ECHO_PENDING)
+        decoder->echo_status = IR_ECHO_MISSING;
+    decoder->bit_index = 0U;    // Later repeats do not repeat our frame
+    decoder->echo_guard = 0U;
+    decoder->echo_active = 0U;
+}
+#else
+#define IR_ECHO_BLANKED(decoder)        (0)
+#define IR_ECHO_TAKEN(decoder, repeat)  (0)
+#endif
+
+// Hand a completed frame or repeat to the application
+static void IR_decoder_complete(IR_Decoder_t* decoder)
+{
+#if IR_DECODER_ENABLE_TIMESTAMPS
+    decoder->decoded_data.timestamp = decoder->frame_time;
+    decoder->last_frame_time = decoder->frame_time;
+#endif
+    decoder->decoded_data.valid = 1;
+#if IR_DECODER_ENABLE_CALLBACK
+    // Delivered now, so nothing is left pending for IR_decoder_get_data()
+    if(decoder->on_frame)
+    {
+        decoder->on_frame(decoder, &decoder->decoded_data);
+        decoder->decoded_data.valid = 0;
+    }
+#endif
+}
+
 // Protocol Configuration Functions
+#if IR_ENABLE_NEC
 void IR_get_nec_config(IR_Protocol_Config_t* config)
 {
     // NEC Protocol timing constants (for 38.222kHz carrier)
-    config->start_burst_min = 655U;
-    config->start_burst_max = 815U;
+    config->start_burst_min = IR_NEC_LEADER_MIN;
+    config->start_burst_max = IR_NEC_LEADER_MAX;
     config->start_space_min = 330U;
     config->start_space_max = 360U;
     config->repeat_space_min = 155U;
@@ -24,12 +120,14 @@ void IR_get_nec_config(IR_Protocol_Config_t* config)
     config->timeout = 7400U;
     config->bit_threshold = 90U;  // Threshold for distinguishing 0 and 1
 }
+#endif
 
+#if IR_ENABLE_RC5
 void IR_get_rc5_config(IR_Protocol_Config_t* config)
 {
     // RC5 Protocol timing constants (placeholder - implement as needed)
-    config->start_burst_min = 400U;
-    config->start_burst_max = 600U;
+    config->start_burst_min = IR_RC5_LEADER_MIN;
+    config->start_burst_max = IR_RC5_LEADER_MAX;
     config->start_space_min = 400U;
     config->start_space_max = 600U;
     config->repeat_space_min = 0U;
@@ -38,12 +136,14 @@ void IR_get_rc5_config(IR_Protocol_Config_t* config)
     config->timeout = 5000U;
     config->bit_threshold = 50U;
 }
+#endif
 
+#if IR_ENABLE_SONY
 void IR_get_sony_config(IR_Protocol_Config_t* config)
 {
     // Sony SIRC Protocol timing constants (placeholder - implement as needed)
-    config->start_burst_min = 500U;
-    config->start_burst_max = 700U;
+    config->start_burst_min = IR_SONY_LEADER_MIN;
+    config->start_burst_max = IR_SONY_LEADER_MAX;
     config->start_space_min = 200U;
     config->start_space_max = 400U;
     config->repeat_space_min = 0U;
@@ -52,13 +152,15 @@ void IR_get_sony_config(IR_Protocol_Config_t* config)
     config->timeout = 6000U;
     config->bit_threshold = 60U;
 }
+#endif
 
+#if IR_ENABLE_RC6
 void IR_get_rc6_config(IR_Protocol_Config_t* config)
 {
     // RC6 Protocol timing constants (Philips RC6)
     // Leader: 2.666ms pulse + 0.889ms space
-    config->start_burst_min = 200U;   // ~2.666ms pulse
-    config->start_burst_max = 220U;
+    config->start_burst_min = IR_RC6_LEADER_MIN;
+    config->start_burst_max = IR_RC6_LEADER_MAX;
     config->start_space_min = 65U;    // ~0.889ms space
     config->start_space_max = 75U;
     config->repeat_space_min = 0U;    // No repeat code
@@ -67,13 +169,15 @@ void IR_get_rc6_config(IR_Protocol_Config_t* config)
     config->timeout = 8000U;
     config->bit_threshold = 50U;      // Manchester encoding threshold
 }
+#endif
 
+#if IR_ENABLE_SAMSUNG
 void IR_get_samsung_config(IR_Protocol_Config_t* config)
 {
     // Samsung Protocol timing constants
     // Similar to NEC but with different timing
-    config->start_burst_min = 340U;   // ~4.5ms pulse
-    config->start_burst_max = 380U;
+    config->start_burst_min = IR_SAMSUNG_LEADER_MIN;
+    config->start_burst_max = IR_SAMSUNG_LEADER_MAX;
     config->start_space_min = 340U;   // ~4.5ms space
     config->start_space_max = 380U;
     config->repeat_space_min = 170U;  // ~2.25ms repeat space
@@ -82,13 +186,15 @@ void IR_get_samsung_config(IR_Protocol_Config_t* config)
     config->timeout = 7500U;
     config->bit_threshold = 90U;      // Similar to NEC
 }
+#endif
 
+#if IR_ENABLE_LG
 void IR_get_lg_config(IR_Protocol_Config_t* config)
 {
     // LG Protocol timing constants
     // 9ms pulse + 4.5ms space for start
-    config->start_burst_min = 680U;   // ~9ms pulse
-    config->start_burst_max = 720U;
+    config->start_burst_min = IR_LG_LEADER_MIN;
+    config->start_burst_max = IR_LG_LEADER_MAX;
     config->start_space_min = 340U;   // ~4.5ms space
     config->start_space_max = 360U;
     config->repeat_space_min = 170U;  // ~2.25ms repeat
@@ -97,13 +203,15 @@ void IR_get_lg_config(IR_Protocol_Config_t* config)
     config->timeout = 7000U;
     config->bit_threshold = 85U;
 }
+#endif
 
+#if IR_ENABLE_PANASONIC
 void IR_get_panasonic_config(IR_Protocol_Config_t* config)
 {
     // Panasonic Protocol timing constants
     // 3.5ms pulse + 1.75ms space for start
-    config->start_burst_min = 265U;   // ~3.5ms pulse
-    config->start_burst_max = 285U;
+    config->start_burst_min = IR_PANASONIC_LEADER_MIN;
+    config->start_burst_max = IR_PANASONIC_LEADER_MAX;
     config->start_space_min = 130U;   // ~1.75ms space
     config->start_space_max = 150U;
     config->repeat_space_min = 0U;    // No standard repeat
@@ -112,13 +220,15 @@ void IR_get_panasonic_config(IR_Protocol_Config_t* config)
     config->timeout = 9000U;
     config->bit_threshold = 70U;
 }
+#endif
 
+#if IR_ENABLE_JVC
 void IR_get_jvc_config(IR_Protocol_Config_t* config)
 {
     // JVC Protocol timing constants
     // 8.4ms pulse + 4.2ms space for start
-    config->start_burst_min = 635U;   // ~8.4ms pulse
-    config->start_burst_max = 665U;
+    config->start_burst_min = IR_JVC_LEADER_MIN;
+    config->start_burst_max = IR_JVC_LEADER_MAX;
     config->start_space_min = 315U;   // ~4.2ms space
     config->start_space_max = 335U;
     config->repeat_space_min = 0U;    // No repeat code in first transmission
@@ -127,13 +237,15 @@ void IR_get_jvc_config(IR_Protocol_Config_t* config)
     config->timeout = 6000U;
     config->bit_threshold = 80U;
 }
+#endif
 
+#if IR_ENABLE_DENON
 void IR_get_denon_config(IR_Protocol_Config_t* config)
 {
     // Denon Protocol timing constants (Sharp variant)
     // 3.2ms pulse + 1.6ms space for start
-    config->start_burst_min = 240U;   // ~3.2ms pulse
-    config->start_burst_max = 260U;
+    config->start_burst_min = IR_DENON_LEADER_MIN;
+    config->start_burst_max = IR_DENON_LEADER_MAX;
     config->start_space_min = 120U;   // ~1.6ms space
     config->start_space_max = 140U;
     config->repeat_space_min = 0U;    // No repeat code
@@ -142,6 +254,24 @@ void IR_get_denon_config(IR_Protocol_Config_t* config)
     config->timeout = 5500U;
     config->bit_threshold = 60U;
 }
+#endif
+
+#if IR_ENABLE_PPM
+void IR_get_ppm_config(IR_Protocol_Config_t* config)
+{
+    // Board-to-board PPM, timing scales with IR_PPM_SLOT_US
+    // 8 slot pulse + 4 slot space for start, then 16 two-bit symbols
+    config->start_burst_min = IR_PPM_LEADER_MIN;
+    config->start_burst_max = IR_PPM_LEADER_MAX;
+    config->start_space_min = IR_US_TO_TICKS(IR_PPM_SLOT_US * 3UL);
+    config->start_space_max = IR_US_TO_TICKS(IR_PPM_SLOT_US * 5UL);
+    config->repeat_space_min = 0U;    // No repeat code
+    config->repeat_space_max = 0U;
+    config->bit_count = 32U;          // Address, ~address, command, ~command
+    config->timeout = 1000U;
+    config->bit_threshold = 0U;       // Symbols use IR_ppm_symbol() instead
+}
+#endif
 
 void IR_decoder_init(IR_Decoder_t* decoder, IR_Protocol_t protocol, IR_HAL_t* hal)
 {
@@ -151,43 +281,92 @@ void IR_decoder_init(IR_Decoder_t* decoder, IR_Protocol_t protocol, IR_HAL_t* ha
     decoder->bit_index = 0;
     decoder->data_buffer = 0;
     decoder->timeout_counter = 0;
+    IR_GLITCH_CLEAR(decoder);
     decoder->protocol_type = protocol;
+#if IR_DECODER_ENABLE_TIMESTAMPS
+    decoder->edge_time = 0;
+    decoder->frame_time = 0;
+    decoder->last_frame_time = 0;
+#endif
+#if IR_DECODER_ENABLE_CALLBACK
+    decoder->on_frame = 0;
+#endif
+#if IR_DECODER_ENABLE_ECHO
+    decoder->echo_active = 0;
+    decoder->echo_mode = IR_ECHO_MODE_OFF;
+    decoder->echo_status = IR_ECHO_NONE;
+    decoder->echo_repeat = 0;
+    decoder->echo_guard = 0;
+    decoder->echo_raw = 0;
+#endif
     
+#if IR_HAL_STATIC
+    (void)hal;
+#else
     // Copy HAL function pointers
     decoder->hal = *hal;
+#endif
     
     // Configure protocol-specific parameters
     switch(protocol)
     {
+#if IR_ENABLE_NEC
         case IR_PROTOCOL_NEC:
             IR_get_nec_config(&decoder->protocol_config);
             break;
+#endif
+#if IR_ENABLE_RC5
         case IR_PROTOCOL_RC5:
             IR_get_rc5_config(&decoder->protocol_config);
             break;
+#endif
+#if IR_ENABLE_SONY
         case IR_PROTOCOL_SONY:
             IR_get_sony_config(&decoder->protocol_config);
             break;
+#endif
+#if IR_ENABLE_RC6
         case IR_PROTOCOL_RC6:
             IR_get_rc6_config(&decoder->protocol_config);
             break;
+#endif
+#if IR_ENABLE_SAMSUNG
         case IR_PROTOCOL_SAMSUNG:
             IR_get_samsung_config(&decoder->protocol_config);
             break;
+#endif
+#if IR_ENABLE_LG
         case IR_PROTOCOL_LG:
             IR_get_lg_config(&decoder->protocol_config);
             break;
+#endif
+#if IR_ENABLE_PANASONIC
         case IR_PROTOCOL_PANASONIC:
             IR_get_panasonic_config(&decoder->protocol_config);
             break;
+#endif
+#if IR_ENABLE_JVC
         case IR_PROTOCOL_JVC:
             IR_get_jvc_config(&decoder->protocol_config);
             break;
+#endif
+#if IR_ENABLE_DENON
         case IR_PROTOCOL_DENON:
             IR_get_denon_config(&decoder->protocol_config);
             break;
+#endif
+#if IR_ENABLE_PPM
+        case IR_PROTOCOL_PPM:
+            IR_get_ppm_config(&decoder->protocol_config);
+            break;
+#endif
         default:
+#if IR_ENABLE_NEC
             IR_get_nec_config(&decoder->protocol_config);  // Default to NEC
+#else
+            // Protocol not built in: windows of zero never match a leader
+            memset(&decoder->protocol_config, 0, sizeof(decoder->protocol_config));
+#endif
             break;
     }
     
@@ -197,11 +376,116 @@ void IR_decoder_init(IR_Decoder_t* decoder, IR_Protocol_t protocol, IR_HAL_t* ha
     decoder->decoded_data.command = 0;
     decoder->decoded_data.protocol = protocol;
     decoder->decoded_data.valid = 0;
+    decoder->decoded_data.flags = 0;
+    decoder->frame_flags = 0;
+#if IR_DECODER_ENABLE_CONFIDENCE
+    decoder->decoded_data.min_margin = 0;
+    decoder->decoded_data.marginal_bits = 0;
+    decoder->frame_min_margin = 0xFF;
+    decoder->frame_marginal_bits = 0;
+#endif
+    
+    IR_decoder_reset_stats(decoder);
     
     // Start hardware timer through HAL
-    if(decoder->hal.timer_start)
-        decoder->hal.timer_start();
+    IR_HAL_TIMER_START(decoder);
+}
+
+#if IR_DECODER_ENABLE_CORRECTION
+// Repair a byte and its inverse (the next byte) when exactly one bit position
+// disagrees: flip whichever copy of that bit had the smaller timing margin
+static uint8_t IR_correct_inverse_pair(IR_Decoder_t* decoder, uint8_t byte_index)
+{
+    uint8_t first = byte_index * 8U;
+    uint8_t value = (uint8_t)(decoder->data_buffer >> first);
+    uint8_t inverse = (uint8_t)(decoder->data_buffer >> (first + 8U));
+    uint8_t error = (uint8_t)~(value ^ inverse);
+    
+    // No error, or more than one bit position wrong
+    if(error == 0U || (error & (uint8_t)(error - 1U)) != 0U)
+        return 0U;
+    
+    uint8_t bit = first;
+    while(!(error & 1U))
+    {
+        error >>= 1;
+        bit++;
+    }
+    
+    if(decoder->bit_margin[bit + 8U] < decoder->bit_margin[bit])
+        bit += 8U;
+    
+    decoder->data_buffer ^= ((uint32_t)1U << bit);
+    decoder->frame_flags |= IR_DATA_FLAG_CORRECTED;
+    return 1U;
+}
+#endif
+
+// Margins are only measured for confidence reporting or bit correction; the
+// default build decides bits with a single compare
+#define IR_DECODER_TRACK_MARGIN (IR_DECODER_ENABLE_CONFIDENCE || IR_DECODER_ENABLE_CORRECTION)
+
+#if IR_DECODER_TRACK_MARGIN
+// Fold one decision's distance from its threshold into the frame confidence
+static void IR_note_margin(IR_Decoder_t* decoder, uint16_t distance, uint8_t marginal_ticks)
+{
+    uint8_t margin = (distance > 0xFFU) ? 0xFFU : (uint8_t)distance;
+#if IR_DECODER_ENABLE_CONFIDENCE
+    if(margin < decoder->frame_min_margin)
+        decoder->frame_min_margin = margin;
+    if(margin < marginal_ticks && decoder->frame_marginal_bits < 0xFFU)
+        decoder->frame_marginal_bits++;
+#else
+    (void)marginal_ticks;
+#endif
+#if IR_DECODER_ENABLE_CORRECTION
+    if(decoder->bit_index < 32U)
+        decoder->bit_margin[decoder->bit_index] = margin;
+#endif
+}
+#endif
+
+#if IR_ENABLE_PPM
+// One PPM data edge: a mark end records the mark, a mark start closes the
+// period and shifts in the symbol's two bits
+static int8_t IR_process_ppm_edge(IR_Decoder_t* decoder, uint16_t counter, uint8_t value)
+{
+    if(value == IR_LOW)
+    {
+        decoder->ppm_mark = counter;
+        return IR_SUCCESS;
+    }
+    
+    uint16_t period = decoder->ppm_mark + counter;
+    uint8_t symbol = IR_ppm_symbol(period);
+    if(symbol == IR_PPM_NO_SYMBOL)
+    {
+        IR_STATS_INC(decoder, bit_errors);
+        return IR_ERROR;
+    }
+    
+#if IR_DECODER_TRACK_MARGIN
+    uint16_t low = IR_PPM_BOUNDARY(symbol);
+    uint16_t high = IR_PPM_BOUNDARY(symbol + 1U);
+    IR_note_margin(decoder, (period - low < high - period) ? (period - low) : (high - period), IR_PPM_MARGINAL_TICKS);
+#endif
+    
+    decoder->data_buffer |= ((uint32_t)symbol << decoder->bit_index);
+    decoder->bit_index += 2U;
+    
+    if((decoder->bit_index & 7U) == 0U &&
+       !IR_validate_partial_data(decoder->protocol_type, decoder->data_buffer, decoder->bit_index))
+    {
+        IR_STATS_INC(decoder, validation_errors);
+        return IR_ERROR;
+    }
+    
+    if(decoder->bit_index >= decoder->protocol_config.bit_count)
+        decoder->event = IR_EVENT_HOOK;
+    
+    return IR_SUCCESS;
 }
+#endif
 
 static int8_t IR_process_protocol_data(IR_Decoder_t* decoder, uint16_t counter, uint8_t value)
 {
@@ -212,18 +496,70 @@ static int8_t IR_process_protocol_data(IR_Decoder_t* decoder, uint16_t counter,
     {
         case IR_EVENT_INIT:
             decoder->data_buffer = decoder->bit_index = 0U;
+            decoder->frame_flags = 0U;
+#if IR_DECODER_ENABLE_CONFIDENCE
+            decoder->frame_min_margin = 0xFFU;
+            decoder->frame_marginal_bits = 0U;
+#endif
+#if IR_ENABLE_PPM
+            decoder->ppm_mark = counter;    // End of the first data mark
+#endif
+            decoder->event = IR_EVENT_DATA;
             retval = IR_SUCCESS;
             break;
             
         case IR_EVENT_DATA:
+#if IR_ENABLE_PPM
+            if(decoder->protocol_type == IR_PROTOCOL_PPM)
+            {
+                retval = IR_process_ppm_edge(decoder, counter, value);
+                break;
+            }
+#endif
             if(decoder->bit_index < config->bit_count)
             {
                 if(value == IR_HIGH)
                 {
+                    // A space beyond twice the 0/1 threshold cannot be a data bit
+                    if(counter >= 2U * config->bit_threshold)
+                    {
+                        IR_STATS_INC(decoder, bit_errors);
+                        break;
+                    }
+                    
                     // Use protocol-specific bit threshold
                     uint8_t bit_value = (counter < config->bit_threshold) ? 0U : 1U;
+                    
+#if IR_DECODER_TRACK_MARGIN
+                    // Keep how close the decision was, not just its result
+                    IR_note_margin(decoder, bit_value ? (counter - config->bit_threshold)
+                                                      : (config->bit_threshold - counter),
+                                   IR_DECODER_MARGINAL_TICKS);
+#endif
                     decoder->data_buffer |= ((uint32_t)bit_value << decoder->bit_index++);
                     
+                    // Reject as soon as a completed byte breaks the protocol's
+                    // inverse or checksum instead of waiting for the whole frame
+                    if(((decoder->bit_index & 7U) == 0U || decoder->bit_index == config->bit_count) &&
+                       !IR_validate_partial_data(decoder->protocol_type, decoder->data_buffer, decoder->bit_index))
+                    {
+#if IR_DECODER_ENABLE_CORRECTION
+                        // NEC and Samsung end an inverse pair on this byte boundary
+                        if((decoder->protocol_type == IR_PROTOCOL_NEC || decoder->protocol_type == IR_PROTOCOL_SAMSUNG) &&
+                           decoder->bit_index >= 16U && decoder->bit_index <= 32U &&
+                           IR_correct_inverse_pair(decoder, (uint8_t)(decoder->bit_index / 8U - 2U)) &&
+                           IR_validate_partial_data(decoder->protocol_type, decoder->data_buffer, decoder->bit_index))
+                        {
+                            IR_STATS_INC(decoder, corrections);
+                        }
+                        else
+#endif
+                        {
+                            IR_STATS_INC(decoder, validation_errors);
+                            break;
+                        }
+                    }
+                    
                     if(decoder->bit_index == config->bit_count)
                     {
                         decoder->event = IR_EVENT_HOOK;
@@ -234,19 +570,35 @@ static int8_t IR_process_protocol_data(IR_Decoder_t* decoder, uint16_t counter,
             break;
             
         case IR_EVENT_HOOK:
-            if(value == IR_LOW)
+            // End of the stop burst: the frame is complete now, not on the
+            // next edge, which belongs to whatever follows
+            if(value == IR_LOW && IR_ECHO_TAKEN(decoder, 0U))
             {
                 decoder->event = IR_EVENT_FINISH;
                 retval = IR_SUCCESS;
             }
-            break;
-            
-        case IR_EVENT_FINISH:
-            // Store decoded data
-            decoder->decoded_data.raw_data = decoder->data_buffer;
-            decoder->decoded_data.address = decoder->data_buffer & 0xFF;
-            decoder->decoded_data.command = (decoder->data_buffer >> 16) & 0xFF;
-            decoder->decoded_data.valid = 1;
+            else if(value == IR_LOW)
+            {
+                IR_STATS_INC(decoder, frames_decoded);
+                
+                // Store decoded data
+                decoder->decoded_data.raw_data = decoder->data_buffer;
+                IR_decode_protocol_data(decoder->protocol_type, decoder->data_buffer,
+                                        &decoder->decoded_data.address, &decoder->decoded_data.command);
+#if IR_DECODER_ENABLE_CONFIDENCE
+                decoder->decoded_data.min_margin = decoder->frame_min_margin;
+                decoder->decoded_data.marginal_bits = decoder->frame_marginal_bits;
+                if(decoder->frame_marginal_bits)
+                    decoder->frame_flags |= IR_DATA_FLAG_LOW_CONFIDENCE;
+#endif
+                if(decoder->frame_flags & IR_DATA_FLAG_CORRECTED)
+                    decoder->frame_flags |= IR_DATA_FLAG_LOW_CONFIDENCE;
+                decoder->decoded_data.flags = decoder->frame_flags;
+                IR_decoder_complete(decoder);
+                
+                decoder->event = IR_EVENT_FINISH;
+                retval = IR_SUCCESS;
+            }
             break;
             
         default:
@@ -256,15 +608,59 @@ static int8_t IR_process_protocol_data(IR_Decoder_t* decoder, uint16_t counter,
     return retval;
 }
 
+// Leave the current frame and treat this edge as if the decoder were idle:
+// a burst starting here may be the leader of the next frame, so it is not
+// swallowed on the way back to IR_STATE_IDLE
+static void IR_decoder_restart(IR_Decoder_t* decoder, uint8_t pin_value)
+{
+    decoder->timeout_counter = 0U;
+    
+    if(pin_value == IR_HIGH)
+    {
+        decoder->state = IR_STATE_INIT;
+        decoder->event = IR_EVENT_INIT;
+        IR_FRAME_START(decoder);
+    }
+    else
+    {
+        decoder->state = IR_STATE_IDLE;
+    }
+}
+
 void IR_decoder_process(IR_Decoder_t* decoder, uint8_t pin_value)
 {
+#if IR_DECODER_ENABLE_TIMESTAMPS
+    // 32-bit clock: intervals by subtraction, nothing to reset or extend
+    if(IR_HAL_HAS_TIMER_GET_TIME(decoder))
+    {
+        IR_decoder_process_time(decoder, pin_value, IR_HAL_TIMER_GET_TIME(decoder));
+        return;
+    }
+#endif
+
     // Get counter value through HAL and reset it
-    uint16_t counter = 0;
-    if(decoder->hal.timer_get_count)
-        counter = decoder->hal.timer_get_count();
-    if(decoder->hal.timer_reset_count)
-        decoder->hal.timer_reset_count();
+    uint16_t counter = IR_HAL_TIMER_GET_COUNT(decoder);
+    IR_HAL_TIMER_RESET_COUNT(decoder);
 
+    IR_decoder_process_duration(decoder, pin_value, counter);
+}
+
+#if IR_DECODER_ENABLE_TIMESTAMPS
+void IR_decoder_process_time(IR_Decoder_t* decoder, uint8_t pin_value, uint32_t time_us)
+{
+    // Unsigned difference is exact across the 2^32 wrap; gaps too long for
+    // 16-bit ticks saturate, which every state treats as "very long"
+    uint32_t interval = time_us - decoder->edge_time;
+    decoder->edge_time = time_us;
+
+    IR_decoder_process_duration(decoder, pin_value,
+                                (interval > IR_TICKS_MAX_US) ? 0xFFFFU : IR_US_TO_TICKS(interval));
+}
+#endif
+
+// One edge through the state machine
+static void IR_decoder_edge(IR_Decoder_t* decoder, uint8_t pin_value, uint16_t counter)
+{
     IR_Protocol_Config_t* config = &decoder->protocol_config;
 
     switch(decoder->state)
@@ -273,15 +669,44 @@ void IR_decoder_process(IR_Decoder_t* decoder, uint8_t pin_value)
             if(pin_value == IR_HIGH)
             {
                 decoder->state = IR_STATE_INIT;
+                decoder->event = IR_EVENT_INIT;
+                IR_FRAME_START(decoder);
             }
             break;
             
         case IR_STATE_INIT:
             if(pin_value == IR_LOW)
             {
+                if(decoder->event == IR_EVENT_FINISH)
+                {
+                    // End of the burst trailing a repeat space. Only a repeat
+                    // of a frame that was received completely is reported, and
+                    // only within a repeat period of it: a later one (or any
+                    // after it) belongs to a frame that was missed
+                    if(IR_ECHO_TAKEN(decoder, 1U))
+                    {
+                        // Our own repeat code
+                    }
+                    else if(decoder->bit_index == config->bit_count)
+                    {
+                        if(IR_REPEAT_IN_PERIOD(decoder))
+                        {
+                            decoder->decoded_data.flags = IR_DATA_FLAG_REPEAT;
+                            IR_decoder_complete(decoder);
+                        }
+                        else
+                        {
+                            decoder->bit_index = 0;
+                        }
+                    }
+                    IR_decoder_restart(decoder, pin_value);
+                    break;
+                }
                 if(!(counter > config->start_burst_min && counter < config->start_burst_max))
                 {
-                    decoder->state = IR_STATE_FINISH;
+                    IR_STATS_INC(decoder, leader_errors);
+                    IR_decoder_restart(decoder, pin_value);
+                    break;
                 }
                 decoder->timeout_counter = config->timeout;
             }
@@ -294,11 +719,13 @@ void IR_decoder_process(IR_Decoder_t* decoder, uint8_t pin_value)
                 }
                 else if(counter > config->repeat_space_min && counter < config->repeat_space_max)
                 {
+                    IR_STATS_INC(decoder, repeats);
                     decoder->event = IR_EVENT_FINISH;
                 }
                 else
                 {
-                    decoder->state = IR_STATE_FINISH;
+                    IR_STATS_INC(decoder, leader_errors);
+                    IR_decoder_restart(decoder, pin_value);
                 }
             }
             break;
@@ -306,13 +733,14 @@ void IR_decoder_process(IR_Decoder_t* decoder, uint8_t pin_value)
         case IR_STATE_PROCESS:
             if(IR_SUCCESS != IR_process_protocol_data(decoder, counter, pin_value))
             {
-                decoder->state = IR_STATE_FINISH;
+                decoder->bit_index = 0U;    // Repeats of a dropped frame are not reported
+                IR_decoder_restart(decoder, pin_value);
+            }
+            else if(decoder->event == IR_EVENT_FINISH)
+            {
+                // Frame stored; look for the next leader straight away
+                IR_decoder_restart(decoder, IR_LOW);
             }
-            break;
-            
-        case IR_STATE_FINISH:
-            decoder->state = IR_STATE_IDLE;
-            decoder->timeout_counter = 0U;
             break;
             
         default:
@@ -320,6 +748,85 @@ void IR_decoder_process(IR_Decoder_t* decoder, uint8_t pin_value)
     }
 }
 
+#if (IR_DECODER_GLITCH_TICKS > 0)
+static uint16_t IR_ticks_add(uint16_t a, uint16_t b)
+{
+    return (a > 0xFFFFU - b) ? 0xFFFFU : (uint16_t)(a + b);
+}
+
+// Decode the held edge: the interval after it is known not to be a spike
+static void IR_decoder_release(IR_Decoder_t* decoder)
+{
+    uint8_t level = decoder->glitch_level;
+    
+    if(level == IR_GLITCH_NONE)
+        return;
+    
+    decoder->glitch_level = IR_GLITCH_NONE;
+#if IR_DECODER_ENABLE_TIMESTAMPS
+    uint32_t now = decoder->edge_time;
+    decoder->edge_time = decoder->glitch_time;
+#endif
+    IR_decoder_edge(decoder, level, decoder->glitch_ticks);
+#if IR_DECODER_ENABLE_TIMESTAMPS
+    decoder->edge_time = now;
+#endif
+    decoder->glitch_ticks = 0U;
+}
+
+// Inside a frame each edge is held until the next one shows the interval
+// after it is at least IR_DECODER_GLITCH_TICKS. Two edges closer than that
+// are a spike: both are dropped and their time goes to the edge after them,
+// so the interrupted mark or space reaches the decoder as one interval
+static void IR_decoder_filter(IR_Decoder_t* decoder, uint8_t pin_value, uint16_t counter)
+{
+    if(decoder->glitch_level != IR_GLITCH_NONE)
+    {
+        if(counter < IR_DECODER_GLITCH_TICKS)
+        {
+            decoder->glitch_ticks = IR_ticks_add(decoder->glitch_ticks, counter);
+            decoder->glitch_level = IR_GLITCH_NONE;
+            IR_STATS_INC(decoder, glitches);
+            return;
+        }
+        IR_decoder_release(decoder);
+    }
+    
+    counter = IR_ticks_add(decoder->glitch_ticks, counter);
+    decoder->glitch_ticks = 0U;
+    
+    // Between frames edges go straight through: a spike there is at worst
+    // a leader error
+    if(decoder->state == IR_STATE_IDLE)
+    {
+        IR_decoder_edge(decoder, pin_value, counter);
+        return;
+    }
+    
+    decoder->glitch_level = pin_value;
+    decoder->glitch_ticks = counter;
+    decoder->glitch_age = 0U;
+#if IR_DECODER_ENABLE_TIMESTAMPS
+    decoder->glitch_time = decoder->edge_time;
+#endif
+}
+#endif
+
+void IR_decoder_process_duration(IR_Decoder_t* decoder, uint8_t pin_value, uint16_t counter)
+{
+    // Our own transmission: nothing else can be received through it
+    if(IR_ECHO_BLANKED(decoder))
+        return;
+    
+    IR_PROFILE_BEGIN(decoder);
+#if (IR_DECODER_GLITCH_TICKS > 0)
+    IR_decoder_filter(decoder, pin_value ? IR_HIGH : IR_LOW, counter);
+#else
+    IR_decoder_edge(decoder, pin_value, counter);
+#endif
+    IR_PROFILE_END();
+}
+
 int8_t IR_decoder_get_data(IR_Decoder_t* decoder, IR_Data_t* data)
 {
     if(!decoder->decoded_data.valid)
@@ -331,14 +838,97 @@ int8_t IR_decoder_get_data(IR_Decoder_t* decoder, IR_Data_t* data)
     return IR_SUCCESS;
 }
 
+int8_t IR_decoder_get_data_ext(IR_Decoder_t* decoder, IR_Data_Ext_t* data)
+{
+    IR_Data_t frame;
+    
+    if(IR_decoder_get_data(decoder, &frame) != IR_SUCCESS)
+        return IR_ERROR;
+    
+    // Widen from the raw bits outside the ISR; the 8-bit path pays nothing
+    IR_decode_data_ext((IR_Protocol_t)frame.protocol, frame.raw_data, data);
+    data->flags = frame.flags;
+    
+    return IR_SUCCESS;
+}
+
 void IR_decoder_timeout_handler(IR_Decoder_t* decoder)
 {
-    // Reset counter through HAL
-    if(decoder->hal.timer_get_count && decoder->hal.timer_get_count() > 10000)
-        decoder->state = IR_STATE_IDLE;
-        
-    if(decoder->timeout_counter && --decoder->timeout_counter == 0)
-        decoder->state = IR_STATE_IDLE;
+    IR_decoder_timeout_advance(decoder, 1U);
+}
+
+void IR_decoder_timeout_advance(IR_Decoder_t* decoder, uint16_t ticks)
+{
+#if (IR_DECODER_GLITCH_TICKS > 0)
+    // No edge followed the held one for the glitch width: decode it. A
+    // call's ticks count from the next call, so one right after the edge
+    // does not release it early
+    if(decoder->glitch_level != IR_GLITCH_NONE)
+    {
+        if(decoder->glitch_age >= IR_DECODER_GLITCH_TICKS)
+            IR_decoder_release(decoder);
+        else
+            decoder->glitch_age = IR_ticks_add(decoder->glitch_age, ticks);
+    }
+#endif
+    
+    // No edge for 10000 timer counts (about 128ms): abandon the frame
+    if(IR_HAL_TIMER_GET_COUNT(decoder) > 10000)
+        IR_decoder_expire(decoder);
+    
+    // Timer backends with a slow periodic interrupt account several ticks per call
+    if(decoder->timeout_counter)
+    {
+        if(decoder->timeout_counter <= ticks)
+            IR_decoder_expire(decoder);
+        else
+            decoder->timeout_counter -= ticks;
+    }
+    
+#if IR_DECODER_ENABLE_ECHO
+    if(decoder->echo_guard)
+    {
+        if(decoder->echo_guard <= ticks)
+            IR_decoder_echo_done(decoder);
+        else
+            decoder->echo_guard -= ticks;
+    }
+#endif
+}
+
+void IR_decoder_expire(IR_Decoder_t* decoder)
+{
+    // Line quiet since the held edge: it was no spike, and may end a frame
+#if (IR_DECODER_GLITCH_TICKS > 0)
+    IR_decoder_release(decoder);
+#endif
+    if(decoder->state != IR_STATE_IDLE)
+        IR_STATS_INC(decoder, timeouts);
+    decoder->state = IR_STATE_IDLE;
+    decoder->timeout_counter = 0;
+}
+
+uint8_t IR_decoder_is_idle(IR_Decoder_t* decoder)
+{
+    // Between frames with nothing unread: the edge timer may be stopped
+    // until the next leader edge (not while an echo guard is counting)
+#if IR_DECODER_ENABLE_ECHO
+    if(decoder->echo_active)
+        return 0U;
+#endif
+    return (decoder->state == IR_STATE_IDLE && !decoder->decoded_data.valid && !IR_DECODER_HOLDING(decoder)) ? 1U : 0U;
+}
+
+int8_t IR_decoder_set_callback(IR_Decoder_t* decoder, IR_Frame_Callback_t callback)
+{
+#if IR_DECODER_ENABLE_CALLBACK
+    decoder->on_frame = callback;
+    return IR_SUCCESS;
+#else
+    (void)decoder;
+    (void)callback;
+    return IR_ERROR;
+#endif
 }
 
 void IR_decoder_reset(IR_Decoder_t* decoder)
@@ -348,5 +938,92 @@ void IR_decoder_reset(IR_Decoder_t* decoder)
     decoder->bit_index = 0;
     decoder->data_buffer = 0;
     decoder->timeout_counter = 0;
+    IR_GLITCH_CLEAR(decoder);
     decoder->decoded_data.valid = 0;
 }
+
+int8_t IR_decoder_get_stats(IR_Decoder_t* decoder, IR_Decoder_Stats_t* stats)
+{
+#if IR_DECODER_ENABLE_STATS
+    IR_Decoder_Stats_t check;
+    
+    // Counters are bumped from the edge ISR; copy until two reads agree
+    // so a half-updated multi-byte counter is never returned
+    do {
+        *stats = decoder->stats;
+        check = decoder->stats;
+    } while(memcmp(stats, &check, sizeof(check)) != 0);
+    
+    return IR_SUCCESS;
+#else
+    (void)decoder;
+    memset(stats, 0, sizeof(*stats));
+    return IR_ERROR;
+#endif
+}
+
+void IR_decoder_reset_stats(IR_Decoder_t* decoder)
+{
+#if IR_DECODER_ENABLE_STATS
+    static const IR_Decoder_Stats_t zero_stats = {0};
+    decoder->stats = zero_stats;
+#else
+    (void)decoder;
+#endif
+}
+
+int8_t IR_decoder_set_echo_mode(IR_Decoder_t* decoder, uint8_t mode)
+{
+#if IR_DECODER_ENABLE_ECHO
+    if(mode > IR_ECHO_MODE_VERIFY)
+        return IR_ERROR;
+    
+    decoder->echo_mode = mode;
+    return IR_SUCCESS;
+#else
+    (void)decoder;
+    (void)mode;
+    return IR_ERROR;
+#endif
+}
+
+void IR_decoder_echo(IR_Decoder_t* decoder, uint8_t event, uint32_t raw_data)
+{
+#if IR_DECODER_ENABLE_ECHO
+    if(decoder->echo_mode == IR_ECHO_MODE_OFF)
+        return;
+    
+    if(event == IR_TX_EVENT_END)
+    {
+        // Off air: the guard starts counting in IR_decoder_timeout_advance()
+        decoder->echo_guard = IR_DECODER_ECHO_GUARD_TICKS ? IR_DECODER_ECHO_GUARD_TICKS : 1U;
+        return;
+    }
+    
+    decoder->echo_guard = 0U;
+    decoder->echo_raw = raw_data;
+    decoder->echo_repeat = (event == IR_TX_EVENT_REPEAT) ? 1U : 0U;
+    decoder->echo_status = (decoder->echo_mode == IR_ECHO_MODE_VERIFY) ? IR_ECHO_PENDING : IR_ECHO_NONE;
+    
+    // A frame being received collides with our burst and is lost either way
+    decoder->state = IR_STATE_IDLE;
+    decoder->timeout_counter = 0U;
+    IR_GLITCH_CLEAR(decoder);
+    decoder->bit_index = 0U;
+    decoder->echo_active = 1U;
+#else
+    (void)decoder;
+    (void)event;
+    (void)raw_data;
+#endif
+}
+
+uint8_t IR_decoder_echo_status(IR_Decoder_t* decoder)
+{
+#if IR_DECODER_ENABLE_ECHO
+    return decoder->echo_status;
+#else
+    (void)decoder;
+    return IR_ECHO_NONE;
+#endif
+}
@@ -10,13 +10,66 @@
 #define IR_DECODER_H_
 
 #include "ir_common.h"
+#include "ir_config.h"
+
+// Longest interval representable in decoder ticks (us)
+#define IR_TICKS_MAX_US     (0xFFFFUL * 64UL / 5UL)
+
+// Leader-to-leader limit for a repeat code to belong to the frame or repeat
+// before it (us, IR_DECODER_ENABLE_TIMESTAMPS): NEC repeats every 108ms
+#ifndef IR_REPEAT_PERIOD_MAX_US
+#define IR_REPEAT_PERIOD_MAX_US (120000UL)
+#endif
+
+// Leader mark windows (decoder ticks, exclusive bounds), shared by the
+// protocol configs and the leader classifier in ir_dispatch.c
+#define IR_NEC_LEADER_MIN           (655U)      // 9ms
+#define IR_NEC_LEADER_MAX           (815U)
+#define IR_RC5_LEADER_MIN           (400U)      // placeholder
+#define IR_RC5_LEADER_MAX           (600U)
+#define IR_SONY_LEADER_MIN          (170U)      // 2.4ms
+#define IR_SONY_LEADER_MAX          (205U)
+#define IR_RC6_LEADER_MIN           (200U)      // 2.666ms
+#define IR_RC6_LEADER_MAX           (220U)
+#define IR_SAMSUNG_LEADER_MIN       (340U)      // 4.5ms
+#define IR_SAMSUNG_LEADER_MAX       (380U)
+#define IR_LG_LEADER_MIN            (680U)      // 9ms
+#define IR_LG_LEADER_MAX            (720U)
+#define IR_PANASONIC_LEADER_MIN     (265U)      // 3.5ms
+#define IR_PANASONIC_LEADER_MAX     (285U)
+#define IR_JVC_LEADER_MIN           (635U)      // 8.4ms
+#define IR_JVC_LEADER_MAX           (665U)
+#define IR_DENON_LEADER_MIN         (240U)      // 3.2ms
+#define IR_DENON_LEADER_MAX         (260U)
+#define IR_PPM_LEADER_MIN           IR_US_TO_TICKS(IR_PPM_SLOT_US * 6UL)   // 8 slots
+#define IR_PPM_LEADER_MAX           IR_US_TO_TICKS(IR_PPM_SLOT_US * 10UL)
+
+// IR_PROTOCOL_PPM symbol boundaries (decoder ticks): a mark-to-mark period
+// of 2..5 slots carries symbol 0..3. Timing the period instead of the space
+// cancels the receiver's mark stretching
+#define IR_PPM_BOUNDARY(n)          IR_US_TO_TICKS((uint32_t)IR_PPM_SLOT_US * (3U + 2U * (n)) / 2U)
+#define IR_PPM_NO_SYMBOL            (0xFFU)
+
+// A PPM symbol decided closer than this to a boundary counts as marginal
+#define IR_PPM_MARGINAL_TICKS       IR_US_TO_TICKS(IR_PPM_SLOT_US / 4U)
+
+// PPM symbol (0..3) of a mark-to-mark period, IR_PPM_NO_SYMBOL outside 1.5..5.5 slots
+static inline uint8_t IR_ppm_symbol(uint16_t period)
+{
+    if(period <= IR_PPM_BOUNDARY(0U) || period >= IR_PPM_BOUNDARY(4U))
+        return IR_PPM_NO_SYMBOL;
+    
+    uint8_t symbol = 0U;
+    while(symbol < 3U && period >= IR_PPM_BOUNDARY(symbol + 1U))
+        symbol++;
+    return symbol;
+}
 
 // Generic IR Protocol States
 typedef enum {
     IR_STATE_IDLE       = 0x0U,
     IR_STATE_INIT       = 0x1U,
-    IR_STATE_FINISH     = 0x2U,
-    IR_STATE_PROCESS    = 0x3U,
+    IR_STATE_PROCESS    = 0x2U,
 } IR_State_t;
 
 // Generic IR Protocol Events
@@ -46,28 +99,135 @@ typedef struct {
     uint16_t (*timer_get_count)(void);
     void (*timer_reset_count)(void);
     uint8_t (*pin_read)(void);
+#if IR_DECODER_ENABLE_TIMESTAMPS
+    uint32_t (*timer_get_time)(void);   // Free-running us, never reset (optional)
+#endif
 } IR_HAL_t;
 
-// IR Decoder Context Structure
+// Echo handling modes, see IR_decoder_set_echo_mode()
+#define IR_ECHO_MODE_OFF            (0U)        // Own transmissions are decoded like any other
+#define IR_ECHO_MODE_BLANK          (1U)        // Edges dropped while on air and during the guard
+#define IR_ECHO_MODE_VERIFY         (2U)        // Echo decoded and compared, never delivered
+
+// Echo check result of the last transmission (IR_ECHO_MODE_VERIFY)
+#define IR_ECHO_NONE                (0U)        // Nothing checked yet
+#define IR_ECHO_PENDING             (1U)        // On air or in the guard time
+#define IR_ECHO_MATCH               (2U)        // Echo decoded as the frame or repeat sent
+#define IR_ECHO_MISMATCH            (3U)        // Something else decoded: collision or bad emitter
+#define IR_ECHO_MISSING             (4U)        // Nothing decoded before the guard ran out
+
+#define IR_DECODER_ECHO_GUARD_TICKS IR_US_TO_TICKS(IR_DECODER_ECHO_GUARD_US)
+
+// No edge held by the glitch filter, see IR_DECODER_GLITCH_TICKS
+#define IR_GLITCH_NONE              (0xFFU)
+
+// An edge waits in the glitch filter: the state reflects the edge before it
+#if (IR_DECODER_GLITCH_TICKS > 0)
+#define IR_DECODER_HOLDING(decoder) ((decoder)->glitch_level != IR_GLITCH_NONE)
+#else
+#define IR_DECODER_HOLDING(decoder) (0)
+#endif
+
+// Decoder Statistics Counters (16-bit, wrap around - compare successive snapshots)
 typedef struct {
+    uint16_t frames_decoded;        // Complete frames stored in decoded_data
+    uint16_t repeats;               // Repeat codes recognised after a leader
+    uint16_t leader_errors;         // Leader burst or space outside protocol window
+    uint16_t bit_errors;            // Data space too long to be a valid bit
+    uint16_t validation_errors;     // Frames rejected by IR_validate_partial_data()
+    uint16_t corrections;           // Frames repaired by single-bit correction
+    uint16_t timeouts;              // Frames abandoned by the timeout handler
+    uint16_t glitches;              // Spikes (both edges) dropped by the glitch filter
+} IR_Decoder_Stats_t;
+
+// Frame completion callback, called from the edge interrupt with each frame or
+// repeat as it completes and the decoder that received it, so one callback can
+// serve several decoders. The data is only valid for the duration of the call
+struct IR_Decoder;
+typedef void (*IR_Frame_Callback_t)(struct IR_Decoder* decoder, const IR_Data_t* data);
+
+// IR Decoder Context Structure
+typedef struct IR_Decoder {
     IR_State_t state;
     IR_Event_t event;
     uint8_t bit_index;
     uint32_t data_buffer;
     uint16_t timeout_counter;
+#if (IR_DECODER_GLITCH_TICKS > 0)
+    uint8_t glitch_level;       // Edge held until the interval after it is known, or IR_GLITCH_NONE
+    uint16_t glitch_ticks;      // Interval before the held edge, or dropped spike time to add to the next
+    uint16_t glitch_age;        // Timeout ticks since the held edge
+#if IR_DECODER_ENABLE_TIMESTAMPS
+    uint32_t glitch_time;       // Time of the held edge (us)
+#endif
+#endif
+    uint8_t frame_flags;        // IR_DATA_FLAG_* collected for the frame in progress
+#if IR_DECODER_ENABLE_CONFIDENCE
+    uint8_t frame_min_margin;   // Confidence of the frame in progress, see IR_Data_t
+    uint8_t frame_marginal_bits;
+#endif
+#if IR_ENABLE_PPM
+    uint16_t ppm_mark;          // Last data mark (ticks): PPM times mark + space
+#endif
     IR_Protocol_t protocol_type;
+#if !IR_HAL_STATIC
     IR_HAL_t hal;
+#endif
     IR_Data_t decoded_data;
     IR_Protocol_Config_t protocol_config;  // Added missing protocol config field
+#if IR_DECODER_ENABLE_TIMESTAMPS
+    uint32_t edge_time;                    // Latest edge (us)
+    uint32_t frame_time;                   // Leader edge of the frame in progress (us)
+    uint32_t last_frame_time;              // Leader edge of the last frame or repeat reported (us)
+#endif
+#if IR_DECODER_ENABLE_CALLBACK
+    IR_Frame_Callback_t on_frame;          // Frames go here instead of decoded_data when set
+#endif
+#if IR_DECODER_ENABLE_ECHO
+    volatile uint8_t echo_active;          // Own transmission on air or in its guard time
+    uint8_t echo_mode;                     // IR_ECHO_MODE_*
+    uint8_t echo_status;                   // IR_ECHO_* of the last transmission
+    uint8_t echo_repeat;                   // Transmission is a repeat code
+    uint16_t echo_guard;                   // Guard ticks left, counting once on air ends
+    uint32_t echo_raw;                     // Frame sent
+#endif
+#if IR_DECODER_ENABLE_CORRECTION
+    uint8_t bit_margin[32];                // |space - bit_threshold| per data bit, saturated
+#endif
+#if IR_DECODER_ENABLE_STATS
+    volatile IR_Decoder_Stats_t stats;     // Updated from interrupt context
+#endif
 } IR_Decoder_t;
 
-// Function Declarations
+// Function Declarations (hal is ignored and may be NULL when IR_HAL_STATIC is 1)
 void IR_decoder_init(IR_Decoder_t* decoder, IR_Protocol_t protocol, IR_HAL_t* hal);
 void IR_decoder_process(IR_Decoder_t* decoder, uint8_t pin_value);
+void IR_decoder_process_duration(IR_Decoder_t* decoder, uint8_t pin_value, uint16_t counter);
+#if IR_DECODER_ENABLE_TIMESTAMPS
+void IR_decoder_process_time(IR_Decoder_t* decoder, uint8_t pin_value, uint32_t time_us);
+#endif
 int8_t IR_decoder_get_data(IR_Decoder_t* decoder, IR_Data_t* data);
+int8_t IR_decoder_get_data_ext(IR_Decoder_t* decoder, IR_Data_Ext_t* data);
 void IR_decoder_timeout_handler(IR_Decoder_t* decoder);
+void IR_decoder_timeout_advance(IR_Decoder_t* decoder, uint16_t ticks);
+void IR_decoder_expire(IR_Decoder_t* decoder);
+uint8_t IR_decoder_is_idle(IR_Decoder_t* decoder);
+
+// Completion callback (returns IR_ERROR when IR_DECODER_ENABLE_CALLBACK is 0)
+int8_t IR_decoder_set_callback(IR_Decoder_t* decoder, IR_Frame_Callback_t callback);
 void IR_decoder_reset(IR_Decoder_t* decoder);
 
+// Own-transmission echo (IR_DECODER_ENABLE_ECHO; set_echo_mode returns IR_ERROR
+// and echo_status IR_ECHO_NONE when it is 0). IR_decoder_echo() takes the
+// IR_TX_EVENT_* of an IR_TX_Notify_t callback
+int8_t IR_decoder_set_echo_mode(IR_Decoder_t* decoder, uint8_t mode);
+void IR_decoder_echo(IR_Decoder_t* decoder, uint8_t event, uint32_t raw_data);
+uint8_t IR_decoder_echo_status(IR_Decoder_t* decoder);
+
+// Statistics (return IR_ERROR and zeroed counters when IR_DECODER_ENABLE_STATS is 0)
+int8_t IR_decoder_get_stats(IR_Decoder_t* decoder, IR_Decoder_Stats_t* stats);
+void IR_decoder_reset_stats(IR_Decoder_t* decoder);
+
 static int8_t IR_process_protocol_data(IR_Decoder_t* decoder, uint16_t counter, uint8_t value);
 
 #endif /* IR_DECODER_H_ */
@@ -0,0 +1,199 @@
+/**
+ * ir_dispatch.c - Leader-classified Multi-protocol Receiver Implementation
+ *
+ * Author: Nghia Taarabt
+ */
+
+#include "ir_dispatch.h"
+
+// Protocol bit when the protocol is built in and some tick of bucket b lies
+// strictly inside its leader window. Constant expressions only, so the table
+// below is built by the compiler from the same macros the decoder configs use
+#define IR_LEADER_HIT(b, proto) \
+    ((IR_ENABLE_##proto && ((b) << IR_LEADER_BUCKET_SHIFT) < IR_##proto##_LEADER_MAX && \
+      ((((b) + 1U) << IR_LEADER_BUCKET_SHIFT) - 1U) > IR_##proto##_LEADER_MIN) ? \
+     (1U << IR_PROTOCOL_##proto) : 0U)
+
+#define IR_LEADER_MASK(b)   (uint16_t)(IR_LEADER_HIT(b, NEC) | IR_LEADER_HIT(b, RC5) | \
+                                       IR_LEADER_HIT(b, SONY) | IR_LEADER_HIT(b, RC6) | \
+                                       IR_LEADER_HIT(b, SAMSUNG) | IR_LEADER_HIT(b, LG) | \
+                                       IR_LEADER_HIT(b, PANASONIC) | IR_LEADER_HIT(b, JVC) | \
+                                       IR_LEADER_HIT(b, DENON) | IR_LEADER_HIT(b, PPM))
+
+#define IR_LEADER_MASK4(b)  IR_LEADER_MASK(b), IR_LEADER_MASK((b) + 1U), \
+                            IR_LEADER_MASK((b) + 2U), IR_LEADER_MASK((b) + 3U)
+
+// Candidate protocols (bit = IR_Protocol_t) per quantized leader duration
+static const uint16_t leader_mask_table[IR_LEADER_BUCKETS] = {
+    IR_LEADER_MASK4(0U),  IR_LEADER_MASK4(4U),  IR_LEADER_MASK4(8U),  IR_LEADER_MASK4(12U),
+    IR_LEADER_MASK4(16U), IR_LEADER_MASK4(20U), IR_LEADER_MASK4(24U), IR_LEADER_MASK4(28U)
+};
+
+uint16_t IR_leader_classify(uint16_t burst_ticks)
+{
+    uint16_t bucket = burst_ticks >> IR_LEADER_BUCKET_SHIFT;
+
+    if(bucket >= IR_LEADER_BUCKETS)
+        return 0U;
+
+    return leader_mask_table[bucket];
+}
+
+void IR_dispatch_init(IR_Dispatch_t* dispatch, const IR_Protocol_t* protocols, uint8_t count, IR_HAL_t* hal)
+{
+    IR_HAL_t decoder_hal = {0};
+
+    if(count > IR_DISPATCH_MAX_PROTOCOLS)
+        count = IR_DISPATCH_MAX_PROTOCOLS;
+
+    dispatch->count = count;
+    dispatch->active_mask = 0U;
+    dispatch->leader_pending = 0U;
+    dispatch->hal = *hal;
+
+    // The dispatcher reads the edge timer once and hands the interval to
+    // each decoder, so decoders get no timer functions of their own
+    decoder_hal.pin_read = hal->pin_read;
+
+    for(uint8_t slot = 0; slot < count; slot++)
+    {
+        IR_decoder_init(&dispatch->decoder[slot], protocols[slot], &decoder_hal);
+    }
+
+    if(dispatch->hal.timer_start)
+        dispatch->hal.timer_start();
+}
+
+void IR_dispatch_process(IR_Dispatch_t* dispatch, uint8_t pin_value)
+{
+    uint16_t counter = 0;
+    if(dispatch->hal.timer_get_count)
+        counter = dispatch->hal.timer_get_count();
+    if(dispatch->hal.timer_reset_count)
+        dispatch->hal.timer_reset_count();
+
+    IR_dispatch_process_duration(dispatch, pin_value, counter);
+}
+
+void IR_dispatch_process_duration(IR_Dispatch_t* dispatch, uint8_t pin_value, uint16_t counter)
+{
+    uint16_t active = dispatch->active_mask;
+
+    if(active == 0U)
+    {
+        // No frame in progress: wait for a whole leader mark, then start
+        // only the decoders whose leader window can contain it
+        if(pin_value == IR_HIGH)
+        {
+            dispatch->leader_pending = 1U;
+            return;
+        }
+        if(!dispatch->leader_pending)
+            return;
+        dispatch->leader_pending = 0U;
+
+        uint16_t candidates = IR_leader_classify(counter);
+
+        for(uint8_t slot = 0; candidates && slot < dispatch->count; slot++)
+        {
+            IR_Decoder_t* decoder = &dispatch->decoder[slot];
+
+            if(!(candidates & (1U << decoder->protocol_type)))
+                continue;
+
+            IR_decoder_process_duration(decoder, IR_HIGH, 0U);
+            IR_decoder_process_duration(decoder, IR_LOW, counter);
+            if(decoder->state != IR_STATE_IDLE)
+                active |= (uint16_t)(1U << slot);
+        }
+
+        dispatch->active_mask = active;
+        return;
+    }
+
+    for(uint8_t slot = 0; slot < dispatch->count; slot++)
+    {
+        uint16_t bit = (uint16_t)(1U << slot);
+        IR_Decoder_t* decoder = &dispatch->decoder[slot];
+
+        if(!(active & bit))
+            continue;
+
+        IR_decoder_process_duration(decoder, pin_value, counter);
+
+        // Finished, or restarted on a burst that may be any protocol's leader
+        // (a burst held by the glitch filter has not reached the decoder yet)
+        if(decoder->state == IR_STATE_IDLE ||
+           (pin_value == IR_HIGH && !IR_DECODER_HOLDING(decoder) &&
+            decoder->state == IR_STATE_INIT && decoder->event == IR_EVENT_INIT))
+        {
+            decoder->state = IR_STATE_IDLE;
+            active &= (uint16_t)~bit;
+        }
+    }
+
+    dispatch->active_mask = active;
+
+    // Last decoder let go on a burst: classify it as the next leader
+    if(active == 0U && pin_value == IR_HIGH)
+        dispatch->leader_pending = 1U;
+}
+
+int8_t IR_dispatch_get_data(IR_Dispatch_t* dispatch, IR_Data_t* data)
+{
+    for(uint8_t slot = 0; slot < dispatch->count; slot++)
+    {
+        if(IR_decoder_get_data(&dispatch->decoder[slot], data) == IR_SUCCESS)
+            return IR_SUCCESS;
+    }
+
+    return IR_ERROR;
+}
+
+void IR_dispatch_timeout_handler(IR_Dispatch_t* dispatch)
+{
+    IR_dispatch_timeout_advance(dispatch, 1U);
+}
+
+void IR_dispatch_timeout_advance(IR_Dispatch_t* dispatch, uint16_t ticks)
+{
+    uint16_t active = dispatch->active_mask;
+
+    // Line quiet for too long: abandon every frame in progress
+    if(dispatch->hal.timer_get_count && dispatch->hal.timer_get_count() > IR_DISPATCH_IDLE_TICKS)
+    {
+        for(uint8_t slot = 0; slot < dispatch->count; slot++)
+        {
+            if(active & (1U << slot))
+                IR_decoder_expire(&dispatch->decoder[slot]);
+        }
+        dispatch->active_mask = 0U;
+        dispatch->leader_pending = 0U;
+        return;
+    }
+
+    for(uint8_t slot = 0; slot < dispatch->count; slot++)
+    {
+        uint16_t bit = (uint16_t)(1U << slot);
+
+        if(!(active & bit))
+            continue;
+
+        IR_decoder_timeout_advance(&dispatch->decoder[slot], ticks);
+        if(dispatch->decoder[slot].state == IR_STATE_IDLE)
+            active &= (uint16_t)~bit;
+    }
+
+    dispatch->active_mask = active;
+}
+
+void IR_dispatch_reset(IR_Dispatch_t* dispatch)
+{
+    dispatch->active_mask = 0U;
+    dispatch->leader_pending = 0U;
+
+    for(uint8_t slot = 0; slot < dispatch->count; slot++)
+    {
+        IR_decoder_reset(&dispatch->decoder[slot]);
+    }
+}
@@ -0,0 +1,51 @@
+/**
+ * ir_dispatch.h - Leader-classified Multi-protocol Receiver
+ *
+ * Runs several protocol decoders on one receiver. The leader mark is
+ * classified once through a table built at compile time from the
+ * IR_<PROTOCOL>_LEADER_MIN/MAX windows, and only the decoders whose window
+ * can contain it receive the rest of the frame.
+ * Author: Nghia Taarabt
+ */
+
+#ifndef IR_DISPATCH_H_
+#define IR_DISPATCH_H_
+
+#include "ir_decoder.h"
+
+// Decoders per dispatcher, one IR_Decoder_t each: by default one per protocol
+// built in, so IR_PROTOCOL_MASK sizes it
+#ifndef IR_DISPATCH_MAX_PROTOCOLS
+#define IR_DISPATCH_MAX_PROTOCOLS   (IR_ENABLE_NEC + IR_ENABLE_RC5 + IR_ENABLE_SONY + IR_ENABLE_RC6 + \
+                                     IR_ENABLE_SAMSUNG + IR_ENABLE_LG + IR_ENABLE_PANASONIC + \
+                                     IR_ENABLE_JVC + IR_ENABLE_DENON + IR_ENABLE_PPM)
+#endif
+
+// Leader quantization: 32 buckets of 32 ticks (~410us) cover marks up to
+// ~13ms. Longer marks classify as no protocol
+#define IR_LEADER_BUCKET_SHIFT      (5U)
+#define IR_LEADER_BUCKETS           (32U)
+
+// Silence (decoder ticks) after which all frames in progress are abandoned
+#define IR_DISPATCH_IDLE_TICKS      (10000U)
+
+// Dispatcher context
+typedef struct {
+    IR_Decoder_t decoder[IR_DISPATCH_MAX_PROTOCOLS];
+    uint16_t active_mask;       // Decoders (by slot) receiving the current frame
+    uint8_t leader_pending;     // Leader mark started while no decoder was active
+    uint8_t count;
+    IR_HAL_t hal;               // Shared edge timer, read once per edge
+} IR_Dispatch_t;
+
+// Function Declarations
+uint16_t IR_leader_classify(uint16_t burst_ticks);
+void IR_dispatch_init(IR_Dispatch_t* dispatch, const IR_Protocol_t* protocols, uint8_t count, IR_HAL_t* hal);
+void IR_dispatch_process(IR_Dispatch_t* dispatch, uint8_t pin_value);
+void IR_dispatch_process_duration(IR_Dispatch_t* dispatch, uint8_t pin_value, uint16_t counter);
+int8_t IR_dispatch_get_data(IR_Dispatch_t* dispatch, IR_Data_t* data);
+void IR_dispatch_timeout_handler(IR_Dispatch_t* dispatch);
+void IR_dispatch_timeout_advance(IR_Dispatch_t* dispatch, uint16_t ticks);
+void IR_dispatch_reset(IR_Dispatch_t* dispatch);
+
+#endif /* IR_DISPATCH_H_ */
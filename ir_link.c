@@ -0,0 +1,406 @@
+/**
+ * ir_link.c - Reliable IR Data Link Implementation
+ *
+ * Author: Nghia Taarabt
+ */
+
+#include "ir_link.h"
+#include <string.h>
+
+// Line timing windows (ticks) around the nominal 1/3/4/8 units, u = unit_ticks
+#define IR_LINK_MARK_OK(t, u)           ((t) > (u) / 2U && (t) < (u) * 2U)
+#define IR_LINK_SPACE_0(t, u)           ((t) > (u) / 2U && (t) < (u) * 2U)
+#define IR_LINK_SPACE_1(t, u)           ((t) >= (u) * 2U && (t) < (u) * 4U)
+#define IR_LINK_LEADER_MARK_OK(t, u)    ((t) > (u) * 6U && (t) < (u) * 10U)
+#define IR_LINK_LEADER_SPACE_OK(t, u)   ((t) > (u) * 3U && (t) < (u) * 5U)
+
+#define IR_LINK_NO_TYPE             (0xFFU)
+
+static void IR_link_mark(IR_Link_t* link, uint16_t us)
+{
+    link->tx_hal.carrier_on();
+    link->tx_hal.delay_us(us);
+    link->tx_hal.carrier_off();
+}
+
+static void IR_link_transmit(IR_Link_t* link, uint8_t type, uint8_t sequence, const uint8_t* payload, uint8_t length)
+{
+    uint8_t frame[IR_LINK_FRAME_MAX];
+    uint8_t size = IR_LINK_HEADER_SIZE + length;
+
+    frame[0] = type;
+    frame[1] = sequence;
+    frame[2] = length;
+    memcpy(&frame[IR_LINK_HEADER_SIZE], payload, length);
+
+    uint16_t crc = IR_crc16(frame, size);
+    frame[size++] = (uint8_t)crc;
+    frame[size++] = (uint8_t)(crc >> 8);
+
+    uint16_t unit = link->unit_us;
+
+    IR_link_mark(link, unit * 8U);
+    link->tx_hal.delay_us(unit * 4U);
+
+    for(uint8_t i = 0; i < size; i++)
+    {
+        uint8_t byte = frame[i];
+
+        if(link->coding == IR_PROTOCOL_PPM)
+        {
+            for(uint8_t symbol = 0; symbol < 4U; symbol++)
+            {
+                IR_link_mark(link, unit);
+                link->tx_hal.delay_us(unit * (1U + (byte & 3U)));
+                byte >>= 2;
+            }
+            continue;
+        }
+
+        for(uint8_t bit = 0; bit < 8U; bit++)
+        {
+            IR_link_mark(link, unit);
+            link->tx_hal.delay_us((byte & 1U) ? unit * 3U : unit);
+            byte >>= 1;
+        }
+    }
+
+    IR_link_mark(link, unit);
+
+    // Whatever our own receiver made of the transmission is not from the peer
+    link->rx_state = IR_LINK_RX_IDLE;
+    link->rx_ready = 0U;
+
+    // Restart the ACK timer: request first, so a timer interrupt in between
+    // cannot expire it again from the old count
+    link->ack_restart = 1U;
+    link->ack_expired = 0U;
+}
+
+static void IR_link_rx_error(IR_Link_t* link, uint8_t pin_value)
+{
+    if(link->rx_state >= IR_LINK_RX_BIT_MARK)
+        link->stats.line_errors++;
+
+    // A mark that breaks a frame may be the leader of the next one
+    link->rx_state = (pin_value == IR_HIGH && !link->rx_ready) ? IR_LINK_RX_LEADER_MARK : IR_LINK_RX_IDLE;
+}
+
+static void IR_link_accept(IR_Link_t* link, const uint8_t* frame)
+{
+    // Same header as the last frame delivered: our ACK was lost, send it again.
+    // A RESYNC frame comes from a peer that restarted, whose sequence numbers
+    // say nothing about ours: it is always new. If the ACK of a RESYNC frame
+    // is lost, its retransmission is delivered a second time
+    if(!(frame[0] & IR_LINK_FLAG_RESYNC) &&
+       frame[0] == link->rx_last_type && frame[1] == link->rx_last_sequence)
+    {
+        link->stats.duplicates++;
+        link->ack_sequence = frame[1];
+        link->ack_pending = 1U;
+        return;
+    }
+
+    // Previous payload not collected yet: no ACK, the sender tries again later
+    if(link->data_ready)
+        return;
+
+    memcpy(link->data, &frame[IR_LINK_HEADER_SIZE], frame[2]);
+    link->data_length = frame[2];
+    link->data_ready = 1U;
+    link->rx_last_type = frame[0];
+    link->rx_last_sequence = frame[1];
+    link->stats.frames_received++;
+
+    link->ack_sequence = frame[1];
+    link->ack_pending = 1U;
+}
+
+void IR_link_init(IR_Link_t* link, IR_TX_HAL_t* tx_hal, IR_HAL_t* hal)
+{
+    memset(link, 0, sizeof(*link));
+    link->tx_hal = *tx_hal;
+    link->hal = *hal;
+    link->tx_flags = IR_LINK_FLAG_RESYNC;
+    link->rx_last_type = IR_LINK_NO_TYPE;
+    IR_link_set_coding(link, IR_PROTOCOL_NEC);
+
+    if(link->hal.timer_start)
+        link->hal.timer_start();
+}
+
+int8_t IR_link_set_coding(IR_Link_t* link, IR_Protocol_t coding)
+{
+    switch(coding)
+    {
+    case IR_PROTOCOL_NEC:
+        link->unit_us = IR_LINK_UNIT_US;
+        link->ack_timeout = IR_LINK_ACK_TIMEOUT_TICKS;
+        break;
+    case IR_PROTOCOL_PPM:
+        link->unit_us = IR_PPM_SLOT_US;
+        link->ack_timeout = IR_LINK_PPM_ACK_TIMEOUT_TICKS;
+        break;
+    default:
+        return IR_ERROR;
+    }
+
+    link->coding = coding;
+    link->unit_ticks = IR_US_TO_TICKS(link->unit_us);
+    link->idle_ticks = (uint16_t)(link->unit_ticks * IR_LINK_IDLE_UNITS + IR_LINK_TIMEOUT_STEP_TICKS);
+    link->rx_state = IR_LINK_RX_IDLE;
+
+    return IR_SUCCESS;
+}
+
+int8_t IR_link_send(IR_Link_t* link, const uint8_t* data, uint8_t length)
+{
+    if(link->tx_pending || length > IR_LINK_MAX_PAYLOAD)
+        return IR_ERROR;
+
+    memcpy(link->tx_payload, data, length);
+    link->tx_length = length;
+    link->tx_tries = 0U;
+    link->tx_pending = 1U;
+    link->tx_status = IR_LINK_TX_PENDING;
+
+    return IR_SUCCESS;
+}
+
+uint8_t IR_link_is_busy(IR_Link_t* link)
+{
+    return link->tx_pending;
+}
+
+// IR_LINK_TX_DELIVERED or IR_LINK_TX_FAILED once the last payload is settled
+uint8_t IR_link_tx_status(IR_Link_t* link)
+{
+    return link->tx_status;
+}
+
+int8_t IR_link_receive(IR_Link_t* link, uint8_t* data, uint8_t* length)
+{
+    if(!link->data_ready)
+        return IR_ERROR;
+
+    memcpy(data, link->data, link->data_length);
+    *length = link->data_length;
+    link->data_ready = 0U;
+
+    return IR_SUCCESS;
+}
+
+uint8_t IR_link_service(IR_Link_t* link)
+{
+    if(link->rx_ready)
+    {
+        const uint8_t* frame = link->rx_frame;
+        uint8_t size = IR_LINK_HEADER_SIZE + frame[2];
+        uint16_t crc = (uint16_t)(frame[size] | ((uint16_t)frame[size + 1U] << 8));
+
+        if(IR_crc16(frame, size) != crc)
+        {
+            link->stats.crc_errors++;
+        }
+        else if((frame[0] & IR_LINK_TYPE_MASK) == IR_LINK_TYPE_ACK)
+        {
+            if(link->tx_pending && link->tx_tries && frame[1] == link->tx_sequence)
+            {
+                link->tx_pending = 0U;
+                link->tx_sequence++;
+                link->tx_flags = 0U;
+                link->tx_status = IR_LINK_TX_DELIVERED;
+            }
+        }
+        else if((frame[0] & IR_LINK_TYPE_MASK) == IR_LINK_TYPE_DATA)
+        {
+            IR_link_accept(link, frame);
+        }
+
+        link->rx_ready = 0U;
+    }
+
+    // Half duplex: never talk over a frame that is arriving
+    if(link->rx_state != IR_LINK_RX_IDLE)
+        return 1U;
+
+    if(link->ack_pending)
+    {
+        link->ack_pending = 0U;
+        IR_link_transmit(link, IR_LINK_TYPE_ACK, link->ack_sequence, 0, 0U);
+        link->stats.acks_sent++;
+        return 1U;
+    }
+
+    if(link->tx_pending && (link->tx_tries == 0U || link->ack_expired))
+    {
+        if(link->tx_tries >= IR_LINK_MAX_TRIES)
+        {
+            // Give up; the next payload takes a new sequence number either way
+            link->tx_pending = 0U;
+            link->tx_sequence++;
+            link->tx_status = IR_LINK_TX_FAILED;
+            link->stats.failures++;
+            return 0U;
+        }
+
+        if(link->tx_tries)
+            link->stats.retransmits++;
+        else
+            link->stats.frames_sent++;
+        link->tx_tries++;
+
+        IR_link_transmit(link, IR_LINK_TYPE_DATA | link->tx_flags, link->tx_sequence, link->tx_payload, link->tx_length);
+        return 1U;
+    }
+
+    return link->tx_pending;
+}
+
+void IR_link_process(IR_Link_t* link, uint8_t pin_value)
+{
+    uint16_t counter = 0;
+    if(link->hal.timer_get_count)
+        counter = link->hal.timer_get_count();
+    if(link->hal.timer_reset_count)
+        link->hal.timer_reset_count();
+
+    IR_link_process_duration(link, pin_value, counter);
+}
+
+void IR_link_process_duration(IR_Link_t* link, uint8_t pin_value, uint16_t ticks)
+{
+    uint16_t unit = link->unit_ticks;
+
+    link->rx_quiet = 0U;
+
+    switch(link->rx_state)
+    {
+    case IR_LINK_RX_IDLE:
+        // Wait for the service to take the last frame before starting another
+        if(pin_value == IR_HIGH && !link->rx_ready)
+            link->rx_state = IR_LINK_RX_LEADER_MARK;
+        break;
+
+    case IR_LINK_RX_LEADER_MARK:
+        if(pin_value == IR_LOW && IR_LINK_LEADER_MARK_OK(ticks, unit))
+            link->rx_state = IR_LINK_RX_LEADER_SPACE;
+        else
+            IR_link_rx_error(link, pin_value);
+        break;
+
+    case IR_LINK_RX_LEADER_SPACE:
+        if(pin_value == IR_HIGH && IR_LINK_LEADER_SPACE_OK(ticks, unit))
+        {
+            link->rx_count = 0U;
+            link->rx_bit = 0U;
+            link->rx_frame[0] = 0U;
+            link->rx_state = IR_LINK_RX_BIT_MARK;
+        }
+        else
+        {
+            IR_link_rx_error(link, pin_value);
+        }
+        break;
+
+    case IR_LINK_RX_BIT_MARK:
+        if(pin_value == IR_LOW && IR_LINK_MARK_OK(ticks, unit))
+        {
+            link->rx_mark = ticks;
+            link->rx_state = IR_LINK_RX_BIT_SPACE;
+        }
+        else
+            IR_link_rx_error(link, pin_value);
+        break;
+
+    case IR_LINK_RX_BIT_SPACE:
+    {
+        uint8_t count = link->rx_count;
+
+        if(pin_value != IR_HIGH)
+        {
+            IR_link_rx_error(link, pin_value);
+            break;
+        }
+
+        if(link->coding == IR_PROTOCOL_PPM)
+        {
+            // Mark-to-mark period: two bits per symbol
+            uint8_t symbol = IR_ppm_symbol(link->rx_mark + ticks);
+            if(symbol == IR_PPM_NO_SYMBOL)
+            {
+                IR_link_rx_error(link, pin_value);
+                break;
+            }
+            link->rx_frame[count] |= (uint8_t)(symbol << link->rx_bit);
+            link->rx_bit += 2U;
+        }
+        else
+        {
+            if(!(IR_LINK_SPACE_0(ticks, unit) || IR_LINK_SPACE_1(ticks, unit)))
+            {
+                IR_link_rx_error(link, pin_value);
+                break;
+            }
+            if(IR_LINK_SPACE_1(ticks, unit))
+                link->rx_frame[count] |= (uint8_t)(1U << link->rx_bit);
+            link->rx_bit++;
+        }
+
+        link->rx_state = IR_LINK_RX_BIT_MARK;
+        if(link->rx_bit < 8U)
+            break;
+
+        // Byte complete: the length byte fixes where the frame ends
+        link->rx_bit = 0U;
+        link->rx_count = ++count;
+
+        if(count == IR_LINK_HEADER_SIZE && link->rx_frame[2] > IR_LINK_MAX_PAYLOAD)
+        {
+            IR_link_rx_error(link, IR_LOW);
+        }
+        else if(count > IR_LINK_HEADER_SIZE && count == IR_LINK_HEADER_SIZE + link->rx_frame[2] + IR_LINK_CRC_SIZE)
+        {
+            // The mark that ended this space is the stop mark
+            link->rx_ready = 1U;
+            link->rx_state = IR_LINK_RX_IDLE;
+        }
+        else
+        {
+            link->rx_frame[count] = 0U;
+        }
+        break;
+    }
+
+    default:
+        link->rx_state = IR_LINK_RX_IDLE;
+        break;
+    }
+}
+
+void IR_link_timeout_advance(IR_Link_t* link, uint16_t ticks)
+{
+    if(link->ack_restart)
+    {
+        link->ack_restart = 0U;
+        link->ack_elapsed = 0U;
+    }
+    else
+    {
+        link->ack_elapsed = (link->ack_elapsed > 0xFFFFU - ticks) ? 0xFFFFU : (uint16_t)(link->ack_elapsed + ticks);
+    }
+    if(link->ack_elapsed >= link->ack_timeout)
+        link->ack_expired = 1U;
+
+    if(link->rx_state == IR_LINK_RX_IDLE)
+        return;
+
+    // Line quiet in the middle of a frame: the rest of it was lost
+    link->rx_quiet = (link->rx_quiet > 0xFFFFU - ticks) ? 0xFFFFU : (uint16_t)(link->rx_quiet + ticks);
+    if(link->rx_quiet > link->idle_ticks)
+    {
+        if(link->rx_state >= IR_LINK_RX_BIT_MARK)
+            link->stats.line_errors++;
+        link->rx_state = IR_LINK_RX_IDLE;
+    }
+}
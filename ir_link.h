@@ -0,0 +1,180 @@
+/**
+ * ir_link.h - Reliable IR Data Link
+ *
+ * Moves byte payloads between two boards over one half-duplex IR pair:
+ * framed packets with a CRC-16, sequence numbers and stop-and-wait
+ * ACK/retransmit. Frames are sent with IR_TX_HAL_t carrier bursts and
+ * received from edges like the decoder (IR_HAL_t timer, or durations from
+ * any other backend). Two line codings, both ends set the same one with
+ * IR_link_set_coding():
+ *
+ *   IR_PROTOCOL_NEC  pulse distance, unit IR_LINK_UNIT_US (default)
+ *     leader   mark 8 units, space 4 units
+ *     bit      mark 1 unit, space 1 unit (0) or 3 units (1), LSB first
+ *     stop     mark 1 unit
+ *
+ *   IR_PROTOCOL_PPM  2-bit pulse position, unit IR_PPM_SLOT_US (~10x faster)
+ *     leader   mark 8 slots, space 4 slots
+ *     symbol   mark 1 slot, space 1..4 slots (value 0..3), LSB pair first
+ *     stop     mark 1 slot
+ *
+ * Frame bytes (CRC little-endian):
+ *
+ *   0       type (IR_LINK_TYPE_*) | IR_LINK_FLAG_*
+ *   1       sequence number
+ *   2       payload length (0..IR_LINK_MAX_PAYLOAD)
+ *   3..     payload
+ *   last 2  CRC-16 of everything before it (IR_crc16())
+ *
+ * IR_link_process()/IR_link_process_duration() run from the edge interrupt,
+ * IR_link_timeout_advance() from the timer interrupt. IR_link_service(),
+ * polled from the main loop, handles received frames and transmits (the
+ * transmitter HAL blocks for the frame airtime), but never while a frame
+ * is arriving.
+ * Author: Nghia Taarabt
+ */
+
+#ifndef IR_LINK_H_
+#define IR_LINK_H_
+
+#include "ir_decoder.h"
+#include "ir_transmitter.h"
+
+// Largest payload per frame
+#ifndef IR_LINK_MAX_PAYLOAD
+#define IR_LINK_MAX_PAYLOAD         (32U)
+#endif
+
+// Transmissions of a frame before it is given up (1 + retries)
+#ifndef IR_LINK_MAX_TRIES
+#define IR_LINK_MAX_TRIES           (8U)
+#endif
+
+// Line coding unit (us); NEC's 562us suits any 38kHz receiver module
+#ifndef IR_LINK_UNIT_US
+#define IR_LINK_UNIT_US             (562U)
+#endif
+
+// Wait for an ACK before retransmitting (us), from the end of the frame:
+// the peer's main loop latency plus the ~70ms airtime of an ACK
+#ifndef IR_LINK_ACK_TIMEOUT_US
+#define IR_LINK_ACK_TIMEOUT_US      (150000UL)
+#endif
+
+// Same for the PPM coding, whose ACK takes ~8ms
+#ifndef IR_LINK_PPM_ACK_TIMEOUT_US
+#define IR_LINK_PPM_ACK_TIMEOUT_US  (30000UL)
+#endif
+
+#define IR_LINK_HEADER_SIZE         (3U)
+#define IR_LINK_CRC_SIZE            (2U)
+#define IR_LINK_FRAME_MAX           (IR_LINK_HEADER_SIZE + IR_LINK_MAX_PAYLOAD + IR_LINK_CRC_SIZE)
+
+#define IR_LINK_TYPE_DATA           (0x00U)
+#define IR_LINK_TYPE_ACK            (0x01U)
+#define IR_LINK_TYPE_MASK           (0x0FU)
+#define IR_LINK_FLAG_RESYNC         (0x80U)     // First DATA since init: always new, restarts duplicate detection
+
+// Outcome of the last IR_link_send(), see IR_link_tx_status()
+#define IR_LINK_TX_IDLE             (0U)        // Nothing sent since init
+#define IR_LINK_TX_PENDING          (1U)        // Waiting for its ACK
+#define IR_LINK_TX_DELIVERED        (2U)        // ACKed by the peer
+#define IR_LINK_TX_FAILED           (3U)        // Given up after IR_LINK_MAX_TRIES
+
+#define IR_LINK_UNIT_TICKS          IR_US_TO_TICKS(IR_LINK_UNIT_US)
+#define IR_LINK_ACK_TIMEOUT_TICKS   ((IR_LINK_ACK_TIMEOUT_US * 5UL) >> 6)
+#define IR_LINK_PPM_ACK_TIMEOUT_TICKS ((IR_LINK_PPM_ACK_TIMEOUT_US * 5UL) >> 6)
+
+// Largest tick count passed to one IR_link_timeout_advance() call; the
+// default is the ATTiny13 Timer0 overflow (ATTINY13_OVERFLOW_IR_TICKS)
+#ifndef IR_LINK_TIMEOUT_STEP_TICKS
+#define IR_LINK_TIMEOUT_STEP_TICKS  (133U)
+#endif
+
+// Silence that abandons a frame being received, in units of the coding in
+// use: twice the longest mark or space. One timeout step is added on top,
+// since the silence is only measured to the step
+#define IR_LINK_IDLE_UNITS          (16U)
+
+// Receiver states
+typedef enum {
+    IR_LINK_RX_IDLE = 0,
+    IR_LINK_RX_LEADER_MARK,
+    IR_LINK_RX_LEADER_SPACE,
+    IR_LINK_RX_BIT_MARK,
+    IR_LINK_RX_BIT_SPACE
+} IR_Link_RX_State_t;
+
+// Link counters
+typedef struct {
+    uint16_t frames_sent;       // DATA frames, first transmissions
+    uint16_t retransmits;
+    uint16_t failures;          // DATA frames given up after IR_LINK_MAX_TRIES
+    uint16_t acks_sent;
+    uint16_t frames_received;   // DATA frames delivered
+    uint16_t duplicates;        // DATA frames received again (ACK lost)
+    uint16_t crc_errors;
+    uint16_t line_errors;       // Frames abandoned on a bad mark or space
+} IR_Link_Stats_t;
+
+// Link context
+typedef struct {
+    IR_TX_HAL_t tx_hal;
+    IR_HAL_t hal;
+
+    // Line coding, see IR_link_set_coding()
+    uint8_t coding;                         // IR_PROTOCOL_NEC or IR_PROTOCOL_PPM
+    uint16_t unit_us;
+    uint16_t unit_ticks;
+    uint16_t ack_timeout;                   // Ticks
+    uint16_t idle_ticks;                    // Silence that abandons a frame being received
+
+    // Frame receiver, written from the edge interrupt
+    volatile uint8_t rx_state;              // IR_Link_RX_State_t
+    volatile uint8_t rx_ready;              // rx_frame holds a whole frame for IR_link_service()
+    uint8_t rx_count;                       // Whole bytes in rx_frame
+    uint8_t rx_bit;
+    uint16_t rx_mark;                       // Last data mark (ticks), PPM periods
+    uint16_t rx_quiet;                      // Ticks since the last edge
+    uint8_t rx_frame[IR_LINK_FRAME_MAX];
+
+    // Sender
+    uint8_t tx_payload[IR_LINK_MAX_PAYLOAD];
+    uint8_t tx_length;
+    uint8_t tx_sequence;
+    uint8_t tx_pending;                     // Payload waiting for its ACK
+    uint8_t tx_tries;
+    uint8_t tx_flags;                       // IR_LINK_FLAG_RESYNC until the first ACK
+    uint8_t tx_status;                      // IR_LINK_TX_* of the last payload
+
+    // ACK timer, counted by IR_link_timeout_advance(). The main loop only
+    // touches the 8-bit flags, so no access to it can be torn
+    uint16_t ack_elapsed;                   // Ticks since the last transmission
+    volatile uint8_t ack_restart;           // Set by the transmitter: restart ack_elapsed
+    volatile uint8_t ack_expired;           // ack_elapsed has reached ack_timeout
+
+    // Receiver side of the protocol
+    uint8_t ack_pending;
+    uint8_t ack_sequence;
+    uint8_t rx_last_type;                   // Header of the last DATA delivered (0xFF: none yet)
+    uint8_t rx_last_sequence;
+    uint8_t data[IR_LINK_MAX_PAYLOAD];
+    uint8_t data_length;
+    uint8_t data_ready;
+
+    IR_Link_Stats_t stats;
+} IR_Link_t;
+
+// Function Declarations
+void IR_link_init(IR_Link_t* link, IR_TX_HAL_t* tx_hal, IR_HAL_t* hal);
+int8_t IR_link_set_coding(IR_Link_t* link, IR_Protocol_t coding);
+int8_t IR_link_send(IR_Link_t* link, const uint8_t* data, uint8_t length);
+uint8_t IR_link_is_busy(IR_Link_t* link);
+uint8_t IR_link_tx_status(IR_Link_t* link);
+int8_t IR_link_receive(IR_Link_t* link, uint8_t* data, uint8_t* length);
+uint8_t IR_link_service(IR_Link_t* link);
+void IR_link_process(IR_Link_t* link, uint8_t pin_value);
+void IR_link_process_duration(IR_Link_t* link, uint8_t pin_value, uint16_t ticks);
+void IR_link_timeout_advance(IR_Link_t* link, uint16_t ticks);
+
+#endif /* IR_LINK_H_ */
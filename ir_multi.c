@@ -0,0 +1,114 @@
+/**
+ * ir_multi.c - Multi-channel IR Decoder Implementation
+ *
+ * Author: Nghia Taarabt
+ */
+
+#include "ir_multi.h"
+
+#define IR_MULTI_QUEUE_MASK     (IR_MULTI_QUEUE_SIZE - 1U)
+
+void IR_multi_init(IR_Multi_t* multi, uint8_t channel_count, IR_Protocol_t protocol, IR_HAL_t* hal)
+{
+    IR_HAL_t channel_hal = {0};
+
+    if(channel_count > IR_MULTI_MAX_CHANNELS)
+        channel_count = IR_MULTI_MAX_CHANNELS;
+
+    multi->channel_count = channel_count;
+    multi->timer_get_count = hal->timer_get_count;
+    multi->queue_head = 0U;
+    multi->queue_tail = 0U;
+    multi->queue_overflows = 0U;
+
+    // Channels are fed intervals by IR_multi_service(), so their decoders
+    // get no timer functions of their own
+    channel_hal.pin_read = hal->pin_read;
+
+    for(uint8_t ch = 0; ch < channel_count; ch++)
+    {
+        multi->last_stamp[ch] = 0U;
+        IR_decoder_init(&multi->decoder[ch], protocol, &channel_hal);
+    }
+
+    // One free-running timer for all channels, never reset per edge
+    if(hal->timer_start)
+        hal->timer_start();
+}
+
+void IR_multi_capture(IR_Multi_t* multi, uint8_t channel, uint8_t pin_value, uint16_t timestamp)
+{
+    uint8_t head = multi->queue_head;
+
+    if((uint8_t)(head - multi->queue_tail) >= IR_MULTI_QUEUE_SIZE)
+    {
+        multi->queue_overflows++;
+        return;
+    }
+
+    multi->queue_stamp[head & IR_MULTI_QUEUE_MASK] = timestamp;
+    multi->queue_entry[head & IR_MULTI_QUEUE_MASK] = channel | (pin_value ? IR_MULTI_LEVEL_FLAG : 0U);
+    multi->queue_head = head + 1U;
+}
+
+uint8_t IR_multi_service(IR_Multi_t* multi)
+{
+    uint8_t ready = 0U;
+    uint16_t now = 0U;
+
+    // Drain queued edges in arrival order
+    while(multi->queue_tail != multi->queue_head)
+    {
+        uint8_t index = multi->queue_tail & IR_MULTI_QUEUE_MASK;
+        uint8_t channel = multi->queue_entry[index] & (uint8_t)~IR_MULTI_LEVEL_FLAG;
+        uint8_t pin_value = (multi->queue_entry[index] & IR_MULTI_LEVEL_FLAG) ? IR_HIGH : IR_LOW;
+        uint16_t stamp = multi->queue_stamp[index];
+
+        multi->queue_tail++;
+
+        if(channel >= multi->channel_count)
+            continue;
+
+        uint16_t interval = stamp - multi->last_stamp[channel];
+        multi->last_stamp[channel] = stamp;
+
+        IR_decoder_process_duration(&multi->decoder[channel], pin_value, IR_US_TO_TICKS(interval));
+    }
+
+    // Sample the timer only after draining so every processed edge is older than 'now'
+    if(multi->timer_get_count)
+        now = multi->timer_get_count();
+
+    for(uint8_t ch = 0; ch < multi->channel_count; ch++)
+    {
+        if(multi->timer_get_count &&
+           multi->decoder[ch].state != IR_STATE_IDLE &&
+           (uint16_t)(now - multi->last_stamp[ch]) > IR_MULTI_IDLE_US)
+        {
+            IR_decoder_expire(&multi->decoder[ch]);
+        }
+
+        if(multi->decoder[ch].decoded_data.valid)
+            ready |= (uint8_t)(1U << ch);
+    }
+
+    return ready;
+}
+
+int8_t IR_multi_get_data(IR_Multi_t* multi, uint8_t channel, IR_Data_t* data)
+{
+    if(channel >= multi->channel_count)
+        return IR_ERROR;
+
+    return IR_decoder_get_data(&multi->decoder[channel], data);
+}
+
+void IR_multi_reset(IR_Multi_t* multi)
+{
+    multi->queue_tail = multi->queue_head;
+
+    for(uint8_t ch = 0; ch < multi->channel_count; ch++)
+    {
+        IR_decoder_reset(&multi->decoder[ch]);
+    }
+}
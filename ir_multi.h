@@ -0,0 +1,60 @@
+/**
+ * ir_multi.h - Multi-channel IR Decoder
+ *
+ * Decodes several IR receivers that share one free-running timer. Edge
+ * interrupts only push (channel, level, timestamp) into a queue; a single
+ * service routine computes intervals and runs each channel's decoder.
+ * Author: Nghia Taarabt
+ */
+
+#ifndef IR_MULTI_H_
+#define IR_MULTI_H_
+
+#include "ir_decoder.h"
+
+// Number of receiver channels
+#ifndef IR_MULTI_MAX_CHANNELS
+#define IR_MULTI_MAX_CHANNELS   (4U)
+#endif
+
+// Edge queue depth, a power of two up to 128 (one NEC frame is 68 edges)
+#ifndef IR_MULTI_QUEUE_SIZE
+#define IR_MULTI_QUEUE_SIZE     (128U)
+#endif
+
+// Silence after which a channel's frame in progress is abandoned (microseconds).
+// IR_multi_service() must run at least every (65536 - IR_MULTI_IDLE_US) us
+// so the 16-bit timestamps do not wrap past it
+#ifndef IR_MULTI_IDLE_US
+#define IR_MULTI_IDLE_US        (20000U)
+#endif
+
+#define IR_MULTI_LEVEL_FLAG     (0x80U)     // Queue entry: level bit next to channel number
+
+// Multi-channel context. The edge queue is split into parallel stamp/entry
+// arrays; each channel keeps a last-edge stamp and a complete IR_Decoder_t,
+// so channels are an array of whole decoder structs, not split per field
+typedef struct {
+    // Edge queue: written by the edge ISRs, read by IR_multi_service()
+    volatile uint16_t queue_stamp[IR_MULTI_QUEUE_SIZE];
+    volatile uint8_t queue_entry[IR_MULTI_QUEUE_SIZE];  // Channel | IR_MULTI_LEVEL_FLAG
+    volatile uint8_t queue_head;
+    volatile uint8_t queue_tail;
+    volatile uint8_t queue_overflows;
+
+    // Per-channel state
+    uint16_t last_stamp[IR_MULTI_MAX_CHANNELS];         // Timestamp of last edge (us)
+    IR_Decoder_t decoder[IR_MULTI_MAX_CHANNELS];
+
+    uint16_t (*timer_get_count)(void);                  // Shared free-running 16-bit us timer
+    uint8_t channel_count;
+} IR_Multi_t;
+
+// Function Declarations
+void IR_multi_init(IR_Multi_t* multi, uint8_t channel_count, IR_Protocol_t protocol, IR_HAL_t* hal);
+void IR_multi_capture(IR_Multi_t* multi, uint8_t channel, uint8_t pin_value, uint16_t timestamp);
+uint8_t IR_multi_service(IR_Multi_t* multi);
+int8_t IR_multi_get_data(IR_Multi_t* multi, uint8_t channel, IR_Data_t* data);
+void IR_multi_reset(IR_Multi_t* multi);
+
+#endif /* IR_MULTI_H_ */
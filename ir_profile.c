@@ -0,0 +1,124 @@
+/**
+ * ir_profile.c - Decoder ISR Cycle Profiling Implementation
+ *
+ * Author: Nghia Taarabt
+ */
+
+#include "ir_profile.h"
+#include <stddef.h>
+
+#if IR_ENABLE_PROFILING && !IR_PROFILE_USE_DWT
+volatile uint32_t IR_profile_mock_cycles = 0U;
+#endif
+
+// Entries are updated from the edge ISR; main-context access masks it so the
+// 64-bit total is never seen half written. Host builds have no interrupts
+#if IR_ENABLE_PROFILING && IR_PROFILE_USE_DWT
+#define IR_PROFILE_LOCK()   const uint32_t ir_profile_primask = __get_PRIMASK(); __disable_irq()
+#define IR_PROFILE_UNLOCK() __set_PRIMASK(ir_profile_primask)
+#else
+#define IR_PROFILE_LOCK()   ((void)0)
+#define IR_PROFILE_UNLOCK() ((void)0)
+#endif
+
+static IR_Profile_Entry_t profile_table[IR_PROFILE_STATE_COUNT][IR_PROFILE_EVENT_COUNT];
+
+static const char* const profile_state_names[IR_PROFILE_STATE_COUNT] = {
+    "IDLE", "INIT", "PROCESS"
+};
+
+static const char* const profile_event_names[IR_PROFILE_EVENT_COUNT] = {
+    "INIT", "DATA", "FINISH", "HOOK"
+};
+
+void IR_profile_record(IR_State_t state, IR_Event_t event, uint32_t cycles)
+{
+    if(state >= IR_PROFILE_STATE_COUNT || event >= IR_PROFILE_EVENT_COUNT)
+        return;
+
+    IR_Profile_Entry_t* entry = &profile_table[state][event];
+
+    if(entry->count == 0U || cycles < entry->min)
+        entry->min = cycles;
+    if(cycles > entry->max)
+        entry->max = cycles;
+    entry->count++;
+    entry->total += cycles;
+}
+
+void IR_profile_reset(void)
+{
+    IR_PROFILE_LOCK();
+    for(uint8_t s = 0; s < IR_PROFILE_STATE_COUNT; s++)
+    {
+        for(uint8_t e = 0; e < IR_PROFILE_EVENT_COUNT; e++)
+        {
+            profile_table[s][e].min = 0U;
+            profile_table[s][e].max = 0U;
+            profile_table[s][e].count = 0U;
+            profile_table[s][e].total = 0U;
+        }
+    }
+    IR_PROFILE_UNLOCK();
+}
+
+const IR_Profile_Entry_t* IR_profile_get(IR_State_t state, IR_Event_t event)
+{
+    if(state >= IR_PROFILE_STATE_COUNT || event >= IR_PROFILE_EVENT_COUNT)
+        return NULL;
+    return &profile_table[state][event];
+}
+
+// Format an unsigned value right-aligned in a 10 character field
+static void profile_format_u32(char* buffer, uint32_t value)
+{
+    uint8_t i = 10U;
+
+    buffer[i] = '\0';
+    do {
+        buffer[--i] = (char)('0' + (value % 10U));
+        value /= 10U;
+    } while(value && i);
+
+    while(i)
+        buffer[--i] = ' ';
+}
+
+void IR_profile_dump(void (*put_string)(const char* str))
+{
+    char number[11];
+
+    put_string("STATE   EVENT        count       min       max      mean\r\n");
+
+    for(uint8_t s = 0; s < IR_PROFILE_STATE_COUNT; s++)
+    {
+        for(uint8_t e = 0; e < IR_PROFILE_EVENT_COUNT; e++)
+        {
+            // Snapshot first: the ISR may update the entry while it is printed
+            IR_Profile_Entry_t entry;
+            {
+                IR_PROFILE_LOCK();
+                entry = profile_table[s][e];
+                IR_PROFILE_UNLOCK();
+            }
+
+            if(entry.count == 0U)
+                continue;
+
+            put_string(profile_state_names[s]);
+            put_string(s == IR_STATE_PROCESS ? " " : "    ");
+            put_string(profile_event_names[e]);
+            put_string(e == 2U ? " " : "   ");
+
+            profile_format_u32(number, entry.count);
+            put_string(number);
+            profile_format_u32(number, entry.min);
+            put_string(number);
+            profile_format_u32(number, entry.max);
+            put_string(number);
+            profile_format_u32(number, (uint32_t)(entry.total / entry.count));
+            put_string(number);
+            put_string("\r\n");
+        }
+    }
+}
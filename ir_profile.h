@@ -0,0 +1,61 @@
+/**
+ * ir_profile.h - Decoder ISR Cycle Profiling
+ *
+ * Compile-time profiling layer recording min/max/mean cycle cost of
+ * IR_decoder_process() for every (IR_State_t, IR_Event_t) pair it is entered with.
+ * Enabled with IR_ENABLE_PROFILING=1; compiles to nothing otherwise.
+ * Author: Nghia Taarabt
+ */
+
+#ifndef IR_PROFILE_H_
+#define IR_PROFILE_H_
+
+#include "ir_decoder.h"
+
+#define IR_PROFILE_STATE_COUNT  (3U)
+#define IR_PROFILE_EVENT_COUNT  (4U)
+
+// Cycle statistics for one (state, event) pair
+typedef struct {
+    uint32_t min;
+    uint32_t max;
+    uint32_t count;
+    uint64_t total;     // Sum of all samples, mean = total / count
+} IR_Profile_Entry_t;
+
+#if IR_ENABLE_PROFILING
+
+#if IR_PROFILE_USE_DWT
+#include IR_PROFILE_DEVICE_HEADER
+
+// Cortex-M DWT->CYCCNT, enabled by the port (see stm32f401_profile_init())
+#define IR_PROFILE_NOW()    (DWT->CYCCNT)
+#else
+// Host builds: mock counter advanced by the test harness or mock HAL
+extern volatile uint32_t IR_profile_mock_cycles;
+#define IR_PROFILE_NOW()    (IR_profile_mock_cycles)
+#endif
+
+#define IR_PROFILE_BEGIN(decoder) \
+    const uint32_t ir_profile_start = IR_PROFILE_NOW(); \
+    const IR_State_t ir_profile_state = (decoder)->state; \
+    const IR_Event_t ir_profile_event = (decoder)->event
+
+#define IR_PROFILE_END() \
+    IR_profile_record(ir_profile_state, ir_profile_event, IR_PROFILE_NOW() - ir_profile_start)
+
+#else
+
+#define IR_PROFILE_BEGIN(decoder)   ((void)0)
+#define IR_PROFILE_END()            ((void)0)
+
+#endif /* IR_ENABLE_PROFILING */
+
+// Function Declarations
+void IR_profile_record(IR_State_t state, IR_Event_t event, uint32_t cycles);
+void IR_profile_reset(void);
+// Live entry, updated by the edge ISR: read it with the ISR masked
+const IR_Profile_Entry_t* IR_profile_get(IR_State_t state, IR_Event_t event);
+void IR_profile_dump(void (*put_string)(const char* str));
+
+#endif /* IR_PROFILE_H_ */
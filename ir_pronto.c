@@ -0,0 +1,337 @@
+/**
+ * ir_pronto.c - Pronto Hex Import/Export Implementation
+ *
+ * Author: Nghia Taarabt
+ */
+
+#include "ir_pronto.h"
+#include "ir_decoder.h"
+#include <string.h>
+
+// Known-form carriers: RC5/RC6 36kHz, NEC 38kHz
+#define IR_PRONTO_FREQ_36K      (0x0073U)
+#define IR_PRONTO_FREQ_38K      (0x006DU)
+
+// Carrier period of a frequency word in 1/256 us: 0.241246us * 256 = 61.759/1000
+static uint32_t IR_pronto_period(uint16_t frequency)
+{
+    return ((uint32_t)frequency * 61759UL + 500UL) / 1000UL;
+}
+
+// Next hex word of the code; IR_ERROR at the end of text or on a bad character
+static int8_t IR_pronto_word(const char** text, uint16_t* word)
+{
+    const char* p = *text;
+    uint8_t digits = 0;
+
+    while(*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+        p++;
+
+    *word = 0;
+    for(;; p++, digits++)
+    {
+        char c = *p;
+        uint8_t nibble;
+
+        if(c >= '0' && c <= '9')
+            nibble = (uint8_t)(c - '0');
+        else if(c >= 'A' && c <= 'F')
+            nibble = (uint8_t)(c - 'A' + 10);
+        else if(c >= 'a' && c <= 'f')
+            nibble = (uint8_t)(c - 'a' + 10);
+        else
+            break;
+
+        if(digits == 4U)
+            return IR_ERROR;
+        *word = (uint16_t)((*word << 4) | nibble);
+    }
+
+    *text = p;
+    if(digits == 0U || (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n'))
+        return IR_ERROR;
+    return IR_SUCCESS;
+}
+
+// Known forms: the protocol's fields to a frame
+static int8_t IR_pronto_parse_known(uint16_t format, uint16_t first, uint16_t second, IR_Data_t* data)
+{
+    (void)first;    // Unused when none of RC5, RC6 and NEC is built in
+    (void)second;
+    memset(data, 0, sizeof(*data));
+
+    switch(format)
+    {
+#if IR_ENABLE_RC5
+        case IR_PRONTO_RC5:
+            if(first > 0x1FU || second > 0x3FU)
+                return IR_ERROR;
+            data->protocol = IR_PROTOCOL_RC5;
+            data->raw_data = IR_encode_rc5_data((uint8_t)first, (uint8_t)second);
+            break;
+#endif
+#if IR_ENABLE_RC6
+        case IR_PRONTO_RC6:
+            if(first > 0xFFU || second > 0xFFU)
+                return IR_ERROR;
+            data->protocol = IR_PROTOCOL_RC6;
+            data->raw_data = IR_encode_rc6_data((uint8_t)first, (uint8_t)second);
+            break;
+#endif
+#if IR_ENABLE_NEC
+        case IR_PRONTO_NEC:
+            // Words are sent high byte first, NEC bytes LSB first
+            data->protocol = IR_PROTOCOL_NEC;
+            data->raw_data = ((uint32_t)(first >> 8)) | ((uint32_t)(first & 0xFFU) << 8) |
+                             ((uint32_t)(second >> 8) << 16) | ((uint32_t)(second & 0xFFU) << 24);
+            if(!IR_validate_protocol_data(IR_PROTOCOL_NEC, data->raw_data))
+                return IR_ERROR;
+            break;
+#endif
+        default:
+            return IR_ERROR;
+    }
+
+    IR_decode_protocol_data((IR_Protocol_t)data->protocol, data->raw_data, &data->address, &data->command);
+#if IR_DECODER_ENABLE_CONFIDENCE
+    // Written out, not measured: every bit is certain
+    data->min_margin = 0xFFU;
+    data->marginal_bits = 0U;
+#endif
+    data->valid = 1;
+    return IR_SUCCESS;
+}
+
+int8_t IR_pronto_parse(const char* text, IR_Pulse_Train_t* train, IR_Data_t* data)
+{
+    uint16_t header[4];
+    uint16_t word;
+    uint32_t period;
+    uint32_t pairs;
+
+    for(uint8_t i = 0; i < 4U; i++)
+    {
+        if(IR_pronto_word(&text, &header[i]) != IR_SUCCESS)
+            return IR_ERROR;
+    }
+    pairs = (uint32_t)header[2] + header[3];
+    if(header[1] == 0U || pairs == 0U)
+        return IR_ERROR;
+
+    if(header[0] != IR_PRONTO_LEARNED && header[0] != IR_PRONTO_UNMODULATED)
+    {
+        uint16_t first;
+        uint16_t second;
+
+        if(data == 0 || IR_pronto_word(&text, &first) != IR_SUCCESS || IR_pronto_word(&text, &second) != IR_SUCCESS)
+            return IR_ERROR;
+        // Known forms may carry more fields than the two used here
+        for(pairs = pairs * 2U - 2U; pairs > 0U; pairs--)
+        {
+            if(IR_pronto_word(&text, &word) != IR_SUCCESS)
+                return IR_ERROR;
+        }
+        if(train)
+            train->count = 0;
+        return IR_pronto_parse_known(header[0], first, second, data);
+    }
+
+    if(train == 0 || pairs * 2U > train->capacity)
+        return IR_ERROR;
+    if(data)
+        data->valid = 0;
+
+    period = IR_pronto_period(header[1]);
+    train->count = 0;
+    train->repeat_index = (header[3] > 0U) ? (uint16_t)(header[2] * 2U) : IR_PULSE_NO_REPEAT;
+    train->carrier_freq = (header[0] == IR_PRONTO_LEARNED) ? IR_PRONTO_CLOCK_HZ / header[1] : 0UL;
+
+    for(pairs *= 2U; pairs > 0U; pairs--)
+    {
+        if(IR_pronto_word(&text, &word) != IR_SUCCESS)
+            return IR_ERROR;
+
+        // Periods to us, rounded and saturated
+        uint32_t us = ((uint32_t)word * period + 128UL) >> 8;
+        if(period > 0U && word > (0xFFFFFFFFUL - 128UL) / period)
+            us = IR_PULSE_MAX_US;
+
+        // Written directly: Pronto sequences alternate even with zero durations
+        train->durations[train->count++] = (us > IR_PULSE_MAX_US) ? IR_PULSE_MAX_US : (uint16_t)us;
+    }
+
+    // Nothing but whitespace may follow
+    while(*text == ' ' || *text == '\t' || *text == '\r' || *text == '\n')
+        text++;
+    return (*text == '\0') ? IR_SUCCESS : IR_ERROR;
+}
+
+// Write "XXXX" and a NUL, return the position of the NUL
+static char* IR_pronto_put(char* text, uint16_t word)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    for(uint8_t shift = 16U; shift > 0U;)
+    {
+        shift -= 4U;
+        *text++ = hex[(word >> shift) & 0x0FU];
+    }
+    *text = '\0';
+    return text;
+}
+
+// Words separated by spaces; the position of the NUL, or NULL if size is too small
+static char* IR_pronto_put_words(char* text, uint16_t size, const uint16_t* words, uint8_t count)
+{
+    if(size < (uint16_t)count * 5U)
+        return NULL;
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        if(i > 0U)
+            *text++ = ' ';
+        text = IR_pronto_put(text, words[i]);
+    }
+    return text;
+}
+
+// Duration in us to carrier periods, at least one
+static uint16_t IR_pronto_periods(uint16_t us, uint32_t period)
+{
+    uint32_t periods = (((uint32_t)us << 8) + period / 2U) / period;
+
+    if(periods == 0U)
+        return 1U;
+    return (periods > 0xFFFFU) ? 0xFFFFU : (uint16_t)periods;
+}
+
+int8_t IR_pronto_encode_train(const IR_Pulse_Train_t* train, char* text, uint16_t size)
+{
+    uint32_t hz = train->carrier_freq ? train->carrier_freq : IR_PRONTO_UNMODULATED_HZ;
+    uint16_t once = (train->repeat_index < train->count) ? train->repeat_index : train->count;
+    uint16_t lengths[2];
+    uint16_t header[4];
+    uint32_t period;
+
+    if(train->count == 0U || hz > IR_PRONTO_CLOCK_HZ)
+        return IR_ERROR;
+
+    // Each sequence is whole pairs: a last mark gets a gap after it
+    lengths[0] = (uint16_t)((once + 1U) & ~1U);
+    lengths[1] = (uint16_t)((train->count - once + 1U) & ~1U);
+
+    header[0] = train->carrier_freq ? IR_PRONTO_LEARNED : IR_PRONTO_UNMODULATED;
+    header[1] = (uint16_t)((IR_PRONTO_CLOCK_HZ + hz / 2U) / hz);
+    header[2] = lengths[0] / 2U;
+    header[3] = lengths[1] / 2U;
+    if(size < IR_PRONTO_TEXT_SIZE((uint32_t)lengths[0] + lengths[1]))
+        return IR_ERROR;
+    text = IR_pronto_put_words(text, size, header, 4U);
+    if(text == NULL)
+        return IR_ERROR;
+
+    period = IR_pronto_period(header[1]);
+
+    for(uint8_t sequence = 0; sequence < 2U; sequence++)
+    {
+        uint16_t start = sequence ? once : 0U;
+        uint16_t end = sequence ? train->count : once;
+
+        for(uint16_t i = start; i < start + lengths[sequence]; i++)
+        {
+            *text++ = ' ';
+            text = IR_pronto_put(text, IR_pronto_periods((i < end) ? train->durations[i] : IR_PRONTO_GAP_US, period));
+        }
+    }
+    return IR_SUCCESS;
+}
+
+int8_t IR_pronto_encode_data(const IR_Data_t* data, char* text, uint16_t size)
+{
+    uint16_t words[6] = { 0, 0, 0x0000U, 0x0001U, 0, 0 };
+
+    switch(data->protocol)
+    {
+        case IR_PROTOCOL_RC5:
+            words[0] = IR_PRONTO_RC5;
+            words[1] = IR_PRONTO_FREQ_36K;
+            words[4] = data->address & 0x1FU;
+            words[5] = data->command & 0x3FU;
+            break;
+        case IR_PROTOCOL_RC6:
+            words[0] = IR_PRONTO_RC6;
+            words[1] = IR_PRONTO_FREQ_36K;
+            words[4] = data->address;
+            words[5] = data->command;
+            break;
+        case IR_PROTOCOL_NEC:
+            words[0] = IR_PRONTO_NEC;
+            words[1] = IR_PRONTO_FREQ_38K;
+            words[4] = (uint16_t)(((data->raw_data & 0xFFU) << 8) | ((data->raw_data >> 8) & 0xFFU));
+            words[5] = (uint16_t)((((data->raw_data >> 16) & 0xFFU) << 8) | ((data->raw_data >> 24) & 0xFFU));
+            break;
+        default:
+            return IR_ERROR;
+    }
+
+    return IR_pronto_put_words(text, size, words, 6U) ? IR_SUCCESS : IR_ERROR;
+}
+
+int8_t IR_pronto_data_to_train(const IR_Data_t* data, IR_Pulse_Train_t* train)
+{
+    IR_Transmitter_t coder;
+    IR_TX_HAL_t none;
+
+    if(IR_get_protocol_info((IR_Protocol_t)data->protocol) == NULL)
+        return IR_ERROR;
+
+    // Timing only: the coder never transmits
+    memset(&none, 0, sizeof(none));
+    IR_transmitter_init(&coder, (IR_Protocol_t)data->protocol, &none);
+
+    train->count = 0;
+    if(coder.protocol_config.repeat_space_us == 0U)
+    {
+        train->repeat_index = 0;
+        return IR_transmitter_render(&coder, data->raw_data, train, IR_PRONTO_GAP_US);
+    }
+
+    if(IR_transmitter_render(&coder, data->raw_data, train, IR_PRONTO_GAP_US) != IR_SUCCESS)
+        return IR_ERROR;
+    train->repeat_index = train->count;
+    return IR_transmitter_render_repeat(&coder, train, IR_PRONTO_GAP_US);
+}
+
+int8_t IR_pronto_train_to_data(const IR_Pulse_Train_t* train, IR_Protocol_t protocol, IR_Data_t* data)
+{
+    IR_Decoder_t decoder;
+    IR_HAL_t none;
+
+    // Durations are fed straight in: no timer or pin is used
+    memset(&none, 0, sizeof(none));
+    IR_decoder_init(&decoder, protocol, &none);
+
+    for(uint16_t i = 0; i < train->count; i++)
+    {
+        if(i & 1U)
+            continue;
+        IR_decoder_process_duration(&decoder, IR_HIGH, i ? IR_US_TO_TICKS(train->durations[i - 1U]) : 0xFFFFU);
+        IR_decoder_process_duration(&decoder, IR_LOW, IR_US_TO_TICKS(train->durations[i]));
+        if(decoder.decoded_data.valid)
+            break;
+    }
+
+    return IR_decoder_get_data(&decoder, data);
+}
+
+int8_t IR_pronto_send(IR_Transmitter_t* transmitter, const char* text, IR_Pulse_Train_t* train, uint8_t repeat_count)
+{
+    IR_Data_t data;
+
+    if(IR_pronto_parse(text, train, &data) != IR_SUCCESS)
+        return IR_ERROR;
+    if(data.valid && IR_pronto_data_to_train(&data, train) != IR_SUCCESS)
+        return IR_ERROR;
+
+    return IR_transmitter_send_pulses(transmitter, train, repeat_count);
+}
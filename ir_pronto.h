@@ -0,0 +1,76 @@
+/**
+ * ir_pronto.h - Pronto Hex Import/Export
+ *
+ * Converts Pronto hex codes, the format of most IR code databases, to and
+ * from IR_Pulse_Train_t and IR_Data_t. A code is a list of 16-bit hex words:
+ *
+ *   0     format: IR_PRONTO_LEARNED/UNMODULATED, or a known protocol
+ *   1     carrier period in units of 0.241246us (IR_PRONTO_CLOCK_HZ / Hz)
+ *   2     burst pairs in the once sequence
+ *   3     burst pairs in the repeat sequence
+ *   4..   learned: mark/space durations in carrier periods, once sequence
+ *         first; known forms: the protocol's fields
+ *
+ * Known forms: RC5 "5000 0073 0000 0001 system command", RC6 (mode 0)
+ * "6000 0073 0000 0001 system command", NEC "900A 006D 0000 0001 DDdd CCcc"
+ * with the device byte and its inverse (or the extended address low byte),
+ * then the command and its inverse.
+ *
+ * Nothing is allocated: text is parsed in place into the caller's pulse
+ * train buffer, and encoders write into a caller's character buffer.
+ * Author: Nghia Taarabt
+ */
+
+#ifndef IR_PRONTO_H_
+#define IR_PRONTO_H_
+
+#include "ir_common.h"
+#include "ir_transmitter.h"
+
+// Space after each frame rendered from an IR_Data_t (us)
+#ifndef IR_PRONTO_GAP_US
+#define IR_PRONTO_GAP_US        (40000U)
+#endif
+
+// Format words
+#define IR_PRONTO_LEARNED       (0x0000U)
+#define IR_PRONTO_UNMODULATED   (0x0100U)
+#define IR_PRONTO_RC5           (0x5000U)
+#define IR_PRONTO_RC6           (0x6000U)
+#define IR_PRONTO_NEC           (0x900AU)
+
+// Pronto clock: frequency word = IR_PRONTO_CLOCK_HZ / carrier Hz
+#define IR_PRONTO_CLOCK_HZ      (4145146UL)
+
+// Time base of IR_PRONTO_UNMODULATED codes encoded from a train without carrier
+#define IR_PRONTO_UNMODULATED_HZ    (38000UL)
+
+// Text buffer for a code of n durations (n rounded up to even per sequence),
+// "XXXX " per word with the NUL in place of the last space
+#define IR_PRONTO_TEXT_SIZE(n)  ((4U + (n)) * 5U)
+
+// Function Declarations
+
+// Parse a code. Learned forms fill train (durations in us, repeat_index at
+// the repeat sequence) and clear data->valid; known forms fill data and
+// leave train empty. Either pointer may be NULL if that form is not wanted
+int8_t IR_pronto_parse(const char* text, IR_Pulse_Train_t* train, IR_Data_t* data);
+
+// Learned form of a train (IR_PRONTO_UNMODULATED when carrier_freq is 0)
+int8_t IR_pronto_encode_train(const IR_Pulse_Train_t* train, char* text, uint16_t size);
+
+// Known form of a frame; IR_ERROR for protocols without one
+int8_t IR_pronto_encode_data(const IR_Data_t* data, char* text, uint16_t size);
+
+// Frame to train with the transmitter's timing: once sequence frame and
+// repeat sequence repeat code, or only the frame as repeat sequence for
+// protocols without a repeat code
+int8_t IR_pronto_data_to_train(const IR_Data_t* data, IR_Pulse_Train_t* train);
+
+// Run the protocol's decoder over a train
+int8_t IR_pronto_train_to_data(const IR_Pulse_Train_t* train, IR_Protocol_t protocol, IR_Data_t* data);
+
+// Parse any form into train and transmit it at the code's carrier
+int8_t IR_pronto_send(IR_Transmitter_t* transmitter, const char* text, IR_Pulse_Train_t* train, uint8_t repeat_count);
+
+#endif /* IR_PRONTO_H_ */
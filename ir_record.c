@@ -0,0 +1,52 @@
+/**
+ * ir_record.c - Compact Binary Frame Records Implementation
+ *
+ * Author: Nghia Taarabt
+ */
+
+#include "ir_record.h"
+#include <string.h>
+
+static void IR_record_put32(uint8_t* out, uint32_t value)
+{
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t IR_record_get32(const uint8_t* in)
+{
+    return ((uint32_t)in[0]) | ((uint32_t)in[1] << 8) |
+           ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+uint8_t IR_record_encode(const IR_Data_t* data, uint32_t timestamp, uint8_t* record)
+{
+    record[0] = IR_RECORD_SYNC;
+    record[1] = (uint8_t)((data->protocol << 4) | (data->flags & 0x0FU));
+    IR_record_put32(&record[2], data->raw_data);
+    record[6] = data->address;
+    record[7] = data->command;
+    IR_record_put32(&record[8], timestamp);
+    record[12] = IR_crc8(&record[1], IR_RECORD_SIZE - 2U);
+
+    return IR_RECORD_SIZE;
+}
+
+int8_t IR_record_decode(const uint8_t* record, IR_Data_t* data, uint32_t* timestamp)
+{
+    if(record[0] != IR_RECORD_SYNC || IR_crc8(&record[1], IR_RECORD_SIZE - 2U) != record[12])
+        return IR_ERROR;
+
+    memset(data, 0, sizeof(*data));
+    data->protocol = (uint8_t)(record[1] >> 4);
+    data->flags = (uint8_t)(record[1] & 0x0FU);
+    data->raw_data = IR_record_get32(&record[2]);
+    data->address = record[6];
+    data->command = record[7];
+    data->valid = 1;
+    *timestamp = IR_record_get32(&record[8]);
+
+    return IR_SUCCESS;
+}
@@ -0,0 +1,31 @@
+/**
+ * ir_record.h - Compact Binary Frame Records
+ *
+ * Fixed 13-byte record per decoded frame for reporting over a byte stream
+ * (UART, log file). A sync byte and a trailing CRC-8 let a reader find
+ * record boundaries again after lost or corrupted bytes. Multi-byte fields
+ * are little-endian:
+ *
+ *   0     sync (IR_RECORD_SYNC)
+ *   1     protocol (bits 7..4) | IR_DATA_FLAG_* (bits 3..0)
+ *   2..5  raw data
+ *   6     address
+ *   7     command
+ *   8..11 timestamp (us, wraps)
+ *   12    CRC-8 of bytes 1..11 (IR_crc8())
+ * Author: Nghia Taarabt
+ */
+
+#ifndef IR_RECORD_H_
+#define IR_RECORD_H_
+
+#include "ir_common.h"
+
+#define IR_RECORD_SYNC      (0xA5U)
+#define IR_RECORD_SIZE      (13U)
+
+// Function Declarations
+uint8_t IR_record_encode(const IR_Data_t* data, uint32_t timestamp, uint8_t* record);
+int8_t IR_record_decode(const uint8_t* record, IR_Data_t* data, uint32_t* timestamp);
+
+#endif /* IR_RECORD_H_ */
@@ -0,0 +1,428 @@
+/**
+ * ir_store.c - Persistent Learned-code Store Implementation
+ *
+ * Author: Nghia Taarabt
+ */
+
+#include "ir_store.h"
+#include <string.h>
+
+#define IR_STORE_CRC_LENGTH     (IR_STORE_RECORD_SIZE - 1U)
+
+static uint16_t IR_store_address(IR_Store_t* store, uint16_t position)
+{
+    uint8_t page = (uint8_t)(position / store->page_records);
+    uint16_t offset = (uint16_t)(position - page * store->page_records) * IR_STORE_RECORD_SIZE;
+
+    return (uint16_t)(page * store->hal.page_size + offset);
+}
+
+static uint16_t IR_store_next(IR_Store_t* store, uint16_t position)
+{
+    position++;
+    if(position >= store->record_count)
+        position = 0U;
+
+    return position;
+}
+
+static uint8_t IR_store_page_of(IR_Store_t* store, uint16_t position)
+{
+    return (uint8_t)(position / store->page_records);
+}
+
+static uint8_t IR_store_next_page(IR_Store_t* store, uint8_t page)
+{
+    page++;
+    if(page >= store->hal.page_count)
+        page = 0U;
+
+    return page;
+}
+
+static uint16_t IR_store_sequence(const uint8_t* record)
+{
+    return (uint16_t)(record[6] | ((uint16_t)record[7] << 8));
+}
+
+// Sequence numbers wrap; a record is newer if it is less than half the
+// sequence space ahead. The log never holds more than record_count records
+static uint8_t IR_store_newer(uint16_t sequence, uint16_t than)
+{
+    return (int16_t)(uint16_t)(sequence - than) > 0;
+}
+
+static void IR_store_read(IR_Store_t* store, uint16_t position, uint8_t* record)
+{
+    store->hal.read(IR_store_address(store, position), record, IR_STORE_RECORD_SIZE);
+}
+
+static uint8_t IR_store_record_valid(const uint8_t* record)
+{
+    return record[0] < IR_STORE_SLOTS && IR_crc8(record, IR_STORE_CRC_LENGTH) == record[IR_STORE_CRC_LENGTH];
+}
+
+static uint8_t IR_store_record_erased(const uint8_t* record)
+{
+    for(uint8_t i = 0; i < IR_STORE_RECORD_SIZE; i++)
+    {
+        if(record[i] != 0xFFU)
+            return 0U;
+    }
+
+    return 1U;
+}
+
+static uint8_t IR_store_position_dirty(IR_Store_t* store, uint16_t position)
+{
+    uint8_t record[IR_STORE_RECORD_SIZE];
+
+    IR_store_read(store, position, record);
+    return !IR_store_record_erased(record);
+}
+
+static uint8_t IR_store_page_erased(IR_Store_t* store, uint8_t page)
+{
+    uint16_t position = (uint16_t)(page * store->page_records);
+
+    for(uint16_t i = 0; i < store->page_records; i++)
+    {
+        if(IR_store_position_dirty(store, position + i))
+            return 0U;
+    }
+
+    return 1U;
+}
+
+// Stamp record[] with the next sequence number and its CRC, then program it at the head
+static void IR_store_begin_program(IR_Store_t* store, uint8_t relocating)
+{
+    store->record[6] = (uint8_t)store->sequence;
+    store->record[7] = (uint8_t)(store->sequence >> 8);
+    store->record[IR_STORE_CRC_LENGTH] = IR_crc8(store->record, IR_STORE_CRC_LENGTH);
+    store->sequence++;
+
+    store->relocating = relocating;
+    store->cursor = 0U;
+    store->state = IR_STORE_PROGRAM;
+}
+
+static void IR_store_begin_reclaim(IR_Store_t* store, uint8_t page)
+{
+    store->reclaim_page = page;
+    store->reclaim_position = (uint16_t)(page * store->page_records);
+    store->state = IR_STORE_RECLAIM;
+}
+
+static void IR_store_fill(uint8_t protocol_flags, uint32_t raw_data, IR_Data_t* data)
+{
+    memset(data, 0, sizeof(*data));
+    data->protocol = (IR_Protocol_t)(protocol_flags >> 4);
+    data->flags = (uint8_t)(protocol_flags & 0x0FU);
+    data->raw_data = raw_data;
+    IR_decode_protocol_data(data->protocol, raw_data, &data->address, &data->command);
+    data->valid = 1;
+}
+
+static uint32_t IR_store_raw(const uint8_t* record)
+{
+    return ((uint32_t)record[2]) | ((uint32_t)record[3] << 8) |
+           ((uint32_t)record[4] << 16) | ((uint32_t)record[5] << 24);
+}
+
+int8_t IR_store_init(IR_Store_t* store, const IR_Store_HAL_t* hal)
+{
+    uint8_t record[IR_STORE_RECORD_SIZE];
+    uint16_t newest = IR_STORE_NONE;
+    uint16_t newest_sequence = 0U;
+
+    if(hal->page_count < 2U || hal->page_size < IR_STORE_RECORD_SIZE)
+        return IR_ERROR;
+
+    memset(store, 0, sizeof(*store));
+    store->hal = *hal;
+    store->page_records = hal->page_size / IR_STORE_RECORD_SIZE;
+    store->record_count = (uint16_t)(store->page_records * hal->page_count);
+
+    // A reclaim copies at most one page of live records into the page
+    // before it; with fewer slots than this the ring can never fill up
+    if((uint32_t)IR_STORE_SLOTS >= (uint32_t)(hal->page_count - 1U) * store->page_records)
+        return IR_ERROR;
+
+    for(uint8_t slot = 0; slot < IR_STORE_SLOTS; slot++)
+    {
+        store->index[slot] = IR_STORE_NONE;
+    }
+
+    // Rebuild the index: the newest valid record of each slot wins
+    for(uint16_t position = 0; position < store->record_count; position++)
+    {
+        IR_store_read(store, position, record);
+        if(!IR_store_record_valid(record))
+            continue;
+
+        uint8_t slot = record[0];
+        uint16_t sequence = IR_store_sequence(record);
+
+        if(store->index[slot] == IR_STORE_NONE)
+        {
+            store->index[slot] = position;
+        }
+        else
+        {
+            uint8_t current[IR_STORE_RECORD_SIZE];
+            IR_store_read(store, store->index[slot], current);
+            if(IR_store_newer(sequence, IR_store_sequence(current)))
+                store->index[slot] = position;
+        }
+
+        if(newest == IR_STORE_NONE || IR_store_newer(sequence, newest_sequence))
+        {
+            newest = position;
+            newest_sequence = sequence;
+        }
+    }
+
+    if(newest != IR_STORE_NONE)
+    {
+        store->head = IR_store_next(store, newest);
+        store->sequence = (uint16_t)(newest_sequence + 1U);
+    }
+
+    // A reset can leave a record half programmed. EEPROM cells are simply
+    // programmed again; flash positions that are not erased are skipped
+    if(store->hal.erase)
+    {
+        for(uint16_t i = 0; i < store->record_count && IR_store_position_dirty(store, store->head); i++)
+        {
+            store->head = IR_store_next(store, store->head);
+        }
+    }
+
+    // The page after the head must hold no live records, and on flash be
+    // erased: finish a reclaim cut short by a reset. EEPROM pages keep their
+    // superseded records, so the spare page is always rescanned; that
+    // programs nothing unless a reclaim was interrupted
+    uint8_t spare = IR_store_next_page(store, IR_store_page_of(store, store->head));
+    if(!store->hal.erase || !IR_store_page_erased(store, spare))
+        IR_store_begin_reclaim(store, spare);
+
+    return IR_SUCCESS;
+}
+
+int8_t IR_store_put(IR_Store_t* store, uint8_t slot, const IR_Data_t* data)
+{
+    IR_Store_Entry_t* entry = 0;
+
+    if(slot >= IR_STORE_SLOTS)
+        return IR_ERROR;
+
+    // A slot written again before its record reached storage is written once
+    for(uint8_t i = 0; i < store->queue_count; i++)
+    {
+        IR_Store_Entry_t* queued = &store->queue[(store->queue_head + i) % IR_STORE_QUEUE_SIZE];
+        if(queued->slot == slot)
+            entry = queued;
+    }
+
+    if(!entry)
+    {
+        if(store->queue_count >= IR_STORE_QUEUE_SIZE)
+            return IR_ERROR;
+
+        entry = &store->queue[(store->queue_head + store->queue_count) % IR_STORE_QUEUE_SIZE];
+        store->queue_count++;
+    }
+
+    entry->slot = slot;
+    entry->protocol_flags = (uint8_t)((data->protocol << 4) | (data->flags & 0x0FU));
+    entry->raw_data = data->raw_data;
+
+    return IR_SUCCESS;
+}
+
+int8_t IR_store_get(IR_Store_t* store, uint8_t slot, IR_Data_t* data)
+{
+    uint8_t record[IR_STORE_RECORD_SIZE];
+
+    if(slot >= IR_STORE_SLOTS)
+        return IR_ERROR;
+
+    // Queued and in-flight records are newer than anything in storage
+    for(uint8_t i = 0; i < store->queue_count; i++)
+    {
+        IR_Store_Entry_t* queued = &store->queue[(store->queue_head + i) % IR_STORE_QUEUE_SIZE];
+        if(queued->slot == slot)
+        {
+            IR_store_fill(queued->protocol_flags, queued->raw_data, data);
+            return IR_SUCCESS;
+        }
+    }
+
+    if(store->state == IR_STORE_PROGRAM && !store->relocating && store->record[0] == slot)
+    {
+        IR_store_fill(store->record[1], IR_store_raw(store->record), data);
+        return IR_SUCCESS;
+    }
+
+    if(store->index[slot] == IR_STORE_NONE)
+        return IR_ERROR;
+
+    IR_store_read(store, store->index[slot], record);
+    if(!IR_store_record_valid(record))
+        return IR_ERROR;
+
+    IR_store_fill(record[1], IR_store_raw(record), data);
+    return IR_SUCCESS;
+}
+
+uint8_t IR_store_service(IR_Store_t* store)
+{
+    if(store->hal.busy && store->hal.busy())
+        return 1U;
+
+    switch(store->state)
+    {
+    case IR_STORE_PROGRAM:
+        // Bytes already holding their value are skipped: no wear, no wait
+        while(store->cursor < IR_STORE_RECORD_SIZE)
+        {
+            uint16_t address = IR_store_address(store, store->head) + store->cursor;
+            uint8_t value = store->record[store->cursor++];
+            uint8_t current;
+
+            store->hal.read(address, &current, 1U);
+            if(current != value)
+            {
+                store->hal.program(address, value);
+                return 1U;
+            }
+        }
+
+        // Whole record programmed: it supersedes the slot's previous record
+        store->index[store->record[0]] = store->head;
+        store->head = IR_store_next(store, store->head);
+
+        if(store->relocating)
+            store->state = IR_STORE_RECLAIM;
+        else if(store->head % store->page_records == 0U)
+            IR_store_begin_reclaim(store, IR_store_next_page(store, IR_store_page_of(store, store->head)));
+        else
+            store->state = IR_STORE_IDLE;
+        return 1U;
+
+    case IR_STORE_RECLAIM:
+    {
+        uint16_t page_end = (uint16_t)((store->reclaim_page + 1U) * store->page_records);
+
+        while(store->reclaim_position < page_end)
+        {
+            uint16_t position = store->reclaim_position++;
+
+            IR_store_read(store, position, store->record);
+            if(IR_store_record_valid(store->record) && store->index[store->record[0]] == position)
+            {
+                // Still live: copy it to the head under a new sequence number.
+                // Flash positions dirtied by resets are stepped over; if that
+                // leaves no room before this page, the page is not reclaimed
+                // this time round and its records stay where they are
+                while(store->hal.erase && IR_store_page_of(store, store->head) != store->reclaim_page &&
+                      IR_store_position_dirty(store, store->head))
+                {
+                    store->head = IR_store_next(store, store->head);
+                }
+
+                if(IR_store_page_of(store, store->head) == store->reclaim_page)
+                {
+                    store->state = IR_STORE_IDLE;
+                    return 1U;
+                }
+
+                IR_store_begin_program(store, 1U);
+                return 1U;
+            }
+        }
+
+        store->relocating = 0U;
+        store->erase_started = 0U;
+        store->state = IR_STORE_ERASE;
+        return 1U;
+    }
+
+    case IR_STORE_ERASE:
+        // Flash pages are erased before the head comes back to them. EEPROM
+        // cells are rewritten in place and need nothing here
+        if(IR_store_erase_pending(store))
+        {
+            // An erase that stalls the CPU waits for the caller
+            if(store->hal.erase_deferred)
+                return 0U;
+
+            IR_store_erase_now(store);
+            return 1U;
+        }
+
+        // Copies filled the head page up to the page just reclaimed: reclaim the next one
+        if(IR_store_page_of(store, store->head) == store->reclaim_page)
+            IR_store_begin_reclaim(store, IR_store_next_page(store, store->reclaim_page));
+        else
+            store->state = IR_STORE_IDLE;
+        return 1U;
+
+    default:
+    {
+        if(store->queue_count == 0U)
+            return 0U;
+
+        // Flash cannot be programmed twice: step over a position left dirty by a reset
+        if(store->hal.erase && IR_store_position_dirty(store, store->head))
+        {
+            store->head = IR_store_next(store, store->head);
+            if(store->head % store->page_records == 0U)
+                IR_store_begin_reclaim(store, IR_store_next_page(store, IR_store_page_of(store, store->head)));
+            return 1U;
+        }
+
+        IR_Store_Entry_t* entry = &store->queue[store->queue_head];
+
+        store->record[0] = entry->slot;
+        store->record[1] = entry->protocol_flags;
+        store->record[2] = (uint8_t)entry->raw_data;
+        store->record[3] = (uint8_t)(entry->raw_data >> 8);
+        store->record[4] = (uint8_t)(entry->raw_data >> 16);
+        store->record[5] = (uint8_t)(entry->raw_data >> 24);
+
+        store->queue_head = (uint8_t)((store->queue_head + 1U) % IR_STORE_QUEUE_SIZE);
+        store->queue_count--;
+
+        IR_store_begin_program(store, 0U);
+        return 1U;
+    }
+    }
+}
+
+// A page erase is due and has not been started
+uint8_t IR_store_erase_pending(IR_Store_t* store)
+{
+    return store->state == IR_STORE_ERASE && store->hal.erase && !store->erase_started;
+}
+
+// Start the pending page erase. With erase_deferred the caller picks the
+// moment, e.g. when no frame is being received, since the CPU may stall
+void IR_store_erase_now(IR_Store_t* store)
+{
+    if(!IR_store_erase_pending(store))
+        return;
+
+    // The last byte program of a reclaim copy may still be finishing
+    while(store->hal.busy && store->hal.busy());
+
+    store->hal.erase(store->reclaim_page);
+    store->erase_started = 1U;
+}
+
+// Stops early, with IR_store_erase_pending() true, when a deferred erase is due
+void IR_store_flush(IR_Store_t* store)
+{
+    while(IR_store_service(store));
+}
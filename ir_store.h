@@ -0,0 +1,109 @@
+/**
+ * ir_store.h - Persistent Learned-code Store
+ *
+ * Keeps one IR_Data_t per slot in EEPROM or flash as an append-only log of
+ * CRC-checked records. The storage area is split into erase pages used as
+ * a ring: records are appended at the head, and whenever the head enters a
+ * page the page after it is reclaimed (live records copied forward, page
+ * erased). Every cell is therefore written once per pass over the whole
+ * area. A RAM index maps each slot to its newest record, so lookups are
+ * O(1) reads.
+ *
+ * IR_store_put() only queues a record. IR_store_service(), polled from the
+ * main loop, starts one byte program or page erase per call whenever the
+ * storage is not busy, so no caller waits on EEPROM/flash write latency.
+ * Bytes that already hold their value are not programmed again. EEPROM
+ * cells are rewritten in place, so a reclaimed EEPROM page is not cleared:
+ * its superseded records simply lose to the newer copies. Where an erase
+ * stalls the CPU (erase_deferred), the store waits in IR_STORE_ERASE until
+ * the caller starts it with IR_store_erase_now() at a moment of its choosing.
+ * Record layout (IR_STORE_RECORD_SIZE bytes, multi-byte fields little-endian):
+ *
+ *   0     slot (0xFF in an erased record)
+ *   1     protocol (bits 7..4) | IR_DATA_FLAG_* (bits 3..0)
+ *   2..5  raw data
+ *   6..7  sequence number, increments per record written
+ *   8     CRC-8 of bytes 0..7 (IR_crc8())
+ *
+ * A record cut short by a reset fails its CRC and is skipped; an
+ * interrupted page reclaim is finished by IR_store_init(). On flash the
+ * half-programmed position stays unusable until its page is erased, so
+ * leave headroom between IR_STORE_SLOTS and the records per page.
+ * Author: Nghia Taarabt
+ */
+
+#ifndef IR_STORE_H_
+#define IR_STORE_H_
+
+#include "ir_common.h"
+
+// Slots per store, at most 255. Must stay below (page_count - 1) * records per page
+#ifndef IR_STORE_SLOTS
+#define IR_STORE_SLOTS          (4U)
+#endif
+
+// Records waiting for IR_store_service()
+#ifndef IR_STORE_QUEUE_SIZE
+#define IR_STORE_QUEUE_SIZE     (2U)
+#endif
+
+#define IR_STORE_RECORD_SIZE    (9U)
+#define IR_STORE_NONE           (0xFFFFU)   // Index entry of a slot never written
+
+// Storage HAL. Addresses are byte offsets into the store area. program()
+// and erase() only start the operation; busy() reports completion
+typedef struct {
+    void (*read)(uint16_t address, uint8_t* data, uint16_t length);
+    void (*program)(uint16_t address, uint8_t value);
+    void (*erase)(uint8_t page);            // NULL: cells are rewritten in place (EEPROM)
+    uint8_t (*busy)(void);
+    uint16_t page_size;                     // Bytes per erase page
+    uint8_t page_count;                     // At least 2
+    uint8_t erase_deferred;                 // erase() stalls the CPU: only IR_store_erase_now() starts it
+} IR_Store_HAL_t;
+
+// Store service states
+typedef enum {
+    IR_STORE_IDLE = 0,
+    IR_STORE_PROGRAM,                       // Programming record[] at the head
+    IR_STORE_RECLAIM,                       // Copying live records out of reclaim_page
+    IR_STORE_ERASE                          // Erasing reclaim_page, or waiting to
+} IR_Store_State_t;
+
+// Queued record
+typedef struct {
+    uint32_t raw_data;
+    uint8_t slot;
+    uint8_t protocol_flags;                 // As record byte 1
+} IR_Store_Entry_t;
+
+// Store context
+typedef struct {
+    IR_Store_HAL_t hal;
+    uint16_t index[IR_STORE_SLOTS];         // Log position of each slot's newest record
+    uint16_t record_count;                  // Log positions in the whole area
+    uint16_t page_records;                  // Log positions per page
+    uint16_t head;                          // Next log position to program
+    uint16_t sequence;                      // Sequence number of the next record
+    uint16_t reclaim_position;              // Next position of reclaim_page to examine
+    uint8_t reclaim_page;
+    uint8_t erase_started;                  // hal.erase() of reclaim_page issued
+    uint8_t cursor;                         // Next byte of record[] to program
+    uint8_t state;                          // IR_Store_State_t
+    uint8_t relocating;                     // record[] is a copy made by the reclaim
+    uint8_t record[IR_STORE_RECORD_SIZE];   // Record being programmed
+    IR_Store_Entry_t queue[IR_STORE_QUEUE_SIZE];
+    uint8_t queue_head;
+    uint8_t queue_count;
+} IR_Store_t;
+
+// Function Declarations
+int8_t IR_store_init(IR_Store_t* store, const IR_Store_HAL_t* hal);
+int8_t IR_store_put(IR_Store_t* store, uint8_t slot, const IR_Data_t* data);
+int8_t IR_store_get(IR_Store_t* store, uint8_t slot, IR_Data_t* data);
+uint8_t IR_store_service(IR_Store_t* store);
+uint8_t IR_store_erase_pending(IR_Store_t* store);
+void IR_store_erase_now(IR_Store_t* store);
+void IR_store_flush(IR_Store_t* store);
+
+#endif /* IR_STORE_H_ */
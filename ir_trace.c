@@ -0,0 +1,50 @@
+/**
+ * ir_trace.c - Binary Edge Trace Format Implementation
+ *
+ * Author: Nghia Taarabt
+ */
+
+#include "ir_trace.h"
+#include <string.h>
+
+uint8_t IR_trace_header(uint8_t* out, uint32_t unit_ns)
+{
+    memset(out, 0, IR_TRACE_HEADER_SIZE);
+    memcpy(out, IR_TRACE_MAGIC, 4);
+    out[4] = IR_TRACE_VERSION;
+    out[8] = (uint8_t)unit_ns;
+    out[9] = (uint8_t)(unit_ns >> 8);
+    out[10] = (uint8_t)(unit_ns >> 16);
+    out[11] = (uint8_t)(unit_ns >> 24);
+
+    return IR_TRACE_HEADER_SIZE;
+}
+
+int8_t IR_trace_check_header(const uint8_t* in, uint32_t length, uint32_t* unit_ns)
+{
+    if(length < IR_TRACE_HEADER_SIZE || memcmp(in, IR_TRACE_MAGIC, 4) != 0 || in[4] != IR_TRACE_VERSION)
+        return IR_ERROR;
+
+    *unit_ns = ((uint32_t)in[8]) | ((uint32_t)in[9] << 8) | ((uint32_t)in[10] << 16) | ((uint32_t)in[11] << 24);
+    return (*unit_ns != 0U) ? IR_SUCCESS : IR_ERROR;
+}
+
+uint8_t IR_trace_encode(uint8_t* out, uint8_t level, uint32_t duration)
+{
+    uint32_t value;
+    uint8_t length = 0;
+
+    // Longer intervals are clamped; any decoder has timed out long before
+    if(duration > IR_TRACE_DURATION_MAX)
+        duration = IR_TRACE_DURATION_MAX;
+    value = (duration << 1) | (level ? 1U : 0U);
+
+    while(value >= 0x80U)
+    {
+        out[length++] = (uint8_t)(value | 0x80U);
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+
+    return length;
+}
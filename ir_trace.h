@@ -0,0 +1,64 @@
+/**
+ * ir_trace.h - Binary Edge Trace Format
+ *
+ * Records receiver edges for replay into the decoder: a fixed header, then
+ * one variable-length record per edge. Multi-byte header fields are
+ * little-endian:
+ *
+ *   0     magic "IRTR"
+ *   4     version (IR_TRACE_VERSION)
+ *   5     flags (0)
+ *   6..7  reserved (0)
+ *   8..11 duration unit in nanoseconds (1000: microseconds)
+ *   12..15 reserved (0)
+ *
+ * Record: (duration << 1) | level as an unsigned LEB128 varint, 7 bits per
+ * byte, least significant group first, bit 7 set on every byte but the
+ * last. level is the line level the edge starts (IR_HIGH: a mark begins)
+ * and duration how long the previous level lasted, the arguments of
+ * IR_decoder_process_duration(). Bit times take two bytes, leaders and
+ * gaps up to 2.1s three. Each record carries its level, so a reader stays
+ * in step across records lost in transit.
+ * Author: Nghia Taarabt
+ */
+
+#ifndef IR_TRACE_H_
+#define IR_TRACE_H_
+
+#include "ir_common.h"
+
+#define IR_TRACE_MAGIC          "IRTR"
+#define IR_TRACE_VERSION        (1U)
+#define IR_TRACE_HEADER_SIZE    (16U)
+#define IR_TRACE_RECORD_MAX     (5U)        // Bytes of the longest record (31-bit duration)
+#define IR_TRACE_UNIT_US        (1000UL)    // Unit of microsecond traces (ns)
+#define IR_TRACE_DURATION_MAX   (0x7FFFFFFFUL)
+
+// Function Declarations
+uint8_t IR_trace_header(uint8_t* out, uint32_t unit_ns);
+int8_t IR_trace_check_header(const uint8_t* in, uint32_t length, uint32_t* unit_ns);
+uint8_t IR_trace_encode(uint8_t* out, uint8_t level, uint32_t duration);
+
+// Decode the record at *in (before end) and advance past it. IR_ERROR at
+// end or on a record cut short. Inline: replay loops run it per edge
+static inline int8_t IR_trace_decode(const uint8_t** in, const uint8_t* end, uint8_t* level, uint32_t* duration)
+{
+    const uint8_t* p = *in;
+    uint32_t value = 0;
+
+    for(uint8_t shift = 0; p < end && shift < 7U * IR_TRACE_RECORD_MAX; shift += 7U)
+    {
+        uint8_t byte = *p++;
+        value |= (uint32_t)(byte & 0x7FU) << shift;
+        if(!(byte & 0x80U))
+        {
+            *in = p;
+            *level = (uint8_t)(value & 1U);
+            *duration = value >> 1;
+            return IR_SUCCESS;
+        }
+    }
+    return IR_ERROR;
+}
+
+#endif /* IR_TRACE_H_ */
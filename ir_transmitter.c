@@ -5,10 +5,31 @@
  */
 
 #include "ir_transmitter.h"
+#include <string.h>
+
+#if IR_HAL_STATIC
+#include IR_HAL_STATIC_HEADER
+#define IR_TX_CARRIER_ON(transmitter)       IR_hal_carrier_on()
+#define IR_TX_CARRIER_OFF(transmitter)      IR_hal_carrier_off()
+#define IR_TX_DELAY_US(transmitter, us)     IR_hal_delay_us(us)
+#define IR_TX_SET_CARRIER(transmitter, hz)  IR_hal_set_carrier(hz)
+#else
+#define IR_TX_CARRIER_ON(transmitter)       ((transmitter)->hal.carrier_on())
+#define IR_TX_CARRIER_OFF(transmitter)      ((transmitter)->hal.carrier_off())
+#define IR_TX_DELAY_US(transmitter, us)     ((transmitter)->hal.delay_us(us))
+#define IR_TX_SET_CARRIER(transmitter, hz)  do { if((transmitter)->hal.set_carrier) (transmitter)->hal.set_carrier(hz); } while(0)
+#endif
+
+#if IR_TRANSMITTER_ENABLE_NOTIFY
+#define IR_TX_NOTIFY(transmitter, event)    do { if((transmitter)->on_transmit) (transmitter)->on_transmit((event), (transmitter)->data_to_send); } while(0)
+#else
+#define IR_TX_NOTIFY(transmitter, event)    ((void)0)
+#endif
 
 static void IR_transmit_frame(IR_Transmitter_t* transmitter);
 
 // Protocol configuration functions
+#if IR_ENABLE_NEC
 void IR_get_nec_tx_config(IR_TX_Protocol_Config_t* config) {
     config->start_burst_us = 9000;
     config->start_space_us = 4500;
@@ -21,7 +42,9 @@ void IR_get_nec_tx_config(IR_TX_Protocol_Config_t* config) {
     config->repeat_count = 1;
     config->carrier_freq = 38000;
 }
+#endif
 
+#if IR_ENABLE_RC5
 void IR_get_rc5_tx_config(IR_TX_Protocol_Config_t* config) {
     config->start_burst_us = 889;  // Half bit time
     config->start_space_us = 889;
@@ -34,7 +57,9 @@ void IR_get_rc5_tx_config(IR_TX_Protocol_Config_t* config) {
     config->repeat_count = 0;
     config->carrier_freq = 36000;
 }
+#endif
 
+#if IR_ENABLE_SONY
 void IR_get_sony_tx_config(IR_TX_Protocol_Config_t* config) {
     config->start_burst_us = 2400;
     config->start_space_us = 600;
@@ -47,7 +72,9 @@ void IR_get_sony_tx_config(IR_TX_Protocol_Config_t* config) {
     config->repeat_count = 2;  // Sony sends 3 times
     config->carrier_freq = 40000;
 }
+#endif
 
+#if IR_ENABLE_RC6
 void IR_get_rc6_tx_config(IR_TX_Protocol_Config_t* config) {
     config->start_burst_us = 2666;
     config->start_space_us = 889;
@@ -60,7 +87,9 @@ void IR_get_rc6_tx_config(IR_TX_Protocol_Config_t* config) {
     config->repeat_count = 0;
     config->carrier_freq = 36000;
 }
+#endif
 
+#if IR_ENABLE_SAMSUNG
 void IR_get_samsung_tx_config(IR_TX_Protocol_Config_t* config) {
     config->start_burst_us = 4500;
     config->start_space_us = 4500;
@@ -73,7 +102,9 @@ void IR_get_samsung_tx_config(IR_TX_Protocol_Config_t* config) {
     config->repeat_count = 1;
     config->carrier_freq = 38000;
 }
+#endif
 
+#if IR_ENABLE_LG
 void IR_get_lg_tx_config(IR_TX_Protocol_Config_t* config) {
     config->start_burst_us = 9000;
     config->start_space_us = 4500;
@@ -86,7 +117,9 @@ void IR_get_lg_tx_config(IR_TX_Protocol_Config_t* config) {
     config->repeat_count = 1;
     config->carrier_freq = 38000;
 }
+#endif
 
+#if IR_ENABLE_PANASONIC
 void IR_get_panasonic_tx_config(IR_TX_Protocol_Config_t* config) {
     config->start_burst_us = 3502;
     config->start_space_us = 1750;
@@ -99,7 +132,9 @@ void IR_get_panasonic_tx_config(IR_TX_Protocol_Config_t* config) {
     config->repeat_count = 0;
     config->carrier_freq = 35000;
 }
+#endif
 
+#if IR_ENABLE_JVC
 void IR_get_jvc_tx_config(IR_TX_Protocol_Config_t* config) {
     config->start_burst_us = 8400;
     config->start_space_us = 4200;
@@ -112,7 +147,9 @@ void IR_get_jvc_tx_config(IR_TX_Protocol_Config_t* config) {
     config->repeat_count = 0;
     config->carrier_freq = 38000;
 }
+#endif
 
+#if IR_ENABLE_DENON
 void IR_get_denon_tx_config(IR_TX_Protocol_Config_t* config) {
     config->start_burst_us = 275;
     config->start_space_us = 775;
@@ -125,46 +162,96 @@ void IR_get_denon_tx_config(IR_TX_Protocol_Config_t* config) {
     config->repeat_count = 1;
     config->carrier_freq = 38000;
 }
+#endif
+
+#if IR_ENABLE_PPM
+void IR_get_ppm_tx_config(IR_TX_Protocol_Config_t* config) {
+    config->start_burst_us = IR_PPM_SLOT_US * 8U;
+    config->start_space_us = IR_PPM_SLOT_US * 4U;
+    config->repeat_space_us = 0;  // No repeat
+    config->bit_burst_us = IR_PPM_SLOT_US;
+    config->bit_0_space_us = IR_PPM_SLOT_US;        // Symbol 0, each symbol adds a slot
+    config->bit_1_space_us = IR_PPM_SLOT_US * 4U;   // Symbol 3
+    config->stop_burst_us = IR_PPM_SLOT_US;
+    config->bit_count = 32;
+    config->repeat_count = 0;
+    config->carrier_freq = 38000;
+}
+#endif
 
 // Initialize transmitter
 void IR_transmitter_init(IR_Transmitter_t* transmitter, IR_Protocol_t protocol, IR_TX_HAL_t* hal) {
     transmitter->state = IR_TX_STATE_IDLE;
     transmitter->protocol_type = protocol;
+#if IR_HAL_STATIC
+    (void)hal;
+#else
     transmitter->hal = *hal;
+#endif
     transmitter->is_transmitting = 0;
     transmitter->repeat_counter = 0;
+#if IR_TRANSMITTER_ENABLE_NOTIFY
+    transmitter->on_transmit = 0;
+#endif
     
     // Load protocol configuration
     switch(protocol) {
+#if IR_ENABLE_NEC
         case IR_PROTOCOL_NEC:
             IR_get_nec_tx_config(&transmitter->protocol_config);
             break;
+#endif
+#if IR_ENABLE_RC5
         case IR_PROTOCOL_RC5:
             IR_get_rc5_tx_config(&transmitter->protocol_config);
             break;
+#endif
+#if IR_ENABLE_SONY
         case IR_PROTOCOL_SONY:
             IR_get_sony_tx_config(&transmitter->protocol_config);
             break;
+#endif
+#if IR_ENABLE_RC6
         case IR_PROTOCOL_RC6:
             IR_get_rc6_tx_config(&transmitter->protocol_config);
             break;
+#endif
+#if IR_ENABLE_SAMSUNG
         case IR_PROTOCOL_SAMSUNG:
             IR_get_samsung_tx_config(&transmitter->protocol_config);
             break;
+#endif
+#if IR_ENABLE_LG
         case IR_PROTOCOL_LG:
             IR_get_lg_tx_config(&transmitter->protocol_config);
             break;
+#endif
+#if IR_ENABLE_PANASONIC
         case IR_PROTOCOL_PANASONIC:
             IR_get_panasonic_tx_config(&transmitter->protocol_config);
             break;
+#endif
+#if IR_ENABLE_JVC
         case IR_PROTOCOL_JVC:
             IR_get_jvc_tx_config(&transmitter->protocol_config);
             break;
+#endif
+#if IR_ENABLE_DENON
         case IR_PROTOCOL_DENON:
             IR_get_denon_tx_config(&transmitter->protocol_config);
             break;
+#endif
+#if IR_ENABLE_PPM
+        case IR_PROTOCOL_PPM:
+            IR_get_ppm_tx_config(&transmitter->protocol_config);
+            break;
+#endif
         default:
+#if IR_ENABLE_NEC
             IR_get_nec_tx_config(&transmitter->protocol_config);
+#else
+            memset(&transmitter->protocol_config, 0, sizeof(transmitter->protocol_config));
+#endif
             break;
     }
 }
@@ -177,36 +264,63 @@ int8_t IR_transmitter_send(IR_Transmitter_t* transmitter, uint8_t address, uint8
     
     // Encode data based on protocol
     switch(transmitter->protocol_type) {
+#if IR_ENABLE_NEC
         case IR_PROTOCOL_NEC:
             transmitter->data_to_send = IR_encode_nec_data(address, command);
             break;
+#endif
+#if IR_ENABLE_SONY
         case IR_PROTOCOL_SONY:
             transmitter->data_to_send = IR_encode_sony_data(address, command);
             break;
+#endif
+#if IR_ENABLE_RC5
         case IR_PROTOCOL_RC5:
             transmitter->data_to_send = IR_encode_rc5_data(address, command);
             break;
+#endif
+#if IR_ENABLE_SAMSUNG
         case IR_PROTOCOL_SAMSUNG:
             transmitter->data_to_send = IR_encode_samsung_data(address, command);
             break;
+#endif
+#if IR_ENABLE_LG
         case IR_PROTOCOL_LG:
             transmitter->data_to_send = IR_encode_lg_data(address, command);
             break;
+#endif
+#if IR_ENABLE_PANASONIC
         case IR_PROTOCOL_PANASONIC:
             transmitter->data_to_send = IR_encode_panasonic_data(address, command);
             break;
+#endif
+#if IR_ENABLE_JVC
         case IR_PROTOCOL_JVC:
             transmitter->data_to_send = IR_encode_jvc_data(address, command);
             break;
+#endif
+#if IR_ENABLE_RC6
         case IR_PROTOCOL_RC6:
             transmitter->data_to_send = IR_encode_rc6_data(address, command);
             break;
+#endif
+#if IR_ENABLE_DENON
         case IR_PROTOCOL_DENON:
             transmitter->data_to_send = IR_encode_denon_data(address, command);
             break;
+#endif
+#if IR_ENABLE_PPM
+        case IR_PROTOCOL_PPM:
+            transmitter->data_to_send = IR_encode_ppm_data(address, command);
+            break;
+#endif
         default:
+#if IR_ENABLE_NEC
             transmitter->data_to_send = IR_encode_nec_data(address, command);
             break;
+#else
+            return IR_ERROR;    // Protocol not built in
+#endif
     }
     
     return IR_transmitter_send_raw(transmitter, transmitter->data_to_send);
@@ -232,36 +346,52 @@ int8_t IR_transmitter_send_raw(IR_Transmitter_t* transmitter, uint32_t raw_data)
 static void IR_transmit_frame(IR_Transmitter_t* transmitter) {
     IR_TX_Protocol_Config_t* config = &transmitter->protocol_config;
     
+    IR_TX_NOTIFY(transmitter, IR_TX_EVENT_FRAME);
+    
     // Send start burst
-    transmitter->hal.carrier_on();
-    transmitter->hal.delay_us(config->start_burst_us);
-    transmitter->hal.carrier_off();
-    transmitter->hal.delay_us(config->start_space_us);
+    IR_TX_CARRIER_ON(transmitter);
+    IR_TX_DELAY_US(transmitter, config->start_burst_us);
+    IR_TX_CARRIER_OFF(transmitter);
+    IR_TX_DELAY_US(transmitter, config->start_space_us);
     
+#if IR_ENABLE_PPM
+    // Two bits per symbol: the space grows by one slot per symbol value
+    if (transmitter->protocol_type == IR_PROTOCOL_PPM) {
+        for (uint8_t i = 0; i < config->bit_count; i += 2) {
+            uint8_t symbol = (transmitter->data_to_send >> i) & 3;
+            
+            IR_TX_CARRIER_ON(transmitter);
+            IR_TX_DELAY_US(transmitter, config->bit_burst_us);
+            IR_TX_CARRIER_OFF(transmitter);
+            IR_TX_DELAY_US(transmitter, config->bit_0_space_us + symbol * config->bit_burst_us);
+        }
+    } else
+#endif
     // Send data bits
     for (uint8_t i = 0; i < config->bit_count; i++) {
         uint8_t bit = (transmitter->data_to_send >> i) & 1;
         
         // Send bit burst
-        transmitter->hal.carrier_on();
-        transmitter->hal.delay_us(config->bit_burst_us);
-        transmitter->hal.carrier_off();
+        IR_TX_CARRIER_ON(transmitter);
+        IR_TX_DELAY_US(transmitter, config->bit_burst_us);
+        IR_TX_CARRIER_OFF(transmitter);
         
         // Send bit space
         if (bit) {
-            transmitter->hal.delay_us(config->bit_1_space_us);
+            IR_TX_DELAY_US(transmitter, config->bit_1_space_us);
         } else {
-            transmitter->hal.delay_us(config->bit_0_space_us);
+            IR_TX_DELAY_US(transmitter, config->bit_0_space_us);
         }
     }
     
     // Send stop burst if needed
     if (config->stop_burst_us > 0) {
-        transmitter->hal.carrier_on();
-        transmitter->hal.delay_us(config->stop_burst_us);
-        transmitter->hal.carrier_off();
+        IR_TX_CARRIER_ON(transmitter);
+        IR_TX_DELAY_US(transmitter, config->stop_burst_us);
+        IR_TX_CARRIER_OFF(transmitter);
     }
     
+    IR_TX_NOTIFY(transmitter, IR_TX_EVENT_END);
     transmitter->is_transmitting = 0;
 }
 
@@ -278,16 +408,18 @@ int8_t IR_transmitter_send_repeat(IR_Transmitter_t* transmitter) {
     }
     
     transmitter->is_transmitting = 1;
+    IR_TX_NOTIFY(transmitter, IR_TX_EVENT_REPEAT);
     
     // Send repeat signal
-    transmitter->hal.carrier_on();
-    transmitter->hal.delay_us(config->start_burst_us);
-    transmitter->hal.carrier_off();
-    transmitter->hal.delay_us(config->repeat_space_us);
-    transmitter->hal.carrier_on();
-    transmitter->hal.delay_us(config->stop_burst_us);
-    transmitter->hal.carrier_off();
+    IR_TX_CARRIER_ON(transmitter);
+    IR_TX_DELAY_US(transmitter, config->start_burst_us);
+    IR_TX_CARRIER_OFF(transmitter);
+    IR_TX_DELAY_US(transmitter, config->repeat_space_us);
+    IR_TX_CARRIER_ON(transmitter);
+    IR_TX_DELAY_US(transmitter, config->stop_burst_us);
+    IR_TX_CARRIER_OFF(transmitter);
     
+    IR_TX_NOTIFY(transmitter, IR_TX_EVENT_END);
     transmitter->is_transmitting = 0;
     return IR_SUCCESS;
 }
@@ -299,7 +431,120 @@ uint8_t IR_transmitter_is_busy(IR_Transmitter_t* transmitter) {
 
 // Stop transmission
 void IR_transmitter_stop(IR_Transmitter_t* transmitter) {
-    transmitter->hal.carrier_off();
+    IR_TX_CARRIER_OFF(transmitter);
     transmitter->is_transmitting = 0;
     transmitter->state = IR_TX_STATE_IDLE;
 }
+
+// Send durations[start..end) of a pulse train, marks at even offsets
+static void IR_transmit_sequence(IR_Transmitter_t* transmitter, const IR_Pulse_Train_t* train,
+                                 uint16_t start, uint16_t end, uint8_t event) {
+    (void)transmitter;  // Unused with IR_HAL_STATIC and without IR_TRANSMITTER_ENABLE_NOTIFY
+    (void)event;
+    IR_TX_NOTIFY(transmitter, event);
+    for (uint16_t i = start; i < end; i++) {
+        if (((i - start) & 1U) == 0) {
+            IR_TX_CARRIER_ON(transmitter);
+            IR_TX_DELAY_US(transmitter, train->durations[i]);
+            IR_TX_CARRIER_OFF(transmitter);
+        } else {
+            IR_TX_DELAY_US(transmitter, train->durations[i]);
+        }
+    }
+    IR_TX_NOTIFY(transmitter, IR_TX_EVENT_END);
+}
+
+// Send a pulse train at its own carrier
+int8_t IR_transmitter_send_pulses(IR_Transmitter_t* transmitter, const IR_Pulse_Train_t* train, uint8_t repeat_count) {
+    uint16_t once = (train->repeat_index < train->count) ? train->repeat_index : train->count;
+    
+    if (transmitter->is_transmitting || train->count == 0) {
+        return IR_ERROR;
+    }
+    if (once == 0 && repeat_count == 0) {
+        repeat_count = 1;   // Pronto: a code with only a repeat sequence is sent at least once
+    }
+    
+    transmitter->is_transmitting = 1;
+    transmitter->data_to_send = 0;
+    IR_TX_SET_CARRIER(transmitter, train->carrier_freq);
+    
+    if (once > 0) {
+        IR_transmit_sequence(transmitter, train, 0, once, IR_TX_EVENT_FRAME);
+    }
+    while (once < train->count && repeat_count--) {
+        IR_transmit_sequence(transmitter, train, once, train->count, IR_TX_EVENT_REPEAT);
+    }
+    
+    IR_TX_SET_CARRIER(transmitter, transmitter->protocol_config.carrier_freq);
+    transmitter->is_transmitting = 0;
+    return IR_SUCCESS;
+}
+
+// Append one burst and the space after it
+static int8_t IR_render_pair(IR_Pulse_Train_t* train, uint16_t burst_us, uint16_t space_us) {
+    if (IR_pulse_train_append(train, IR_HIGH, burst_us) != IR_SUCCESS) {
+        return IR_ERROR;
+    }
+    return IR_pulse_train_append(train, IR_LOW, space_us);
+}
+
+// Render a frame into a pulse train, same layout as IR_transmit_frame()
+int8_t IR_transmitter_render(IR_Transmitter_t* transmitter, uint32_t raw_data, IR_Pulse_Train_t* train, uint16_t gap_us) {
+    IR_TX_Protocol_Config_t* config = &transmitter->protocol_config;
+    uint8_t step = 1;
+    int8_t result;
+    
+    train->carrier_freq = config->carrier_freq;
+    result = IR_render_pair(train, config->start_burst_us, config->start_space_us);
+    
+#if IR_ENABLE_PPM
+    if (transmitter->protocol_type == IR_PROTOCOL_PPM) {
+        step = 2;
+    }
+#endif
+    for (uint8_t i = 0; i < config->bit_count && result == IR_SUCCESS; i += step) {
+        uint16_t space_us;
+#if IR_ENABLE_PPM
+        if (step == 2) {
+            space_us = config->bit_0_space_us + ((raw_data >> i) & 3) * config->bit_burst_us;
+        } else
+#endif
+        space_us = ((raw_data >> i) & 1) ? config->bit_1_space_us : config->bit_0_space_us;
+        result = IR_render_pair(train, config->bit_burst_us, space_us);
+    }
+    
+    if (result == IR_SUCCESS && config->stop_burst_us > 0) {
+        result = IR_render_pair(train, config->stop_burst_us, gap_us);
+    } else if (result == IR_SUCCESS) {
+        result = IR_pulse_train_append(train, IR_LOW, gap_us);
+    }
+    return result;
+}
+
+// Render a repeat code, same layout as IR_transmitter_send_repeat()
+int8_t IR_transmitter_render_repeat(IR_Transmitter_t* transmitter, IR_Pulse_Train_t* train, uint16_t gap_us) {
+    IR_TX_Protocol_Config_t* config = &transmitter->protocol_config;
+    
+    if (config->repeat_space_us == 0) {
+        return IR_ERROR;
+    }
+    
+    train->carrier_freq = config->carrier_freq;
+    if (IR_render_pair(train, config->start_burst_us, config->repeat_space_us) != IR_SUCCESS) {
+        return IR_ERROR;
+    }
+    return IR_render_pair(train, config->stop_burst_us, gap_us);
+}
+
+// Set the transmission callback (NULL to remove)
+int8_t IR_transmitter_set_notify(IR_Transmitter_t* transmitter, IR_TX_Notify_t callback) {
+#if IR_TRANSMITTER_ENABLE_NOTIFY
+    transmitter->on_transmit = callback;
+    return IR_SUCCESS;
+#else
+    (void)transmitter;
+    (void)callback;
+    return IR_ERROR;
+#endif
+}
@@ -28,21 +28,31 @@ typedef struct {
     void (*carrier_off)(void);      // Stop carrier
     void (*delay_us)(uint16_t us);  // Microsecond delay
     void (*delay_ms)(uint16_t ms);  // Millisecond delay
+    void (*set_carrier)(uint32_t hz);   // Carrier for the next carrier_on(), 0 = unmodulated (optional, may be NULL)
 } IR_TX_HAL_t;
 
+// Transmission callback, called before the first burst of a frame or repeat
+// (IR_TX_EVENT_FRAME/REPEAT) and after its last (IR_TX_EVENT_END)
+typedef void (*IR_TX_Notify_t)(uint8_t event, uint32_t raw_data);
+
 // IR Transmitter Context
 typedef struct {
     IR_TX_State_t state;
     IR_Protocol_t protocol_type;
+#if !IR_HAL_STATIC
     IR_TX_HAL_t hal;
+#endif
     IR_TX_Protocol_Config_t protocol_config;  // Protocol timing configuration
     uint32_t data_to_send;
     uint8_t current_bit;
     uint8_t repeat_counter;
     uint8_t is_transmitting;
+#if IR_TRANSMITTER_ENABLE_NOTIFY
+    IR_TX_Notify_t on_transmit;
+#endif
 } IR_Transmitter_t;
 
-// Function Declarations
+// Function Declarations (hal is ignored and may be NULL when IR_HAL_STATIC is 1)
 void IR_transmitter_init(IR_Transmitter_t* transmitter, IR_Protocol_t protocol, IR_TX_HAL_t* hal);
 int8_t IR_transmitter_send(IR_Transmitter_t* transmitter, uint8_t address, uint8_t command);
 int8_t IR_transmitter_send_raw(IR_Transmitter_t* transmitter, uint32_t raw_data);
@@ -50,6 +60,18 @@ int8_t IR_transmitter_send_repeat(IR_Transmitter_t* transmitter);
 uint8_t IR_transmitter_is_busy(IR_Transmitter_t* transmitter);
 void IR_transmitter_stop(IR_Transmitter_t* transmitter);
 
+// Pulse trains: send_pulses() plays the once sequence, then the repeat
+// sequence repeat_count times (at least once if there is no once sequence),
+// at the train's carrier when the HAL has set_carrier; notify events carry
+// raw_data 0. render() and render_repeat() append what send_raw() and
+// send_repeat() would transmit, followed by a space of gap_us
+int8_t IR_transmitter_send_pulses(IR_Transmitter_t* transmitter, const IR_Pulse_Train_t* train, uint8_t repeat_count);
+int8_t IR_transmitter_render(IR_Transmitter_t* transmitter, uint32_t raw_data, IR_Pulse_Train_t* train, uint16_t gap_us);
+int8_t IR_transmitter_render_repeat(IR_Transmitter_t* transmitter, IR_Pulse_Train_t* train, uint16_t gap_us);
+
+// Transmission callback (returns IR_ERROR when IR_TRANSMITTER_ENABLE_NOTIFY is 0)
+int8_t IR_transmitter_set_notify(IR_Transmitter_t* transmitter, IR_TX_Notify_t callback);
+
 static void IR_transmit_frame(IR_Transmitter_t* transmitter);
 
 #endif /* IR_TRANSMITTER_H_ */
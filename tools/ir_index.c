@@ -0,0 +1,1190 @@
+/**
+ * ir_index.c - Code Database Indexer for LIRC and Flipper Files
+ *
+ * Streams LIRC .conf and Flipper .ir files, normalizes every code to
+ * (protocol, address, command) and writes a sorted index that is looked up
+ * in place through mmap(), to name the device and button of a decoded frame.
+ *
+ *   ir_index build [-j threads] -o index.irx files...   ("-" reads paths from stdin)
+ *   ir_index list [-j threads] files...                 normalized entries as text
+ *   ir_index lookup index.irx protocol address command  or: protocol raw 0xRAWDATA
+ *
+ * Normalization:
+ *   Flipper "parsed"   protocol name, address and command bytes
+ *   LIRC RC5/RC6       address and command fields of the code bits
+ *   LIRC SPACE_ENC     rendered to a pulse train from header/one/zero/ptrail
+ *   raw codes          (Flipper "raw", LIRC raw_codes) kept as pulse trains
+ * Pulse trains go through each library decoder in turn (IR_pronto_train_to_data());
+ * a decode counts only if the train's first frame has exactly the protocol's
+ * number of marks and spaces. Trains no decoder accepts are counted, listed
+ * as raw, and left out of the index.
+ * Keys come from IR_decode_data_ext(), so 16-bit NEC/Samsung addresses match
+ * IR_decoder_get_data_ext() output.
+ *
+ * Files are parsed on a pool of threads, each taking the next unparsed file.
+ * Results are merged, sorted and deduplicated, so the index is identical
+ * whatever the thread count. Index layout (little-endian):
+ *
+ *   0     magic "IRIX"
+ *   4     version (u16), entry size (u16, 16)
+ *   8     entry count (u32)
+ *   12    string table offset (u32), string table size (u32)
+ *   20    entries, sorted by protocol, address, command, device, button:
+ *           protocol (u8), variant (u8, IR_VARIANT_*), address (u16),
+ *           command (u16), reserved (u16), device name offset (u32),
+ *           button name offset (u32); offsets into the string table
+ *   ..    string table, NUL-terminated names, each stored once
+ * Author: Nghia Taarabt
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ir_pronto.h"
+
+#define INDEX_MAGIC         "IRIX"
+#define INDEX_VERSION       (1U)
+#define INDEX_HEADER_SIZE   (20U)
+#define INDEX_ENTRY_SIZE    (16U)
+#define TRAIN_MAX           (2048U)     // Durations kept per raw code
+#define MAX_THREADS         (256U)
+
+// Normalized code, names as offsets into the owning file's string arena
+typedef struct {
+    uint8_t protocol;                   // IR_PROTOCOL_COUNT: undecoded pulse train
+    uint8_t variant;
+    uint16_t address;
+    uint16_t command;
+    uint16_t durations;                 // Raw codes: pulse train length
+    uint32_t carrier;                   // Raw codes: Hz
+    uint32_t device;
+    uint32_t button;
+} Entry;
+
+typedef struct {
+    const char* path;
+    Entry* entries;
+    size_t count;
+    size_t capacity;
+    char* strings;
+    size_t size;
+    size_t space;
+    unsigned long raw_decoded;          // Pulse trains that decoded
+    unsigned long undecoded;            // Pulse trains no decoder accepted
+    unsigned long unsupported;          // Protocols or encodings not mapped
+    int error;
+} File_Result_t;
+
+typedef struct {
+    File_Result_t* results;
+    size_t count;
+    size_t next;                        // Next file to parse
+    pthread_mutex_t lock;
+} Work_t;
+
+// Per-thread scratch
+typedef struct {
+    uint16_t buffer[TRAIN_MAX];
+    IR_Pulse_Train_t train;
+} Scratch_t;
+
+static void* grow(void* data, size_t* capacity, size_t need, size_t item)
+{
+    size_t next = *capacity ? *capacity : 64U;
+
+    if(need <= *capacity)
+        return data;
+    while(next < need)
+        next *= 2U;
+    data = realloc(data, next * item);
+    if(!data)
+    {
+        fputs("out of memory\n", stderr);
+        exit(1);
+    }
+    *capacity = next;
+    return data;
+}
+
+static uint32_t add_string(File_Result_t* result, const char* text, size_t length)
+{
+    uint32_t offset = (uint32_t)result->size;
+
+    result->strings = grow(result->strings, &result->space, result->size + length + 1U, 1U);
+    memcpy(result->strings + result->size, text, length);
+    result->strings[result->size + length] = '\0';
+    result->size += length + 1U;
+    return offset;
+}
+
+static void add_entry(File_Result_t* result, const Entry* entry)
+{
+    result->entries = grow(result->entries, &result->capacity, result->count + 1U, sizeof(Entry));
+    result->entries[result->count++] = *entry;
+}
+
+// Normalize a frame through the library's full-width decode
+static void add_frame(File_Result_t* result, IR_Protocol_t protocol, uint32_t raw_data, uint32_t device, uint32_t button)
+{
+    IR_Data_Ext_t data;
+    Entry entry;
+
+    IR_decode_data_ext(protocol, raw_data, &data);
+    memset(&entry, 0, sizeof(entry));
+    entry.protocol = (uint8_t)protocol;
+    entry.variant = data.variant;
+    entry.address = data.address;
+    entry.command = data.command;
+    entry.device = device;
+    entry.button = button;
+    add_entry(result, &entry);
+}
+
+// The train's first frame has exactly the marks and spaces of the decoded
+// frame: a decoder stops at its bit count, so a longer code (e.g. 48 bits
+// behind a NEC leader) must not be taken for its first 32 bits
+static int frame_edges_match(const IR_Pulse_Train_t* train, IR_Protocol_t protocol, uint32_t raw_data)
+{
+    uint16_t buffer[256];
+    IR_Pulse_Train_t frame;
+    IR_Transmitter_t coder;
+    IR_TX_HAL_t none;
+    uint16_t longest = 0U;
+    uint16_t edges;
+    uint16_t i;
+
+    memset(&none, 0, sizeof(none));
+    IR_transmitter_init(&coder, protocol, &none);
+    IR_pulse_train_init(&frame, buffer, sizeof(buffer) / sizeof(buffer[0]), 0U);
+    if(IR_transmitter_render(&coder, raw_data, &frame, IR_PRONTO_GAP_US) != IR_SUCCESS || frame.count < 2U)
+        return 0;
+
+    // Rendered frame without its trailing gap; the train's frame ends at the
+    // first space well beyond any space inside a frame
+    edges = (uint16_t)(frame.count - 1U);
+    for(i = 1U; i < edges; i += 2U)
+    {
+        if(frame.durations[i] > longest)
+            longest = frame.durations[i];
+    }
+    for(i = 0U; i < train->count; i++)
+    {
+        if((i & 1U) && train->durations[i] > 2U * (uint32_t)longest)
+            break;
+    }
+    return i == edges;
+}
+
+// Decode a pulse train with every protocol in turn
+static void add_train(File_Result_t* result, const IR_Pulse_Train_t* train, uint32_t device, uint32_t button)
+{
+    for(int protocol = 0; protocol < IR_PROTOCOL_COUNT; protocol++)
+    {
+        IR_Data_t data;
+
+        if(protocol == IR_PROTOCOL_PPM || !IR_get_protocol_info((IR_Protocol_t)protocol))
+            continue;
+        if(IR_pronto_train_to_data(train, (IR_Protocol_t)protocol, &data) == IR_SUCCESS &&
+           frame_edges_match(train, (IR_Protocol_t)protocol, data.raw_data))
+        {
+            add_frame(result, (IR_Protocol_t)protocol, data.raw_data, device, button);
+            result->raw_decoded++;
+            return;
+        }
+    }
+
+    Entry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.protocol = IR_PROTOCOL_COUNT;
+    entry.durations = train->count;
+    entry.carrier = train->carrier_freq;
+    entry.device = device;
+    entry.button = button;
+    add_entry(result, &entry);
+    result->undecoded++;
+}
+
+// Line iteration over a mapped file: [*line, *end) without the newline
+static int next_line(const char** cursor, const char* limit, const char** line, const char** end)
+{
+    const char* p = *cursor;
+
+    if(p >= limit)
+        return 0;
+
+    const char* newline = memchr(p, '\n', (size_t)(limit - p));
+    *cursor = newline ? newline + 1 : limit;
+    *end = newline ? newline : limit;
+
+    while(p < *end && isspace((unsigned char)*p))
+        p++;
+    while(*end > p && isspace((unsigned char)(*end)[-1]))
+        (*end)--;
+    *line = p;
+    return 1;
+}
+
+// Next whitespace-separated token of [*p, end)
+static int next_token(const char** p, const char* end, const char** token, size_t* length)
+{
+    const char* s = *p;
+
+    while(s < end && isspace((unsigned char)*s))
+        s++;
+    if(s >= end)
+        return 0;
+    *token = s;
+    while(s < end && !isspace((unsigned char)*s))
+        s++;
+    *length = (size_t)(s - *token);
+    *p = s;
+    return 1;
+}
+
+static int token_is(const char* token, size_t length, const char* word)
+{
+    return strlen(word) == length && strncasecmp(token, word, length) == 0;
+}
+
+static unsigned long long token_number(const char* token, size_t length, int base)
+{
+    char text[32];
+
+    if(length >= sizeof(text))
+        length = sizeof(text) - 1U;
+    memcpy(text, token, length);
+    text[length] = '\0';
+    return strtoull(text, 0, base);
+}
+
+// Append every number of [p, end) to the train, alternating mark and space
+static void train_numbers(IR_Pulse_Train_t* train, const char* p, const char* end)
+{
+    const char* token;
+    size_t length;
+
+    while(next_token(&p, end, &token, &length))
+    {
+        if(!isdigit((unsigned char)*token))
+            continue;
+        IR_pulse_train_append(train, (train->count & 1U) ? IR_LOW : IR_HIGH, (uint32_t)token_number(token, length, 10));
+    }
+}
+
+// File name without directories and extension
+static uint32_t add_basename(File_Result_t* result)
+{
+    const char* name = strrchr(result->path, '/');
+    const char* dot;
+
+    name = name ? name + 1 : result->path;
+    dot = strrchr(name, '.');
+    return add_string(result, name, dot && dot != name ? (size_t)(dot - name) : strlen(name));
+}
+
+// Flipper "key: value" with the value's bounds
+static int flipper_field(const char* line, const char* end, const char* key, const char** value)
+{
+    size_t length = strlen(key);
+
+    if((size_t)(end - line) < length + 1U || strncasecmp(line, key, length) != 0 || line[length] != ':')
+        return 0;
+    *value = line + length + 1;
+    while(*value < end && isspace((unsigned char)**value))
+        (*value)++;
+    return 1;
+}
+
+// Little-endian hex bytes "07 00 00 00"
+static uint32_t flipper_bytes(const char* p, const char* end)
+{
+    const char* token;
+    size_t length;
+    uint32_t value = 0;
+
+    for(unsigned shift = 0; shift < 32U && next_token(&p, end, &token, &length); shift += 8U)
+    {
+        value |= (uint32_t)(token_number(token, length, 16) & 0xFFU) << shift;
+    }
+    return value;
+}
+
+typedef struct {
+    uint32_t button;
+    int have_name;
+    int raw;
+    char protocol[16];
+    uint32_t address;
+    uint32_t command;
+} Flipper_Signal_t;
+
+static void flipper_finish(File_Result_t* result, Scratch_t* scratch, Flipper_Signal_t* signal, uint32_t device)
+{
+    static const struct {
+        const char* name;
+        IR_Protocol_t protocol;
+    } names[] = {
+        { "NEC", IR_PROTOCOL_NEC },         { "NECext", IR_PROTOCOL_NEC },
+        { "Samsung32", IR_PROTOCOL_SAMSUNG }, { "RC5", IR_PROTOCOL_RC5 },
+        { "RC5X", IR_PROTOCOL_RC5 },        { "RC6", IR_PROTOCOL_RC6 },
+        { "SIRC", IR_PROTOCOL_SONY },       { "SIRC15", IR_PROTOCOL_SONY },
+        { "SIRC20", IR_PROTOCOL_SONY },
+    };
+
+    if(!signal->have_name)
+        return;
+
+    if(signal->raw)
+    {
+        if(scratch->train.count > 0U)
+            add_train(result, &scratch->train, device, signal->button);
+    }
+    else
+    {
+        size_t i;
+        for(i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+        {
+            if(!strcasecmp(signal->protocol, names[i].name))
+                break;
+        }
+
+        if(i == sizeof(names) / sizeof(names[0]) || !IR_get_protocol_info(names[i].protocol))
+        {
+            result->unsupported++;
+        }
+        else
+        {
+            uint16_t address = (uint16_t)signal->address;
+            // Samsung32 repeats its 8-bit custom code
+            if(names[i].protocol == IR_PROTOCOL_SAMSUNG)
+                address = (uint16_t)((address & 0xFFU) * 0x0101U);
+            add_frame(result, names[i].protocol,
+                      IR_encode_data_ext(names[i].protocol, address, (uint16_t)signal->command), device, signal->button);
+        }
+    }
+    memset(signal, 0, sizeof(*signal));
+}
+
+static void parse_flipper(File_Result_t* result, Scratch_t* scratch, const char* text, size_t size)
+{
+    const char* cursor = text;
+    const char* line;
+    const char* end;
+    const char* value;
+    uint32_t device = add_basename(result);
+    Flipper_Signal_t signal;
+
+    memset(&signal, 0, sizeof(signal));
+    while(next_line(&cursor, text + size, &line, &end))
+    {
+        if(flipper_field(line, end, "name", &value))
+        {
+            flipper_finish(result, scratch, &signal, device);
+            signal.button = add_string(result, value, (size_t)(end - value));
+            signal.have_name = 1;
+            IR_pulse_train_init(&scratch->train, scratch->buffer, TRAIN_MAX, 38000);
+        }
+        else if(flipper_field(line, end, "type", &value))
+        {
+            signal.raw = ((size_t)(end - value) == 3U && !strncasecmp(value, "raw", 3));
+        }
+        else if(flipper_field(line, end, "protocol", &value))
+        {
+            size_t length = (size_t)(end - value);
+            if(length >= sizeof(signal.protocol))
+                length = sizeof(signal.protocol) - 1U;
+            memcpy(signal.protocol, value, length);
+            signal.protocol[length] = '\0';
+        }
+        else if(flipper_field(line, end, "address", &value))
+        {
+            signal.address = flipper_bytes(value, end);
+        }
+        else if(flipper_field(line, end, "command", &value))
+        {
+            signal.command = flipper_bytes(value, end);
+        }
+        else if(flipper_field(line, end, "frequency", &value))
+        {
+            scratch->train.carrier_freq = (uint32_t)token_number(value, (size_t)(end - value), 10);
+        }
+        else if(flipper_field(line, end, "data", &value))
+        {
+            train_numbers(&scratch->train, value, end);     // Long signals repeat the data line
+        }
+    }
+    flipper_finish(result, scratch, &signal, device);
+}
+
+// LIRC remote parameters used for normalization
+typedef struct {
+    uint32_t name;
+    int have_name;
+    unsigned bits;
+    unsigned pre_bits;
+    unsigned post_bits;
+    unsigned long long pre;
+    unsigned long long post;
+    unsigned header[2];
+    unsigned one[2];
+    unsigned zero[2];
+    unsigned plead;
+    unsigned ptrail;
+    unsigned long frequency;
+    int rc5;
+    int rc6;
+    int reverse;
+} Lirc_Remote_t;
+
+static void lirc_pair(const char* p, const char* end, unsigned* pair)
+{
+    const char* token;
+    size_t length;
+
+    for(int i = 0; i < 2 && next_token(&p, end, &token, &length); i++)
+    {
+        pair[i] = (unsigned)token_number(token, length, 10);
+    }
+}
+
+static void lirc_code(File_Result_t* result, Scratch_t* scratch, const Lirc_Remote_t* remote,
+                      uint32_t device, uint32_t button, unsigned long long code)
+{
+    unsigned total = remote->pre_bits + remote->bits + remote->post_bits;
+    unsigned long long value;
+
+    if(remote->bits == 0U || total > 64U)
+    {
+        result->unsupported++;
+        return;
+    }
+    value = (code << remote->post_bits) | remote->post;
+    if(remote->pre_bits)
+        value |= remote->pre << (remote->bits + remote->post_bits);
+
+    // Biphase codes: fields straight from the bits (RC5: S2, toggle, 5+6; RC6 mode 0: 8+8)
+    if(remote->rc5 || remote->rc6)
+    {
+        IR_Protocol_t protocol = remote->rc5 ? IR_PROTOCOL_RC5 : IR_PROTOCOL_RC6;
+        uint8_t address = remote->rc5 ? (uint8_t)((value >> 6) & 0x1FU) : (uint8_t)((value >> 8) & 0xFFU);
+        uint8_t command = remote->rc5 ? (uint8_t)(value & 0x3FU) : (uint8_t)(value & 0xFFU);
+
+        if(!IR_get_protocol_info(protocol))
+            result->unsupported++;
+        else
+            add_frame(result, protocol, IR_encode_data_ext(protocol, address, command), device, button);
+        return;
+    }
+
+    if(remote->one[0] == 0U || remote->zero[0] == 0U)
+    {
+        result->unsupported++;
+        return;
+    }
+
+    // Pulse distance/width: render as sent, then decode
+    IR_Pulse_Train_t* train = &scratch->train;
+    IR_pulse_train_init(train, scratch->buffer, TRAIN_MAX, remote->frequency ? remote->frequency : 38000UL);
+    if(remote->plead)
+        IR_pulse_train_append(train, IR_HIGH, remote->plead);
+    if(remote->header[0])
+    {
+        IR_pulse_train_append(train, IR_HIGH, remote->header[0]);
+        IR_pulse_train_append(train, IR_LOW, remote->header[1]);
+    }
+    for(unsigned i = 0; i < total; i++)
+    {
+        unsigned bit = remote->reverse ? i : total - 1U - i;
+        const unsigned* pair = ((value >> bit) & 1U) ? remote->one : remote->zero;
+
+        IR_pulse_train_append(train, IR_HIGH, pair[0]);
+        IR_pulse_train_append(train, IR_LOW, pair[1]);
+    }
+    if(remote->ptrail)
+        IR_pulse_train_append(train, IR_HIGH, remote->ptrail);
+    IR_pulse_train_append(train, IR_LOW, IR_PRONTO_GAP_US);
+
+    add_train(result, train, device, button);
+}
+
+static void parse_lirc(File_Result_t* result, Scratch_t* scratch, const char* text, size_t size)
+{
+    enum { OUTSIDE, REMOTE, CODES, RAW_CODES } state = OUTSIDE;
+    const char* cursor = text;
+    const char* line;
+    const char* end;
+    uint32_t file_name = add_basename(result);
+    uint32_t raw_button = 0;
+    int raw_pending = 0;
+    Lirc_Remote_t remote;
+
+    memset(&remote, 0, sizeof(remote));
+    while(next_line(&cursor, text + size, &line, &end))
+    {
+        const char* p = line;
+        const char* token;
+        size_t length;
+        uint32_t device = remote.have_name ? remote.name : file_name;
+
+        if(line == end || *line == '#' || !next_token(&p, end, &token, &length))
+            continue;
+
+        if(token_is(token, length, "begin") || token_is(token, length, "end"))
+        {
+            int begin = token_is(token, length, "begin");
+            const char* what;
+            size_t what_length;
+
+            if(!next_token(&p, end, &what, &what_length))
+                continue;
+            if(state == RAW_CODES && raw_pending)
+            {
+                add_train(result, &scratch->train, device, raw_button);
+                raw_pending = 0;
+            }
+            if(token_is(what, what_length, "remote"))
+            {
+                state = begin ? REMOTE : OUTSIDE;
+                memset(&remote, 0, sizeof(remote));
+            }
+            else if(token_is(what, what_length, "codes"))
+            {
+                state = begin ? CODES : REMOTE;
+            }
+            else if(token_is(what, what_length, "raw_codes"))
+            {
+                state = begin ? RAW_CODES : REMOTE;
+            }
+            continue;
+        }
+
+        if(state == CODES)
+        {
+            const char* value;
+            size_t value_length;
+
+            if(next_token(&p, end, &value, &value_length))
+                lirc_code(result, scratch, &remote, device, add_string(result, token, length),
+                          token_number(value, value_length, 0));
+        }
+        else if(state == RAW_CODES)
+        {
+            if(token_is(token, length, "name"))
+            {
+                const char* name;
+                size_t name_length;
+
+                if(raw_pending)
+                    add_train(result, &scratch->train, device, raw_button);
+                raw_pending = next_token(&p, end, &name, &name_length);
+                if(raw_pending)
+                    raw_button = add_string(result, name, name_length);
+                IR_pulse_train_init(&scratch->train, scratch->buffer, TRAIN_MAX,
+                                    remote.frequency ? remote.frequency : 38000UL);
+            }
+            else if(raw_pending)
+            {
+                train_numbers(&scratch->train, line, end);
+            }
+        }
+        else if(state == REMOTE)
+        {
+            if(token_is(token, length, "name"))
+            {
+                const char* name;
+                size_t name_length;
+                if(next_token(&p, end, &name, &name_length))
+                {
+                    remote.name = add_string(result, name, name_length);
+                    remote.have_name = 1;
+                }
+            }
+            else if(token_is(token, length, "bits"))
+                remote.bits = (unsigned)token_number(p, (size_t)(end - p), 10);
+            else if(token_is(token, length, "pre_data_bits"))
+                remote.pre_bits = (unsigned)token_number(p, (size_t)(end - p), 10);
+            else if(token_is(token, length, "post_data_bits"))
+                remote.post_bits = (unsigned)token_number(p, (size_t)(end - p), 10);
+            else if(token_is(token, length, "pre_data"))
+                remote.pre = token_number(p, (size_t)(end - p), 0);
+            else if(token_is(token, length, "post_data"))
+                remote.post = token_number(p, (size_t)(end - p), 0);
+            else if(token_is(token, length, "header"))
+                lirc_pair(p, end, remote.header);
+            else if(token_is(token, length, "one"))
+                lirc_pair(p, end, remote.one);
+            else if(token_is(token, length, "zero"))
+                lirc_pair(p, end, remote.zero);
+            else if(token_is(token, length, "plead"))
+                remote.plead = (unsigned)token_number(p, (size_t)(end - p), 10);
+            else if(token_is(token, length, "ptrail"))
+                remote.ptrail = (unsigned)token_number(p, (size_t)(end - p), 10);
+            else if(token_is(token, length, "frequency"))
+                remote.frequency = (unsigned long)token_number(p, (size_t)(end - p), 10);
+            else if(token_is(token, length, "flags"))
+            {
+                // Flags are '|'-separated: look for the encodings by name
+                char flags[128];
+                size_t n = (size_t)(end - p) < sizeof(flags) - 1U ? (size_t)(end - p) : sizeof(flags) - 1U;
+                memcpy(flags, p, n);
+                flags[n] = '\0';
+                remote.rc5 = strstr(flags, "RC5") != 0 || strstr(flags, "SHIFT_ENC") != 0;
+                remote.rc6 = strstr(flags, "RC6") != 0;
+                remote.reverse = strstr(flags, "REVERSE") != 0;
+            }
+        }
+    }
+
+    if(state == RAW_CODES && raw_pending)
+        add_train(result, &scratch->train, remote.have_name ? remote.name : file_name, raw_button);
+}
+
+static void parse_file(File_Result_t* result, Scratch_t* scratch)
+{
+    struct stat info;
+    int fd = open(result->path, O_RDONLY);
+
+    if(fd < 0 || fstat(fd, &info) != 0)
+    {
+        perror(result->path);
+        result->error = 1;
+        if(fd >= 0)
+            close(fd);
+        return;
+    }
+    if(info.st_size == 0)
+    {
+        close(fd);
+        return;
+    }
+
+    const char* text = mmap(0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(text == MAP_FAILED)
+    {
+        perror(result->path);
+        result->error = 1;
+        return;
+    }
+
+    // Flipper files announce themselves on the first line
+    if(info.st_size >= 9 && !strncmp(text, "Filetype:", 9))
+        parse_flipper(result, scratch, text, (size_t)info.st_size);
+    else
+        parse_lirc(result, scratch, text, (size_t)info.st_size);
+
+    munmap((void*)text, (size_t)info.st_size);
+}
+
+static void* worker(void* argument)
+{
+    Work_t* work = argument;
+    Scratch_t* scratch = malloc(sizeof(Scratch_t));
+
+    if(!scratch)
+        return 0;
+
+    for(;;)
+    {
+        pthread_mutex_lock(&work->lock);
+        size_t index = work->next++;
+        pthread_mutex_unlock(&work->lock);
+
+        if(index >= work->count)
+            break;
+        parse_file(&work->results[index], scratch);
+    }
+
+    free(scratch);
+    return 0;
+}
+
+static void parse_all(File_Result_t* results, size_t count, unsigned threads)
+{
+    pthread_t pool[MAX_THREADS];
+    Work_t work;
+
+    work.results = results;
+    work.count = count;
+    work.next = 0;
+    pthread_mutex_init(&work.lock, 0);
+
+    if(threads > count)
+        threads = count ? (unsigned)count : 1U;
+    for(unsigned i = 1; i < threads; i++)
+    {
+        if(pthread_create(&pool[i], 0, worker, &work) != 0)
+            threads = i;
+    }
+    worker(&work);
+    for(unsigned i = 1; i < threads; i++)
+    {
+        pthread_join(pool[i], 0);
+    }
+
+    pthread_mutex_destroy(&work.lock);
+}
+
+// Merged entry: names resolved to strings
+typedef struct {
+    uint8_t protocol;
+    uint8_t variant;
+    uint16_t address;
+    uint16_t command;
+    const char* device;
+    const char* button;
+} Merged_t;
+
+static int merged_compare(const void* a, const void* b)
+{
+    const Merged_t* x = a;
+    const Merged_t* y = b;
+    int order;
+
+    if(x->protocol != y->protocol)
+        return x->protocol < y->protocol ? -1 : 1;
+    if(x->address != y->address)
+        return x->address < y->address ? -1 : 1;
+    if(x->command != y->command)
+        return x->command < y->command ? -1 : 1;
+    if((order = strcmp(x->device, y->device)) != 0)
+        return order;
+    if((order = strcmp(x->button, y->button)) != 0)
+        return order;
+    return (int)x->variant - (int)y->variant;
+}
+
+// String table with deduplication: open addressing over offsets
+typedef struct {
+    char* data;
+    size_t size;
+    size_t space;
+    uint32_t* slots;                    // Offset + 1, 0 = empty
+    size_t slot_count;
+    size_t used;
+} String_Table_t;
+
+static uint32_t hash_string(const char* text)
+{
+    uint32_t hash = 2166136261U;    // FNV-1a
+    while(*text)
+    {
+        hash = (hash ^ (uint8_t)*text++) * 16777619U;
+    }
+    return hash;
+}
+
+static uint32_t intern(String_Table_t* table, const char* text)
+{
+    if((table->used + 1U) * 2U > table->slot_count)
+    {
+        size_t count = table->slot_count ? table->slot_count * 2U : 1024U;
+        uint32_t* slots = calloc(count, sizeof(uint32_t));
+        if(!slots)
+        {
+            fputs("out of memory\n", stderr);
+            exit(1);
+        }
+        for(size_t i = 0; i < table->slot_count; i++)
+        {
+            if(table->slots[i])
+            {
+                size_t j = hash_string(table->data + table->slots[i] - 1U) & (count - 1U);
+                while(slots[j])
+                    j = (j + 1U) & (count - 1U);
+                slots[j] = table->slots[i];
+            }
+        }
+        free(table->slots);
+        table->slots = slots;
+        table->slot_count = count;
+    }
+
+    size_t j = hash_string(text) & (table->slot_count - 1U);
+    while(table->slots[j])
+    {
+        if(!strcmp(table->data + table->slots[j] - 1U, text))
+            return table->slots[j] - 1U;
+        j = (j + 1U) & (table->slot_count - 1U);
+    }
+
+    size_t length = strlen(text) + 1U;
+    uint32_t offset = (uint32_t)table->size;
+    table->data = grow(table->data, &table->space, table->size + length, 1U);
+    memcpy(table->data + offset, text, length);
+    table->size += length;
+    table->slots[j] = offset + 1U;
+    table->used++;
+    return offset;
+}
+
+static void put16(uint8_t* out, uint16_t value)
+{
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t* out, uint32_t value)
+{
+    put16(out, (uint16_t)value);
+    put16(out + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t get16(const uint8_t* in)
+{
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* in)
+{
+    return (uint32_t)get16(in) | ((uint32_t)get16(in + 2) << 16);
+}
+
+static int write_index(const char* path, File_Result_t* results, size_t count, size_t* written)
+{
+    size_t total = 0;
+    size_t unique = 0;
+    String_Table_t strings;
+    Merged_t* merged;
+    FILE* out;
+    uint8_t record[INDEX_HEADER_SIZE > INDEX_ENTRY_SIZE ? INDEX_HEADER_SIZE : INDEX_ENTRY_SIZE];
+
+    for(size_t i = 0; i < count; i++)
+    {
+        total += results[i].count;
+    }
+    merged = malloc((total ? total : 1U) * sizeof(Merged_t));
+    if(!merged)
+        return 1;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        for(size_t e = 0; e < results[i].count; e++)
+        {
+            const Entry* entry = &results[i].entries[e];
+            if(entry->protocol >= IR_PROTOCOL_COUNT)
+                continue;
+            merged[unique].protocol = entry->protocol;
+            merged[unique].variant = entry->variant;
+            merged[unique].address = entry->address;
+            merged[unique].command = entry->command;
+            merged[unique].device = results[i].strings + entry->device;
+            merged[unique].button = results[i].strings + entry->button;
+            unique++;
+        }
+    }
+
+    qsort(merged, unique, sizeof(Merged_t), merged_compare);
+    total = 0;
+    for(size_t i = 0; i < unique; i++)
+    {
+        if(total == 0 || merged_compare(&merged[total - 1U], &merged[i]) != 0)
+            merged[total++] = merged[i];
+    }
+
+    // Names interned in entry order, so the table is as deterministic as the entries
+    memset(&strings, 0, sizeof(strings));
+    uint32_t* names = malloc((total ? total : 1U) * 2U * sizeof(uint32_t));
+    if(!names)
+    {
+        free(merged);
+        return 1;
+    }
+    for(size_t i = 0; i < total; i++)
+    {
+        names[2U * i] = intern(&strings, merged[i].device);
+        names[2U * i + 1U] = intern(&strings, merged[i].button);
+    }
+
+    out = fopen(path, "wb");
+    if(!out)
+    {
+        perror(path);
+        free(names);
+        free(merged);
+        free(strings.data);
+        free(strings.slots);
+        return 1;
+    }
+
+    memcpy(record, INDEX_MAGIC, 4);
+    put16(&record[4], INDEX_VERSION);
+    put16(&record[6], INDEX_ENTRY_SIZE);
+    put32(&record[8], (uint32_t)total);
+    put32(&record[12], (uint32_t)(INDEX_HEADER_SIZE + total * INDEX_ENTRY_SIZE));
+    put32(&record[16], (uint32_t)strings.size);
+    fwrite(record, 1, INDEX_HEADER_SIZE, out);
+
+    for(size_t i = 0; i < total; i++)
+    {
+        record[0] = merged[i].protocol;
+        record[1] = merged[i].variant;
+        put16(&record[2], merged[i].address);
+        put16(&record[4], merged[i].command);
+        put16(&record[6], 0);
+        put32(&record[8], names[2U * i]);
+        put32(&record[12], names[2U * i + 1U]);
+        fwrite(record, 1, INDEX_ENTRY_SIZE, out);
+    }
+    if(strings.size)
+        fwrite(strings.data, 1, strings.size, out);
+
+    *written = total;
+    free(names);
+    free(merged);
+    free(strings.data);
+    free(strings.slots);
+    return fclose(out) != 0;
+}
+
+static int protocol_from_name(const char* name)
+{
+    for(int protocol = 0; protocol < IR_PROTOCOL_COUNT; protocol++)
+    {
+        if(IR_get_protocol_info((IR_Protocol_t)protocol) && !strcasecmp(name, IR_get_protocol_name((IR_Protocol_t)protocol)))
+            return protocol;
+    }
+    return -1;
+}
+
+// Binary search of the mapped index for every entry of one key
+static int lookup(const char* path, int protocol, uint16_t address, uint16_t command)
+{
+    struct stat info;
+    int fd = open(path, O_RDONLY);
+    int found = 0;
+
+    if(fd < 0 || fstat(fd, &info) != 0 || info.st_size < (off_t)INDEX_HEADER_SIZE)
+    {
+        fprintf(stderr, "%s: not an index\n", path);
+        if(fd >= 0)
+            close(fd);
+        return 2;
+    }
+
+    const uint8_t* map = mmap(0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+    {
+        perror(path);
+        return 2;
+    }
+
+    uint32_t count = get32(&map[8]);
+    uint32_t strings = get32(&map[12]);
+    uint32_t string_size = get32(&map[16]);
+    if(memcmp(map, INDEX_MAGIC, 4) != 0 || get16(&map[4]) != INDEX_VERSION ||
+       get16(&map[6]) != INDEX_ENTRY_SIZE || strings != INDEX_HEADER_SIZE + (uint64_t)count * INDEX_ENTRY_SIZE ||
+       (uint64_t)strings + string_size > (uint64_t)info.st_size ||
+       (string_size > 0U && map[strings + string_size - 1U] != '\0'))
+    {
+        fprintf(stderr, "%s: not an index\n", path);
+        munmap((void*)map, (size_t)info.st_size);
+        return 2;
+    }
+
+    const uint8_t* entries = map + INDEX_HEADER_SIZE;
+    uint64_t key = ((uint64_t)protocol << 32) | ((uint32_t)address << 16) | command;
+    uint32_t low = 0;
+    uint32_t high = count;
+
+    // First entry whose key is not below the one wanted
+    while(low < high)
+    {
+        uint32_t middle = low + (high - low) / 2U;
+        const uint8_t* e = entries + (size_t)middle * INDEX_ENTRY_SIZE;
+        uint64_t k = ((uint64_t)e[0] << 32) | ((uint32_t)get16(&e[2]) << 16) | get16(&e[4]);
+        if(k < key)
+            low = middle + 1U;
+        else
+            high = middle;
+    }
+
+    for(; low < count; low++)
+    {
+        const uint8_t* e = entries + (size_t)low * INDEX_ENTRY_SIZE;
+        if(e[0] != protocol || get16(&e[2]) != address || get16(&e[4]) != command)
+            break;
+        uint32_t device = get32(&e[8]);
+        uint32_t button = get32(&e[12]);
+        if(device >= string_size || button >= string_size)
+            continue;
+        printf("%s\t%s\n", (const char*)map + strings + device, (const char*)map + strings + button);
+        found++;
+    }
+
+    munmap((void*)map, (size_t)info.st_size);
+    return found ? 0 : 1;
+}
+
+static void list(File_Result_t* results, size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        for(size_t e = 0; e < results[i].count; e++)
+        {
+            const Entry* entry = &results[i].entries[e];
+            const char* device = results[i].strings + entry->device;
+            const char* button = results[i].strings + entry->button;
+
+            if(entry->protocol >= IR_PROTOCOL_COUNT)
+                printf("%s\t%s\traw %u durations %lu Hz\n", device, button, entry->durations, (unsigned long)entry->carrier);
+            else
+                printf("%s\t%s\t%s addr=0x%04X cmd=0x%04X\n", device, button,
+                       IR_get_protocol_name((IR_Protocol_t)entry->protocol), entry->address, entry->command);
+        }
+    }
+}
+
+static int usage(void)
+{
+    fputs("usage: ir_index build [-j threads] -o index.irx files...\n"
+          "       ir_index list [-j threads] files...\n"
+          "       ir_index lookup index.irx protocol address command\n"
+          "       ir_index lookup index.irx protocol raw raw_data\n", stderr);
+    return 2;
+}
+
+// Paths from the command line, "-" for one path per line on stdin
+static char** collect_paths(int argc, char** argv, size_t* count)
+{
+    char** paths = 0;
+    size_t capacity = 0;
+    char* line = 0;
+    size_t line_size = 0;
+
+    *count = 0;
+    for(int i = 0; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-") != 0)
+        {
+            paths = grow(paths, &capacity, *count + 1U, sizeof(char*));
+            paths[(*count)++] = strdup(argv[i]);
+            continue;
+        }
+        ssize_t length;
+        while((length = getline(&line, &line_size, stdin)) > 0)
+        {
+            while(length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+                line[--length] = '\0';
+            if(length == 0)
+                continue;
+            paths = grow(paths, &capacity, *count + 1U, sizeof(char*));
+            paths[(*count)++] = strdup(line);
+        }
+    }
+    free(line);
+    return paths;
+}
+
+int main(int argc, char** argv)
+{
+    const char* output = 0;
+    unsigned threads = 0;
+    int first = 2;
+
+    if(argc < 2)
+        return usage();
+
+    if(!strcmp(argv[1], "lookup"))
+    {
+        int protocol;
+        unsigned long address;
+        unsigned long command;
+
+        if(argc != 6 || (protocol = protocol_from_name(argv[3])) < 0)
+            return usage();
+        if(!strcmp(argv[4], "raw"))
+        {
+            IR_Data_Ext_t data;
+            IR_decode_data_ext((IR_Protocol_t)protocol, (uint32_t)strtoul(argv[5], 0, 0), &data);
+            address = data.address;
+            command = data.command;
+        }
+        else
+        {
+            address = strtoul(argv[4], 0, 0);
+            command = strtoul(argv[5], 0, 0);
+        }
+        return lookup(argv[2], protocol, (uint16_t)address, (uint16_t)command);
+    }
+
+    if(strcmp(argv[1], "build") != 0 && strcmp(argv[1], "list") != 0)
+        return usage();
+
+    while(first + 1 < argc && argv[first][0] == '-' && argv[first][1] != '\0')
+    {
+        if(!strcmp(argv[first], "-j"))
+            threads = (unsigned)strtoul(argv[first + 1], 0, 0);
+        else if(!strcmp(argv[first], "-o"))
+            output = argv[first + 1];
+        else
+            return usage();
+        first += 2;
+    }
+    if(!strcmp(argv[1], "build") && !output)
+        return usage();
+
+    if(threads == 0U)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (unsigned)online : 1U;
+    }
+    if(threads > MAX_THREADS)
+        threads = MAX_THREADS;
+
+    size_t count;
+    char** paths = collect_paths(argc - first, argv + first, &count);
+    File_Result_t* results = calloc(count ? count : 1U, sizeof(File_Result_t));
+    if(!results)
+        return 1;
+    for(size_t i = 0; i < count; i++)
+    {
+        results[i].path = paths[i];
+    }
+
+    parse_all(results, count, threads);
+
+    unsigned long entries = 0, raw_decoded = 0, undecoded = 0, unsupported = 0, errors = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        entries += results[i].count;
+        raw_decoded += results[i].raw_decoded;
+        undecoded += results[i].undecoded;
+        unsupported += results[i].unsupported;
+        errors += (unsigned long)results[i].error;
+    }
+
+    int status = errors ? 1 : 0;
+    if(output)
+    {
+        size_t written = 0;
+        if(write_index(output, results, count, &written) != 0)
+            status = 1;
+        fprintf(stderr, "%lu files, %lu codes (%lu pulse trains decoded, %lu undecoded, %lu unsupported), %lu index entries\n",
+                (unsigned long)count, entries, raw_decoded, undecoded, unsupported, (unsigned long)written);
+    }
+    else
+    {
+        list(results, count);
+    }
+
+    for(size_t i = 0; i < count; i++)
+    {
+        free(results[i].entries);
+        free(results[i].strings);
+        free(paths[i]);
+    }
+    free(results);
+    free(paths);
+    return status;
+}
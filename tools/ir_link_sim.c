@@ -0,0 +1,286 @@
+/**
+ * ir_link_sim.c - Host Loopback Simulator for the IR Data Link
+ *
+ * Two ir_link.h endpoints on simulated time. Each endpoint's transmitter
+ * HAL delivers its carrier edges straight into the other endpoint's
+ * receiver, with optional timing jitter and line errors (a space misread
+ * as the neighbouring bit or symbol value). Endpoint A sends a byte stream
+ * to B, whose main loop collects and checks it; the main loops run once per
+ * simulated millisecond. Prints payload throughput in bytes/s and the link
+ * counters, or with -t a benchmark table of throughput against error rate
+ * for both line codings.
+ *
+ *   ir_link_sim [-c nec|ppm] [-b bytes] [-p payload] [-e error_rate] [-j jitter_us] [-s seed] [-t]
+ * Author: Nghia Taarabt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ir_link.h"
+
+#define SIM_LOOP_US         (1000U)                 // Main loop period
+#define SIM_TIME_LIMIT_US   (3600ULL * 1000000ULL)  // Give up after an hour
+
+typedef struct {
+    IR_Link_t link;
+    unsigned long long last_edge_us;
+} Sim_End_t;
+
+typedef struct {
+    unsigned long delivered;
+    unsigned long corrupt;
+    double seconds;
+} Sim_Result_t;
+
+static Sim_End_t ends[2];
+static unsigned long long sim_now_us = 0;
+static unsigned long long sim_ticks = 0;
+static double error_rate = 0.0;
+static unsigned jitter_us = 0;
+static unsigned long long rng_state = 0x9E3779B97F4A7C15ULL;
+
+static unsigned long long sim_random(void)
+{
+    // xorshift64*: reproducible for a given seed on every host
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double sim_uniform(void)
+{
+    return (double)(sim_random() >> 11) / (double)(1ULL << 53);
+}
+
+static void sim_advance(unsigned long long us)
+{
+    sim_now_us += us;
+
+    // Timer interrupts: hand both endpoints the decoder ticks that passed
+    unsigned long long ticks = (sim_now_us * 5ULL) >> 6;
+    while(sim_ticks < ticks)
+    {
+        unsigned long long step = ticks - sim_ticks;
+        if(step > 0xFFFFU)
+            step = 0xFFFFU;
+        sim_ticks += step;
+        IR_link_timeout_advance(&ends[0].link, (uint16_t)step);
+        IR_link_timeout_advance(&ends[1].link, (uint16_t)step);
+    }
+}
+
+// Misread a data space: pulse distance swaps 0 and 1, PPM moves one slot
+static long long sim_line_error(const IR_Link_t* link, long long us)
+{
+    const long long unit = link->unit_us;
+
+    if(link->coding == IR_PROTOCOL_PPM)
+    {
+        if(us <= unit / 2 || us >= unit * 9 / 2)
+            return us;
+        if(us < unit * 3 / 2)
+            return us + unit;
+        if(us > unit * 7 / 2)
+            return us - unit;
+        return (sim_random() & 1U) ? us + unit : us - unit;
+    }
+
+    if(us <= unit / 2 || us >= unit * 4)
+        return us;
+    return (us < unit * 2) ? unit * 3 : unit;
+}
+
+// Carrier edge from endpoint 'from' as seen by the other endpoint's receiver
+static void sim_edge(int from, uint8_t level)
+{
+    Sim_End_t* peer = &ends[1 - from];
+    long long us = (long long)(sim_now_us - peer->last_edge_us);
+
+    peer->last_edge_us = sim_now_us;
+
+    // A mark starting ends a space
+    if(level == IR_HIGH && error_rate > 0.0 && sim_uniform() < error_rate)
+        us = sim_line_error(&peer->link, us);
+
+    if(jitter_us)
+        us += (long long)(sim_random() % (2U * jitter_us + 1U)) - (long long)jitter_us;
+    if(us < 0)
+        us = 0;
+    if(us > (long long)IR_TICKS_MAX_US)
+        us = (long long)IR_TICKS_MAX_US;
+
+    IR_link_process_duration(&peer->link, level, IR_US_TO_TICKS(us));
+}
+
+static void sim_a_carrier_on(void)  { sim_edge(0, IR_HIGH); }
+static void sim_a_carrier_off(void) { sim_edge(0, IR_LOW); }
+static void sim_b_carrier_on(void)  { sim_edge(1, IR_HIGH); }
+static void sim_b_carrier_off(void) { sim_edge(1, IR_LOW); }
+static void sim_delay_us(uint16_t us) { sim_advance(us); }
+static void sim_delay_ms(uint16_t ms) { sim_advance(ms * 1000ULL); }
+
+// Raw line rate: pulse distance averages 3 units per bit, PPM 3.5 slots per 2 bits
+static double line_bit_rate(IR_Protocol_t coding)
+{
+    return (coding == IR_PROTOCOL_PPM) ? 2e6 / (IR_PPM_SLOT_US * 3.5) : 1e6 / (IR_LINK_UNIT_US * 3.0);
+}
+
+static void print_stats(const char* name, const IR_Link_Stats_t* stats)
+{
+    printf("%s: sent %u  retransmits %u  failures %u  acks %u  received %u  duplicates %u  crc errors %u  line errors %u\n",
+           name, stats->frames_sent, stats->retransmits, stats->failures, stats->acks_sent,
+           stats->frames_received, stats->duplicates, stats->crc_errors, stats->line_errors);
+}
+
+// Send stream[0..total) from A to B over a fresh pair of endpoints
+static Sim_Result_t sim_run(IR_Protocol_t coding, const uint8_t* stream, unsigned long total, unsigned payload)
+{
+    static IR_TX_HAL_t tx_hal[2] = {
+        { sim_a_carrier_on, sim_a_carrier_off, sim_delay_us, sim_delay_ms, 0 },
+        { sim_b_carrier_on, sim_b_carrier_off, sim_delay_us, sim_delay_ms, 0 },
+    };
+    IR_HAL_t hal = {0};     // Edges arrive as durations: no timer functions
+    Sim_Result_t result = {0, 0, 0.0};
+    unsigned long sent = 0;             // Bytes handed to A
+    unsigned long inflight = 0;         // Offset of the payload A is sending
+
+    memset(ends, 0, sizeof(ends));
+    sim_now_us = 0;
+    sim_ticks = 0;
+
+    for(int i = 0; i < 2; i++)
+    {
+        IR_link_init(&ends[i].link, &tx_hal[i], &hal);
+        IR_link_set_coding(&ends[i].link, coding);
+    }
+
+    while((result.delivered < total || IR_link_is_busy(&ends[0].link)) && sim_now_us < SIM_TIME_LIMIT_US)
+    {
+        if(!IR_link_is_busy(&ends[0].link) && sent < total)
+        {
+            unsigned chunk = (total - sent < payload) ? (unsigned)(total - sent) : payload;
+            IR_link_send(&ends[0].link, &stream[sent], (uint8_t)chunk);
+            inflight = sent;
+            sent += chunk;
+        }
+        else if(!IR_link_is_busy(&ends[0].link) && sent >= total)
+        {
+            break;
+        }
+
+        IR_link_service(&ends[0].link);
+        IR_link_service(&ends[1].link);
+
+        uint8_t data[IR_LINK_MAX_PAYLOAD];
+        uint8_t length;
+        if(IR_link_receive(&ends[1].link, data, &length) == IR_SUCCESS)
+        {
+            // Stop-and-wait: B only ever delivers the payload A has in flight
+            if(memcmp(data, &stream[inflight], length) != 0)
+                result.corrupt++;
+            result.delivered += length;
+        }
+
+        sim_advance(SIM_LOOP_US);
+    }
+
+    result.seconds = (double)sim_now_us / 1e6;
+    return result;
+}
+
+// Throughput against error rate for both codings
+static unsigned long sim_table(const uint8_t* stream, unsigned long total, unsigned payload)
+{
+    static const double rates[] = { 0.0, 1e-4, 3e-4, 1e-3, 3e-3, 1e-2, 3e-2 };
+    static const IR_Protocol_t codings[] = { IR_PROTOCOL_NEC, IR_PROTOCOL_PPM };
+    unsigned long corrupt = 0;
+
+    printf("%lu bytes in %u-byte payloads, jitter %u us, error rate per data space\n", total, payload, jitter_us);
+    printf("%-7s %10s %10s %10s %12s %9s\n", "coding", "errors", "line b/s", "bytes/s", "retransmits", "failures");
+
+    for(unsigned c = 0; c < sizeof(codings) / sizeof(codings[0]); c++)
+    {
+        for(unsigned r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+        {
+            error_rate = rates[r];
+            Sim_Result_t result = sim_run(codings[c], stream, total, payload);
+            double rate = result.seconds > 0.0 ? (double)result.delivered / result.seconds : 0.0;
+
+            printf("%-7s %10g %10.0f %10.1f %12u %9u%s\n", IR_get_protocol_name(codings[c]), rates[r],
+                   line_bit_rate(codings[c]), rate, ends[0].link.stats.retransmits,
+                   ends[0].link.stats.failures, result.delivered < total ? "  (incomplete)" : "");
+            corrupt += result.corrupt;
+        }
+    }
+
+    if(corrupt)
+        printf("%lu corrupt payloads delivered\n", corrupt);
+    return corrupt;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long total = 1024;
+    unsigned payload = IR_LINK_MAX_PAYLOAD;
+    IR_Protocol_t coding = IR_PROTOCOL_NEC;
+    int table = 0;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "-t"))
+            table = 1;
+        else if(i + 1 >= argc)
+            break;
+        else if(!strcmp(argv[i], "-c"))
+            coding = !strcmp(argv[++i], "ppm") ? IR_PROTOCOL_PPM : IR_PROTOCOL_NEC;
+        else if(!strcmp(argv[i], "-b"))
+            total = strtoul(argv[++i], 0, 0);
+        else if(!strcmp(argv[i], "-p"))
+            payload = (unsigned)strtoul(argv[++i], 0, 0);
+        else if(!strcmp(argv[i], "-e"))
+            error_rate = strtod(argv[++i], 0);
+        else if(!strcmp(argv[i], "-j"))
+            jitter_us = (unsigned)strtoul(argv[++i], 0, 0);
+        else if(!strcmp(argv[i], "-s"))
+            rng_state ^= strtoull(argv[++i], 0, 0) * 0x9E3779B97F4A7C15ULL;
+        else
+            break;
+    }
+    if(payload == 0U || payload > IR_LINK_MAX_PAYLOAD)
+    {
+        fprintf(stderr, "payload must be 1..%u bytes\n", IR_LINK_MAX_PAYLOAD);
+        return 1;
+    }
+
+    uint8_t* stream = malloc(total ? total : 1U);
+    if(!stream)
+        return 1;
+    for(unsigned long i = 0; i < total; i++)
+    {
+        stream[i] = (uint8_t)sim_random();
+    }
+
+    if(table)
+    {
+        unsigned long corrupt = sim_table(stream, total, payload);
+        free(stream);
+        return corrupt ? 1 : 0;
+    }
+
+    Sim_Result_t result = sim_run(coding, stream, total, payload);
+
+    printf("%lu of %lu bytes in %u-byte payloads, %s coding, error rate %g, jitter %u us\n",
+           result.delivered, total, payload, IR_get_protocol_name(coding), error_rate, jitter_us);
+    printf("%.2f s simulated: %.1f bytes/s", result.seconds,
+           result.seconds > 0.0 ? (double)result.delivered / result.seconds : 0.0);
+    printf(" (line %.0f bit/s, %u us unit)\n", line_bit_rate(coding), ends[0].link.unit_us);
+    print_stats("A", &ends[0].link.stats);
+    print_stats("B", &ends[1].link.stats);
+    if(result.corrupt)
+        printf("%lu corrupt payloads delivered\n", result.corrupt);
+
+    free(stream);
+    return result.corrupt ? 1 : 0;
+}
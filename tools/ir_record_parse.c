@@ -0,0 +1,70 @@
+/**
+ * ir_record_parse.c - Host Parser for Binary Frame Records
+ *
+ * Reads the ir_record.h byte stream from a file, serial device or stdin and
+ * prints one line per valid record. Bytes that do not start a record with a
+ * matching CRC are skipped one at a time, so the parser locks on again after
+ * lost or corrupted bytes.
+ *
+ *   ir_record_parse [file]
+ * Author: Nghia Taarabt
+ */
+
+#include <stdio.h>
+#include "ir_record.h"
+
+int main(int argc, char** argv)
+{
+    FILE* in = stdin;
+    uint8_t window[IR_RECORD_SIZE];
+    uint8_t fill = 0;
+    unsigned long records = 0;
+    unsigned long skipped = 0;
+    int ch;
+
+    if(argc > 1)
+    {
+        in = fopen(argv[1], "rb");
+        if(!in)
+        {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    while((ch = fgetc(in)) != EOF)
+    {
+        IR_Data_t data;
+        uint32_t timestamp;
+
+        window[fill++] = (uint8_t)ch;
+        if(fill < IR_RECORD_SIZE)
+            continue;
+
+        if(IR_record_decode(window, &data, &timestamp) == IR_SUCCESS)
+        {
+            printf("%10lu us  %-9s addr=0x%02X cmd=0x%02X raw=0x%08lX%s%s%s\n",
+                   (unsigned long)timestamp, IR_get_protocol_name((IR_Protocol_t)data.protocol),
+                   data.address, data.command, (unsigned long)data.raw_data,
+                   (data.flags & IR_DATA_FLAG_REPEAT) ? " repeat" : "",
+                   (data.flags & IR_DATA_FLAG_LOW_CONFIDENCE) ? " low-confidence" : "",
+                   (data.flags & IR_DATA_FLAG_CORRECTED) ? " corrected" : "");
+            fflush(stdout);
+            records++;
+            fill = 0;
+            continue;
+        }
+
+        // Not a record here: drop one byte and look for the next sync
+        skipped++;
+        fill--;
+        for(uint8_t i = 0; i < fill; i++)
+            window[i] = window[i + 1];
+    }
+
+    fprintf(stderr, "%lu records, %lu bytes skipped\n", records, skipped + fill);
+
+    if(in != stdin)
+        fclose(in);
+    return 0;
+}
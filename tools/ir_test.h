@@ -0,0 +1,34 @@
+/**
+ * ir_test.h - Host Test Helpers
+ *
+ * IR_CHECK() records a condition and reports it when false; a test program
+ * ends with IR_test_result(), which prints a summary line and returns the
+ * exit status for `make test`.
+ * Author: Nghia Taarabt
+ */
+
+#ifndef IR_TEST_H_
+#define IR_TEST_H_
+
+#include <stdio.h>
+
+static unsigned long ir_test_checks = 0;
+static unsigned long ir_test_failures = 0;
+
+#define IR_CHECK(cond) \
+    do { \
+        ir_test_checks++; \
+        if(!(cond)) \
+        { \
+            ir_test_failures++; \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        } \
+    } while(0)
+
+static int IR_test_result(const char* name)
+{
+    printf("%-12s %lu checks, %lu failed\n", name, ir_test_checks, ir_test_failures);
+    return ir_test_failures ? 1 : 0;
+}
+
+#endif /* IR_TEST_H_ */
@@ -0,0 +1,732 @@
+/**
+ * ir_trace.c - Edge Trace Writer, Dumper and Replayer
+ *
+ * Host side of the ir_trace.h format: traces captured by a board
+ * (STM32_IR_TRACE_OUTPUT=1), converted from LIRC mode2 text or generated,
+ * replayed through the decoder straight from a mapped file.
+ *
+ *   ir_trace write [-o trace.irt] [mode2.txt]      "pulse N" / "space N" lines to a trace
+ *   ir_trace gen [-n frames] [-s seed] -o trace.irt protocol [address]
+ *                                                  frames with random commands
+ *   ir_trace dump trace.irt                        records as mode2 text
+ *   ir_trace replay [-p protocol] [-j threads] [-q] traces...
+ *                                                  decoded frames, then throughput
+ *
+ * Replay decodes records in place from the mapping with no per-record
+ * allocation or copy, one IR_decoder_process_duration() call per edge, so
+ * it runs at the speed of the decoder rather than of the file. Traces are
+ * cut into segments of about SEGMENT_BYTES at quiet gaps and decoded on a
+ * work-stealing pool of threads (one per core, -j to change), each segment
+ * with its own decoder. Frames are merged in file and time order, and the
+ * frame digest printed with the totals is the same for any thread count,
+ * so corpus runs compare with a single line.
+ * Author: Nghia Taarabt
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "ir_decoder.h"
+#include "ir_trace.h"
+#include "ir_pronto.h"
+
+#define OUTPUT_BUFFER_SIZE  (1U << 20)
+#define TRAIN_MAX           (512U)
+#define LEAD_IN_US          (100000UL)  // Quiet line before the first edge of a trace
+#define SEGMENT_BYTES       (1UL << 20) // Replay work unit
+#define SPLIT_GAP_US        (150000UL)  // Quiet time a segment may start after: longer than NEC's repeat gap
+#define SPLIT_FRAME_GAP_US  (20000UL)   // Fallback: longer than any space inside a frame
+#define SPLIT_SCAN_BYTES    (1UL << 16) // Search limit for such a gap past a nominal segment start
+#define MAX_THREADS         (256U)
+
+static int protocol_from_name(const char* name)
+{
+    for(int protocol = 0; protocol < IR_PROTOCOL_COUNT; protocol++)
+    {
+        if(IR_get_protocol_info((IR_Protocol_t)protocol) && !strcasecmp(name, IR_get_protocol_name((IR_Protocol_t)protocol)))
+            return protocol;
+    }
+    return -1;
+}
+
+static double seconds_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+static FILE* open_output(const char* path)
+{
+    FILE* out = path ? fopen(path, "wb") : stdout;
+    if(!out)
+    {
+        perror(path);
+        return 0;
+    }
+    setvbuf(out, 0, _IOFBF, OUTPUT_BUFFER_SIZE);
+    return out;
+}
+
+static int close_output(FILE* out, const char* path)
+{
+    int failed = ferror(out);
+    if(out == stdout)
+        failed |= fflush(out);
+    else
+        failed |= fclose(out);
+    if(failed)
+        fprintf(stderr, "%s: write failed\n", path ? path : "stdout");
+    return failed ? 1 : 0;
+}
+
+static void put_header(FILE* out)
+{
+    uint8_t header[IR_TRACE_HEADER_SIZE];
+    fwrite(header, 1, IR_trace_header(header, IR_TRACE_UNIT_US), out);
+}
+
+static void put_record(FILE* out, uint8_t level, uint32_t duration)
+{
+    uint8_t record[IR_TRACE_RECORD_MAX];
+    fwrite(record, 1, IR_trace_encode(record, level, duration), out);
+}
+
+// LIRC mode2 text: a pulse is a mark ending (IR_LOW edge), a space or
+// timeout a mark starting after it (IR_HIGH edge)
+static int write_mode2(const char* input, const char* output)
+{
+    FILE* in = input ? fopen(input, "r") : stdin;
+    char line[128];
+    unsigned long records = 0;
+
+    if(!in)
+    {
+        perror(input);
+        return 1;
+    }
+    FILE* out = open_output(output);
+    if(!out)
+    {
+        if(in != stdin)
+            fclose(in);
+        return 1;
+    }
+
+    put_header(out);
+    while(fgets(line, sizeof(line), in))
+    {
+        char kind[16];
+        unsigned long duration;
+
+        if(sscanf(line, "%15s %lu", kind, &duration) != 2)
+            continue;
+        if(!strcmp(kind, "pulse"))
+            put_record(out, IR_LOW, (uint32_t)duration);
+        else if(!strcmp(kind, "space") || !strcmp(kind, "timeout"))
+            put_record(out, IR_HIGH, (uint32_t)duration);
+        else
+            continue;
+        records++;
+    }
+
+    if(in != stdin)
+        fclose(in);
+    fprintf(stderr, "%lu records\n", records);
+    return close_output(out, output);
+}
+
+// Frames with random commands, each frame's trailing gap the space before
+// the next frame's first mark
+static int generate(const char* output, int protocol, uint16_t address, unsigned long frames, unsigned seed)
+{
+    uint16_t durations[TRAIN_MAX];
+    IR_Pulse_Train_t train;
+    IR_Data_t data;
+    uint32_t space = LEAD_IN_US;
+
+    FILE* out = open_output(output);
+    if(!out)
+        return 1;
+
+    srand(seed);
+    put_header(out);
+    memset(&data, 0, sizeof(data));
+    data.protocol = (uint8_t)protocol;
+    data.valid = 1;
+
+    for(unsigned long frame = 0; frame < frames; frame++)
+    {
+        data.raw_data = IR_encode_data_ext((IR_Protocol_t)protocol, address, (uint16_t)(rand() & 0xFF));
+        IR_pulse_train_init(&train, durations, TRAIN_MAX, 0);
+        if(IR_pronto_data_to_train(&data, &train) != IR_SUCCESS)
+        {
+            fprintf(stderr, "%s: cannot render frames\n", IR_get_protocol_name((IR_Protocol_t)protocol));
+            close_output(out, output);
+            return 1;
+        }
+
+        // Only the frame, not its repeat sequence
+        uint16_t length = train.repeat_index ? train.repeat_index : train.count;
+        for(uint16_t i = 0; i < length; i++)
+        {
+            if(i & 1U)
+            {
+                space = durations[i];
+                continue;
+            }
+            put_record(out, IR_HIGH, space);
+            put_record(out, IR_LOW, durations[i]);
+        }
+    }
+
+    return close_output(out, output);
+}
+
+// Map a whole trace read-only; returns the records after the header
+static const uint8_t* map_trace(const char* path, size_t* size, const uint8_t** map, uint32_t* unit_ns)
+{
+    struct stat info;
+    int fd = open(path, O_RDONLY);
+
+    if(fd < 0 || fstat(fd, &info) != 0)
+    {
+        perror(path);
+        if(fd >= 0)
+            close(fd);
+        return 0;
+    }
+    *size = (size_t)info.st_size;
+    *map = *size ? mmap(0, *size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    if(*map == MAP_FAILED || IR_trace_check_header(*map, (uint32_t)(*size < 0xFFFFFFFFU ? *size : 0xFFFFFFFFU), unit_ns) != IR_SUCCESS)
+    {
+        fprintf(stderr, "%s: not a trace\n", path);
+        if(*map != MAP_FAILED)
+            munmap((void*)*map, *size);
+        return 0;
+    }
+    posix_madvise((void*)*map, *size, POSIX_MADV_SEQUENTIAL);
+    return *map + IR_TRACE_HEADER_SIZE;
+}
+
+// Trace units to microseconds (1:1 for IR_TRACE_UNIT_US traces)
+static uint64_t to_us(uint32_t duration, uint32_t unit_ns)
+{
+    return (unit_ns == IR_TRACE_UNIT_US) ? duration : ((uint64_t)duration * unit_ns) / 1000U;
+}
+
+static int dump(const char* path)
+{
+    const uint8_t* map;
+    size_t size;
+    uint32_t unit_ns;
+    const uint8_t* p = map_trace(path, &size, &map, &unit_ns);
+    uint8_t level;
+    uint32_t duration;
+
+    if(!p)
+        return 1;
+    setvbuf(stdout, 0, _IOFBF, OUTPUT_BUFFER_SIZE);
+    while(IR_trace_decode(&p, map + size, &level, &duration) == IR_SUCCESS)
+    {
+        printf("%s %llu\n", level ? "space" : "pulse", (unsigned long long)to_us(duration, unit_ns));
+    }
+
+    int status = (p != map + size) ? 1 : 0;
+    if(status)
+        fprintf(stderr, "%s: truncated record at offset %lu\n", path, (unsigned long)(p - map));
+    munmap((void*)map, size);
+    return status;
+}
+
+// Replay work unit: the records between two split points of one trace.
+// Split points depend only on the data, so every thread count decodes the
+// same segments with the same results
+typedef struct {
+    const char* path;
+    const uint8_t* map;
+    size_t size;
+    const uint8_t* records;
+    uint32_t unit_ns;
+    uint32_t split;                     // SPLIT_GAP_US in trace units
+    uint32_t split_frame;               // SPLIT_FRAME_GAP_US in trace units
+} Trace_File_t;
+
+typedef struct {
+    uint64_t time_us;                   // Leader edge, us since the segment start
+    IR_Data_t data;
+} Frame_t;
+
+typedef struct {
+    const Trace_File_t* file;
+    size_t offset;                      // Nominal start: offset + SEGMENT_BYTES is the next one's
+    Frame_t* frames;                    // Not kept with -q
+    size_t count;
+    size_t capacity;
+    unsigned long frames_decoded;
+    unsigned long repeats;
+    unsigned long long records;
+    uint64_t time_us;                   // Signal time covered
+    uint64_t digest;                    // FNV-1a of every frame, times relative to the segment
+    const uint8_t* error;               // Truncated record
+} Segment_t;
+
+// Per-worker range of segment indices. The owner takes from the front;
+// an idle worker steals the back half of the fullest other range
+typedef struct {
+    pthread_mutex_t lock;
+    size_t next;
+    size_t end;
+} Worker_Queue_t;
+
+typedef struct {
+    Segment_t* segments;
+    Worker_Queue_t* queues;
+    unsigned threads;
+    int protocol;
+    int keep_frames;
+} Replay_t;
+
+typedef struct {
+    Replay_t* replay;
+    unsigned index;
+} Worker_t;
+
+static uint64_t fnv_add(uint64_t hash, uint64_t value, unsigned bytes)
+{
+    for(unsigned i = 0; i < bytes; i++)
+    {
+        hash ^= (uint8_t)(value >> (8U * i));
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+// First split point at or after offset: the start of a record with a mark
+// starting after at least SPLIT_GAP_US of quiet, so no frame and no repeat
+// chain (which needs the frame before it) is cut. Varints end in a byte
+// with bit 7 clear, so a record start is found from any offset. Without
+// such a gap within SPLIT_SCAN_BYTES, back-to-back frames are cut at the
+// first gap between two of them, and gapless noise at the first record
+static const uint8_t* split_point(const Trace_File_t* file, size_t offset)
+{
+    const uint8_t* end = file->map + file->size;
+    const uint8_t* p = file->map + offset;
+    const uint8_t* first;
+    const uint8_t* frame_gap = 0;
+    uint8_t level;
+    uint32_t duration;
+
+    if(p <= file->records)
+        return file->records;
+    if(p >= end)
+        return end;
+    while(p < end && (p[-1] & 0x80U))
+        p++;
+
+    first = p;
+    while(p < end && (size_t)(p - first) < SPLIT_SCAN_BYTES)
+    {
+        const uint8_t* record = p;
+        if(IR_trace_decode(&p, end, &level, &duration) != IR_SUCCESS)
+            return end;
+        if(level == IR_HIGH && duration >= file->split)
+            return record;
+        if(level == IR_HIGH && duration >= file->split_frame && !frame_gap)
+            frame_gap = record;
+    }
+    if(p >= end)
+        return end;
+    return frame_gap ? frame_gap : first;
+}
+
+static int add_frame(Segment_t* segment, uint64_t time_us, const IR_Data_t* data)
+{
+    if(segment->count == segment->capacity)
+    {
+        size_t capacity = segment->capacity ? segment->capacity * 2U : 256U;
+        Frame_t* frames = realloc(segment->frames, capacity * sizeof(Frame_t));
+        if(!frames)
+            return 0;
+        segment->frames = frames;
+        segment->capacity = capacity;
+    }
+    segment->frames[segment->count].time_us = time_us;
+    segment->frames[segment->count].data = *data;
+    segment->count++;
+    return 1;
+}
+
+// One decoder per segment, started fresh at its split point
+static void replay_segment(Segment_t* segment, int protocol, int keep_frames)
+{
+    const Trace_File_t* file = segment->file;
+    const uint8_t* p = split_point(file, segment->offset);
+    const uint8_t* stop = split_point(file, segment->offset + SEGMENT_BYTES);
+    const uint8_t* end = file->map + file->size;
+    IR_Decoder_t decoder;
+    IR_HAL_t none;
+    IR_Data_t data;
+    uint64_t digest = 0xCBF29CE484222325ULL;
+    uint8_t level;
+    uint32_t duration;
+
+    // Durations are fed straight in: no timer or pin is used
+    memset(&none, 0, sizeof(none));
+    IR_decoder_init(&decoder, (IR_Protocol_t)protocol, &none);
+
+    while(p < stop)
+    {
+        if(IR_trace_decode(&p, end, &level, &duration) != IR_SUCCESS)
+        {
+            segment->error = p;
+            break;
+        }
+
+        uint64_t us = to_us(duration, file->unit_ns);
+        segment->time_us += us;
+        segment->records++;
+        IR_decoder_process_duration(&decoder, level, (us > IR_TICKS_MAX_US) ? 0xFFFFU : IR_US_TO_TICKS(us));
+
+        if(decoder.decoded_data.valid && IR_decoder_get_data(&decoder, &data) == IR_SUCCESS)
+        {
+            segment->frames_decoded++;
+            if(data.flags & IR_DATA_FLAG_REPEAT)
+                segment->repeats++;
+            digest = fnv_add(digest, segment->time_us, 8U);
+            digest = fnv_add(digest, data.raw_data, 4U);
+            digest = fnv_add(digest, ((uint32_t)data.protocol << 8) | data.flags, 2U);
+            if(keep_frames && !add_frame(segment, segment->time_us, &data))
+                keep_frames = 0;
+        }
+    }
+    segment->digest = digest;
+}
+
+// Next segment for worker index: its own range first, then half of the
+// largest range left
+static int take_segment(Replay_t* replay, unsigned index, size_t* segment)
+{
+    Worker_Queue_t* own = &replay->queues[index];
+
+    for(;;)
+    {
+        pthread_mutex_lock(&own->lock);
+        if(own->next < own->end)
+        {
+            *segment = own->next++;
+            pthread_mutex_unlock(&own->lock);
+            return 1;
+        }
+        pthread_mutex_unlock(&own->lock);
+
+        unsigned victim = index;
+        size_t most = 0;
+        for(unsigned i = 0; i < replay->threads; i++)
+        {
+            Worker_Queue_t* queue = &replay->queues[i];
+            pthread_mutex_lock(&queue->lock);
+            size_t left = queue->end - queue->next;
+            pthread_mutex_unlock(&queue->lock);
+            if(i != index && left > most)
+            {
+                most = left;
+                victim = i;
+            }
+        }
+        if(victim == index)
+            return 0;
+
+        // Recheck under the victim's lock: its owner may have drained it
+        Worker_Queue_t* queue = &replay->queues[victim];
+        size_t begin = 0, end = 0;
+        pthread_mutex_lock(&queue->lock);
+        if(queue->next < queue->end)
+        {
+            size_t half = (queue->end - queue->next + 1U) / 2U;
+            end = queue->end;
+            begin = end - half;
+            queue->end = begin;
+        }
+        pthread_mutex_unlock(&queue->lock);
+
+        if(begin < end)
+        {
+            pthread_mutex_lock(&own->lock);
+            own->next = begin;
+            own->end = end;
+            pthread_mutex_unlock(&own->lock);
+        }
+    }
+}
+
+static void* replay_worker(void* argument)
+{
+    Worker_t* worker = argument;
+    Replay_t* replay = worker->replay;
+    size_t segment;
+
+    while(take_segment(replay, worker->index, &segment))
+    {
+        replay_segment(&replay->segments[segment], replay->protocol, replay->keep_frames);
+    }
+    return 0;
+}
+
+static void replay_all(Replay_t* replay, size_t count)
+{
+    pthread_t pool[MAX_THREADS];
+    Worker_t workers[MAX_THREADS];
+    unsigned threads = replay->threads;
+    unsigned started = threads;
+
+    // Contiguous ranges, so a worker walks through one part of a file
+    for(unsigned i = 0; i < threads; i++)
+    {
+        pthread_mutex_init(&replay->queues[i].lock, 0);
+        replay->queues[i].next = count * i / threads;
+        replay->queues[i].end = count * (i + 1U) / threads;
+        workers[i].replay = replay;
+        workers[i].index = i;
+    }
+
+    for(unsigned i = 1; i < threads; i++)
+    {
+        if(pthread_create(&pool[i], 0, replay_worker, &workers[i]) != 0)
+        {
+            started = i;
+            break;
+        }
+    }
+
+    // The worker count stays as published: ranges of workers that did not
+    // start are stolen like any other, and this thread also drains them
+    replay_worker(&workers[0]);
+    for(unsigned i = started; i < threads; i++)
+    {
+        replay_worker(&workers[i]);
+    }
+    for(unsigned i = 1; i < started; i++)
+    {
+        pthread_join(pool[i], 0);
+    }
+
+    for(unsigned i = 0; i < threads; i++)
+    {
+        pthread_mutex_destroy(&replay->queues[i].lock);
+    }
+}
+
+static int replay(char** paths, int count, int protocol, unsigned threads, int quiet)
+{
+    Trace_File_t* files = calloc((size_t)count, sizeof(Trace_File_t));
+    Segment_t* segments = 0;
+    size_t segment_count = 0;
+    Replay_t replay;
+    int status = 0;
+
+    if(!files)
+        return 1;
+
+    // Segments in file order, then offset order: the merge order
+    for(int i = 0; i < count; i++)
+    {
+        Trace_File_t* file = &files[i];
+        file->path = paths[i];
+        file->records = map_trace(paths[i], &file->size, &file->map, &file->unit_ns);
+        if(!file->records)
+        {
+            status = 1;
+            continue;
+        }
+        file->split = (uint32_t)(((uint64_t)SPLIT_GAP_US * 1000U + file->unit_ns - 1U) / file->unit_ns);
+        file->split_frame = (uint32_t)(((uint64_t)SPLIT_FRAME_GAP_US * 1000U + file->unit_ns - 1U) / file->unit_ns);
+        segment_count += (file->size + SEGMENT_BYTES - 1U) / SEGMENT_BYTES;
+    }
+
+    segments = calloc(segment_count ? segment_count : 1U, sizeof(Segment_t));
+    if(!segments)
+    {
+        free(files);
+        return 1;
+    }
+    segment_count = 0;
+    for(int i = 0; i < count; i++)
+    {
+        for(size_t offset = 0; files[i].records && offset < files[i].size; offset += SEGMENT_BYTES)
+        {
+            segments[segment_count].file = &files[i];
+            segments[segment_count].offset = offset;
+            segment_count++;
+        }
+    }
+
+    if(threads > segment_count)
+        threads = segment_count ? (unsigned)segment_count : 1U;
+    replay.segments = segments;
+    replay.queues = calloc(threads, sizeof(Worker_Queue_t));
+    replay.threads = threads;
+    replay.protocol = protocol;
+    replay.keep_frames = !quiet;
+    if(!replay.queues)
+    {
+        free(segments);
+        free(files);
+        return 1;
+    }
+
+    double start = seconds_now();
+    replay_all(&replay, segment_count);
+    double elapsed = seconds_now() - start;
+
+    // Merge: segment times become file times, digests chain in order
+    unsigned long long records = 0;
+    unsigned long frames = 0, repeats = 0;
+    uint64_t digest = 0xCBF29CE484222325ULL;
+    uint64_t total_us = 0;
+    size_t bytes = 0;
+    const Trace_File_t* file = 0;
+    uint64_t file_us = 0;
+
+    if(!quiet)
+        setvbuf(stdout, 0, _IOFBF, OUTPUT_BUFFER_SIZE);
+    for(size_t s = 0; s < segment_count; s++)
+    {
+        Segment_t* segment = &segments[s];
+        if(segment->file != file)
+        {
+            file = segment->file;
+            file_us = 0;
+            bytes += file->size;
+        }
+
+        for(size_t f = 0; f < segment->count; f++)
+        {
+            const IR_Data_t* data = &segment->frames[f].data;
+            if(count > 1)
+                printf("%s: ", file->path);
+            printf("%llu %s addr=0x%02X cmd=0x%02X raw=0x%08lX%s\n", (unsigned long long)(file_us + segment->frames[f].time_us),
+                   IR_get_protocol_name((IR_Protocol_t)data->protocol), data->address, data->command,
+                   (unsigned long)data->raw_data, (data->flags & IR_DATA_FLAG_REPEAT) ? " REPEAT" : "");
+        }
+        if(!quiet && segment->count < segment->frames_decoded)
+        {
+            fprintf(stderr, "%s: out of memory, frames missing\n", file->path);
+            status = 1;
+        }
+        if(segment->error)
+        {
+            fprintf(stderr, "%s: truncated record at offset %lu\n", file->path, (unsigned long)(segment->error - file->map));
+            status = 1;
+        }
+
+        records += segment->records;
+        frames += segment->frames_decoded;
+        repeats += segment->repeats;
+        digest = fnv_add(digest, segment->digest, 8U);
+        file_us += segment->time_us;
+        total_us += segment->time_us;
+        free(segment->frames);
+    }
+    if(!quiet)
+        fflush(stdout);
+
+    if(elapsed <= 0.0)
+        elapsed = 1e-9;
+    fprintf(stderr, "%llu records, %lu frames (%lu repeats), digest %016llx\n"
+                    "%.1f s of signal in %.3f s on %u threads (%lu segments): %.1f Mrecords/s, %.1f MB/s\n",
+            records, frames, repeats, (unsigned long long)digest,
+            (double)total_us * 1e-6, elapsed, threads, (unsigned long)segment_count,
+            (double)records / elapsed * 1e-6, (double)bytes / elapsed * 1e-6);
+
+    for(int i = 0; i < count; i++)
+    {
+        if(files[i].records)
+            munmap((void*)files[i].map, files[i].size);
+    }
+    free(replay.queues);
+    free(segments);
+    free(files);
+    return status;
+}
+
+static int usage(void)
+{
+    fputs("usage: ir_trace write [-o trace.irt] [mode2.txt]\n"
+          "       ir_trace gen [-n frames] [-s seed] -o trace.irt protocol [address]\n"
+          "       ir_trace dump trace.irt\n"
+          "       ir_trace replay [-p protocol] [-j threads] [-q] traces...\n", stderr);
+    return 2;
+}
+
+int main(int argc, char** argv)
+{
+    const char* output = 0;
+    unsigned long frames = 1000;
+    unsigned seed = 1;
+    int protocol = IR_PROTOCOL_NEC;
+    int quiet = 0;
+    unsigned threads = 0;
+    int first = 2;
+
+    if(argc < 2)
+        return usage();
+
+    while(first < argc && argv[first][0] == '-' && argv[first][1] != '\0')
+    {
+        if(!strcmp(argv[first], "-q"))
+        {
+            quiet = 1;
+            first++;
+            continue;
+        }
+        if(first + 1 >= argc)
+            return usage();
+        if(!strcmp(argv[first], "-o"))
+            output = argv[first + 1];
+        else if(!strcmp(argv[first], "-n"))
+            frames = strtoul(argv[first + 1], 0, 0);
+        else if(!strcmp(argv[first], "-j"))
+            threads = (unsigned)strtoul(argv[first + 1], 0, 0);
+        else if(!strcmp(argv[first], "-s"))
+            seed = (unsigned)strtoul(argv[first + 1], 0, 0);
+        else if(!strcmp(argv[first], "-p") && (protocol = protocol_from_name(argv[first + 1])) < 0)
+            return usage();
+        else if(strcmp(argv[first], "-p") != 0)
+            return usage();
+        first += 2;
+    }
+
+    if(!strcmp(argv[1], "write") && argc - first <= 1)
+        return write_mode2(first < argc ? argv[first] : 0, output);
+    if(!strcmp(argv[1], "gen") && output && (argc - first == 1 || argc - first == 2))
+    {
+        if((protocol = protocol_from_name(argv[first])) < 0)
+            return usage();
+        return generate(output, protocol, (uint16_t)(first + 1 < argc ? strtoul(argv[first + 1], 0, 0) : 0), frames, seed);
+    }
+    if(!strcmp(argv[1], "dump") && argc - first == 1)
+        return dump(argv[first]);
+    if(strcmp(argv[1], "replay") != 0 || first >= argc)
+        return usage();
+
+    if(threads == 0U)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (unsigned)online : 1U;
+    }
+    if(threads > MAX_THREADS)
+        threads = MAX_THREADS;
+    return replay(argv + first, argc - first, protocol, threads, quiet);
+}
@@ -0,0 +1,232 @@
+/**
+ * test_decoder.c - Host Test for the Decoder Glitch Filter
+ *
+ * Built with IR_DECODER_GLITCH_TICKS=4: an NEC frame decodes with a spike
+ * put inside any of its marks or spaces, both edges of the spike dropped and
+ * counted once; edges a full glitch width apart are kept; the stop edge is
+ * decoded once the timeout handler or IR_decoder_expire() shows nothing
+ * follows it.
+ * Author: Nghia Taarabt
+ */
+
+#include <string.h>
+#include "ir_decoder.h"
+#include "ir_test.h"
+
+#define SPIKE_TICKS         (IR_DECODER_GLITCH_TICKS / 2U)
+#define EDGE_CAPACITY       (80U)
+
+typedef struct {
+    uint8_t level;
+    uint16_t ticks;
+} Edge_t;
+
+static Edge_t frame[EDGE_CAPACITY];
+static uint8_t frame_count;
+static const uint32_t raw = 0xF708FB04UL;   // NEC address 0x04, command 0x08
+
+static void add_edge(Edge_t* edges, uint8_t* count, uint8_t level, uint16_t ticks)
+{
+    edges[*count].level = level;
+    edges[*count].ticks = ticks;
+    (*count)++;
+}
+
+// Leader, 32 bits and the stop burst, starting from a quiet line
+static void build_frame(void)
+{
+    frame_count = 0U;
+    add_edge(frame, &frame_count, IR_HIGH, 0xFFFFU);
+    add_edge(frame, &frame_count, IR_LOW, IR_US_TO_TICKS(9000U));
+    add_edge(frame, &frame_count, IR_HIGH, IR_US_TO_TICKS(4500U));
+    for(uint8_t bit = 0; bit < 32U; bit++)
+    {
+        add_edge(frame, &frame_count, IR_LOW, IR_US_TO_TICKS(562U));
+        add_edge(frame, &frame_count, IR_HIGH, IR_US_TO_TICKS(((raw >> bit) & 1U) ? 1687U : 562U));
+    }
+    add_edge(frame, &frame_count, IR_LOW, IR_US_TO_TICKS(562U));
+}
+
+static void init_decoder(IR_Decoder_t* decoder)
+{
+    IR_HAL_t none;
+
+    memset(&none, 0, sizeof(none));
+    IR_decoder_init(decoder, IR_PROTOCOL_NEC, &none);
+}
+
+static void feed(IR_Decoder_t* decoder, const Edge_t* edges, uint8_t count)
+{
+    for(uint8_t i = 0; i < count; i++)
+    {
+        IR_decoder_process_duration(decoder, edges[i].level, edges[i].ticks);
+    }
+}
+
+// Timeout handler calls at a steady rate until the held edge is decoded
+static void settle(IR_Decoder_t* decoder)
+{
+    for(uint8_t i = 0; i < 3U; i++)
+    {
+        IR_decoder_timeout_advance(decoder, IR_DECODER_GLITCH_TICKS);
+    }
+}
+
+static uint16_t glitches(IR_Decoder_t* decoder)
+{
+    IR_Decoder_Stats_t stats;
+
+    IR_decoder_get_stats(decoder, &stats);
+    return stats.glitches;
+}
+
+static void check_frame(IR_Decoder_t* decoder)
+{
+    IR_Data_t data;
+
+    IR_CHECK(IR_decoder_get_data(decoder, &data) == IR_SUCCESS);
+    IR_CHECK(data.raw_data == raw);
+    IR_CHECK(data.address == 0x04U && data.command == 0x08U);
+    IR_CHECK(!(data.flags & IR_DATA_FLAG_REPEAT));
+}
+
+static void test_clean(void)
+{
+    IR_Decoder_t decoder;
+    IR_Data_t data;
+
+    init_decoder(&decoder);
+    feed(&decoder, frame, frame_count);
+
+    // The stop edge waits for the interval after it
+    IR_CHECK(IR_decoder_get_data(&decoder, &data) == IR_ERROR);
+    IR_CHECK(!IR_decoder_is_idle(&decoder));
+    settle(&decoder);
+    check_frame(&decoder);
+    IR_CHECK(glitches(&decoder) == 0U);
+    IR_CHECK(IR_decoder_is_idle(&decoder));
+
+    // A quiet line expires the decoder, which decodes the held edge first
+    init_decoder(&decoder);
+    feed(&decoder, frame, frame_count);
+    IR_decoder_expire(&decoder);
+    check_frame(&decoder);
+}
+
+// A spike split off the middle of the interval ending at edge 'at': a short
+// mark inside a space when that edge is a mark start, a dropout inside a mark
+// when it is a mark end
+static uint8_t insert_spike(Edge_t* edges, uint8_t at, uint16_t width)
+{
+    uint8_t count = 0U;
+    uint8_t level = frame[at].level;
+    uint16_t first = (uint16_t)((frame[at].ticks - width) / 2U);
+
+    for(uint8_t i = 0; i < frame_count; i++)
+    {
+        if(i == at)
+        {
+            add_edge(edges, &count, level, first);
+            add_edge(edges, &count, (uint8_t)!level, width);
+            add_edge(edges, &count, level, (uint16_t)(frame[at].ticks - first - width));
+        }
+        else
+        {
+            add_edge(edges, &count, frame[i].level, frame[i].ticks);
+        }
+    }
+    return count;
+}
+
+static void test_spikes(void)
+{
+    Edge_t edges[EDGE_CAPACITY + 4U];
+
+    for(uint8_t at = 1; at < frame_count; at++)
+    {
+        IR_Decoder_t decoder;
+        uint8_t count = insert_spike(edges, at, SPIKE_TICKS);
+
+        init_decoder(&decoder);
+        feed(&decoder, edges, count);
+        settle(&decoder);
+        check_frame(&decoder);
+        IR_CHECK(glitches(&decoder) == 1U);
+    }
+
+    // A one-tick spike in a space and another in the next mark
+    IR_Decoder_t decoder;
+    uint8_t count = insert_spike(edges, 10U, 1U);
+    Edge_t second[EDGE_CAPACITY + 4U];
+    memcpy(second, edges, sizeof(Edge_t) * 10U);
+    uint8_t n = 10U;
+    for(uint8_t i = 10; i < count; i++)
+    {
+        if(i == 13U)
+        {
+            uint16_t first = (uint16_t)(edges[i].ticks / 3U);
+            add_edge(second, &n, edges[i].level, first);
+            add_edge(second, &n, (uint8_t)!edges[i].level, 1U);
+            add_edge(second, &n, edges[i].level, (uint16_t)(edges[i].ticks - first - 1U));
+        }
+        else
+        {
+            add_edge(second, &n, edges[i].level, edges[i].ticks);
+        }
+    }
+    init_decoder(&decoder);
+    feed(&decoder, second, n);
+    settle(&decoder);
+    check_frame(&decoder);
+    IR_CHECK(glitches(&decoder) == 2U);
+}
+
+// Edges a full glitch width apart are real: the short mark splits the space
+static void test_not_a_glitch(void)
+{
+    Edge_t edges[EDGE_CAPACITY + 4U];
+    IR_Decoder_t decoder;
+    IR_Data_t data;
+
+    init_decoder(&decoder);
+    feed(&decoder, edges, insert_spike(edges, 4U, IR_DECODER_GLITCH_TICKS));
+    settle(&decoder);
+    IR_CHECK(glitches(&decoder) == 0U);
+    IR_CHECK(IR_decoder_get_data(&decoder, &data) == IR_ERROR || data.raw_data != raw);
+}
+
+// A repeat code with a spike in its space still repeats the frame
+static void test_repeat(void)
+{
+    static const Edge_t repeat[] = {
+        { IR_HIGH, IR_US_TO_TICKS(40000U) },
+        { IR_LOW, IR_US_TO_TICKS(9000U) },
+        { IR_HIGH, IR_US_TO_TICKS(1000U) },
+        { IR_LOW, SPIKE_TICKS },
+        { IR_HIGH, IR_US_TO_TICKS(1250U) - SPIKE_TICKS },
+        { IR_LOW, IR_US_TO_TICKS(562U) },
+    };
+    IR_Decoder_t decoder;
+    IR_Data_t data;
+
+    init_decoder(&decoder);
+    feed(&decoder, frame, frame_count);
+    settle(&decoder);
+    check_frame(&decoder);
+
+    feed(&decoder, repeat, sizeof(repeat) / sizeof(repeat[0]));
+    settle(&decoder);
+    IR_CHECK(IR_decoder_get_data(&decoder, &data) == IR_SUCCESS);
+    IR_CHECK(data.flags & IR_DATA_FLAG_REPEAT);
+    IR_CHECK(glitches(&decoder) == 1U);
+}
+
+int main(void)
+{
+    build_frame();
+    test_clean();
+    test_spikes();
+    test_not_a_glitch();
+    test_repeat();
+    return IR_test_result("decoder");
+}
@@ -0,0 +1,301 @@
+/**
+ * test_index.c - Host Test for the LIRC/Flipper Code Database Indexer
+ *
+ * Builds ir_index.c with its main() renamed and runs it on a small corpus
+ * written to a temporary directory: LIRC SPACE_ENC remotes, Flipper parsed
+ * and raw signals. NEC-32 codes normalize to the right address and
+ * command, a 48-bit code behind an NEC leader stays undecoded, the index is
+ * the same for any thread count, and lookups return the device and button
+ * names of every code with the key and nothing for keys not indexed.
+ * Author: Nghia Taarabt
+ */
+
+#define main ir_index_main
+#include "ir_index.c"
+#undef main
+
+#include "ir_test.h"
+
+#define CORPUS_FILES        (4U)
+
+static char directory[] = "/tmp/test_index.XXXXXX";
+static char paths[CORPUS_FILES][64];
+static char index_path[2][64];
+static Scratch_t scratch;
+
+// LIRC, NEC as sent MSB first: 0x20DF10EF is address 0x04, command 0x08
+static const char tv_conf[] =
+    "# NEC-32 remote\n"
+    "begin remote\n"
+    "  name  TV\n"
+    "  bits           16\n"
+    "  flags SPACE_ENC|CONST_LENGTH\n"
+    "  header       9000  4500\n"
+    "  one           562  1687\n"
+    "  zero          562   562\n"
+    "  ptrail        562\n"
+    "  pre_data_bits   16\n"
+    "  pre_data       0x20DF\n"
+    "  frequency    38000\n"
+    "      begin codes\n"
+    "          KEY_POWER                0x10EF\n"
+    "          KEY_MUTE                 0x906F\n"
+    "      end codes\n"
+    "end remote\n";
+
+// 48 bits behind an NEC leader; the first 32 would read as command 0x11
+static const char amp_conf[] =
+    "begin remote\n"
+    "  name  AMP\n"
+    "  bits           32\n"
+    "  flags SPACE_ENC\n"
+    "  header       9000  4500\n"
+    "  one           562  1687\n"
+    "  zero          562   562\n"
+    "  ptrail        562\n"
+    "  pre_data_bits   16\n"
+    "  pre_data       0x20DF\n"
+    "      begin codes\n"
+    "          KEY_LONG                 0x887712ED\n"
+    "      end codes\n"
+    "end remote\n";
+
+// Flipper parsed signal for the TV's power code
+static const char living_room_ir[] =
+    "Filetype: IR signals file\n"
+    "Version: 1\n"
+    "#\n"
+    "name: Power\n"
+    "type: parsed\n"
+    "protocol: NEC\n"
+    "address: 04 00 00 00\n"
+    "command: 08 00 00 00\n";
+
+// NEC frame as marks and spaces (us), as learned
+static size_t nec_timings(char* text, size_t size, uint8_t address, uint8_t command)
+{
+    uint32_t raw = IR_encode_nec_data(address, command);
+    size_t length = (size_t)snprintf(text, size, "9000 4500");
+
+    for(uint8_t bit = 0; bit < 32U; bit++)
+    {
+        length += (size_t)snprintf(text + length, size - length, " 562 %u", ((raw >> bit) & 1U) ? 1687U : 562U);
+    }
+    length += (size_t)snprintf(text + length, size - length, " 562");
+    return length;
+}
+
+static void write_file(const char* path, const char* text)
+{
+    FILE* file = fopen(path, "w");
+
+    IR_CHECK(file != 0);
+    if(!file)
+        return;
+    fputs(text, file);
+    fclose(file);
+}
+
+static void write_corpus(void)
+{
+    static char text[2048];
+    char timings[512];
+    size_t length;
+
+    snprintf(paths[0], sizeof(paths[0]), "%s/tv.conf", directory);
+    snprintf(paths[1], sizeof(paths[1]), "%s/amp.conf", directory);
+    snprintf(paths[2], sizeof(paths[2]), "%s/living_room.ir", directory);
+    snprintf(paths[3], sizeof(paths[3]), "%s/learned.ir", directory);
+    write_file(paths[0], tv_conf);
+    write_file(paths[1], amp_conf);
+    write_file(paths[2], living_room_ir);
+
+    // A learned NEC frame, then a raw signal too short to be anything
+    nec_timings(timings, sizeof(timings), 0x07U, 0x02U);
+    length = (size_t)snprintf(text, sizeof(text),
+                              "Filetype: IR signals file\nVersion: 1\n"
+                              "name: Vol_up\ntype: raw\nfrequency: 38000\nduty_cycle: 0.330000\ndata: %s\n"
+                              "name: Noise\ntype: raw\nfrequency: 38000\nduty_cycle: 0.330000\ndata: 300 300 300\n",
+                              timings);
+    IR_CHECK(length < sizeof(text));
+    write_file(paths[3], text);
+}
+
+static const Entry* find_entry(const File_Result_t* result, const char* button)
+{
+    for(size_t i = 0; i < result->count; i++)
+    {
+        if(!strcmp(result->strings + result->entries[i].button, button))
+            return &result->entries[i];
+    }
+    return 0;
+}
+
+static void check_code(const File_Result_t* result, const char* device, const char* button,
+                       uint16_t address, uint16_t command)
+{
+    const Entry* entry = find_entry(result, button);
+
+    IR_CHECK(entry != 0);
+    if(!entry)
+        return;
+    IR_CHECK(entry->protocol == IR_PROTOCOL_NEC);
+    IR_CHECK(entry->address == address && entry->command == command);
+    IR_CHECK(!strcmp(result->strings + entry->device, device));
+}
+
+static void free_results(File_Result_t* results, size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        free(results[i].entries);
+        free(results[i].strings);
+    }
+}
+
+static void test_parse(void)
+{
+    File_Result_t results[CORPUS_FILES];
+
+    memset(results, 0, sizeof(results));
+    for(size_t i = 0; i < CORPUS_FILES; i++)
+    {
+        results[i].path = paths[i];
+        parse_file(&results[i], &scratch);
+        IR_CHECK(results[i].error == 0);
+    }
+
+    // LIRC SPACE_ENC: rendered, decoded as NEC-32
+    IR_CHECK(results[0].count == 2U && results[0].raw_decoded == 2U);
+    check_code(&results[0], "TV", "KEY_POWER", 0x04U, 0x08U);
+    check_code(&results[0], "TV", "KEY_MUTE", 0x04U, 0x09U);
+
+    // 48 bits: the NEC decoder stops after 32, but the frame is longer
+    const Entry* entry = find_entry(&results[1], "KEY_LONG");
+    IR_CHECK(entry != 0 && entry->protocol == IR_PROTOCOL_COUNT);
+    IR_CHECK(results[1].raw_decoded == 0U && results[1].undecoded == 1U);
+
+    // Flipper: device named after the file
+    IR_CHECK(results[2].count == 1U);
+    check_code(&results[2], "living_room", "Power", 0x04U, 0x08U);
+    check_code(&results[3], "learned", "Vol_up", 0x07U, 0x02U);
+    IR_CHECK(results[3].raw_decoded == 1U && results[3].undecoded == 1U);
+    entry = find_entry(&results[3], "Noise");
+    IR_CHECK(entry != 0 && entry->protocol == IR_PROTOCOL_COUNT && entry->durations == 3U);
+
+    free_results(results, CORPUS_FILES);
+}
+
+static int build(const char* path, unsigned threads, size_t* written)
+{
+    File_Result_t results[CORPUS_FILES];
+    int status;
+
+    memset(results, 0, sizeof(results));
+    for(size_t i = 0; i < CORPUS_FILES; i++)
+    {
+        results[i].path = paths[i];
+    }
+    parse_all(results, CORPUS_FILES, threads);
+    status = write_index(path, results, CORPUS_FILES, written);
+    free_results(results, CORPUS_FILES);
+    return status;
+}
+
+static size_t read_all(const char* path, char* data, size_t size)
+{
+    FILE* file = fopen(path, "rb");
+    size_t length;
+
+    if(!file)
+        return 0;
+    length = fread(data, 1, size, file);
+    fclose(file);
+    return length;
+}
+
+// lookup() prints its matches: run it with stdout in a file
+static int run_lookup(uint16_t address, uint16_t command, char* output, size_t size)
+{
+    char path[80];
+    int saved;
+    int fd;
+    int status;
+
+    snprintf(path, sizeof(path), "%s/lookup.txt", directory);
+    fflush(stdout);
+    saved = dup(1);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if(saved < 0 || fd < 0)
+    {
+        IR_CHECK(0);
+        return -1;
+    }
+    dup2(fd, 1);
+    close(fd);
+    status = lookup(index_path[0], IR_PROTOCOL_NEC, address, command);
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+
+    size_t length = read_all(path, output, size - 1U);
+    output[length] = '\0';
+    unlink(path);
+    return status;
+}
+
+static void test_index(void)
+{
+    static char first[4096];
+    static char second[4096];
+    char output[256];
+    size_t written[2];
+
+    snprintf(index_path[0], sizeof(index_path[0]), "%s/codes.irx", directory);
+    snprintf(index_path[1], sizeof(index_path[1]), "%s/codes_j4.irx", directory);
+    IR_CHECK(build(index_path[0], 1U, &written[0]) == 0);
+    IR_CHECK(build(index_path[1], 4U, &written[1]) == 0);
+
+    // Four decoded codes, the undecoded ones left out; any thread count
+    IR_CHECK(written[0] == 4U && written[1] == 4U);
+    size_t length = read_all(index_path[0], first, sizeof(first));
+    IR_CHECK(length > INDEX_HEADER_SIZE + 4U * INDEX_ENTRY_SIZE);
+    IR_CHECK(read_all(index_path[1], second, sizeof(second)) == length);
+    IR_CHECK(memcmp(first, second, length) == 0);
+
+    // Every name of a key, in device order
+    IR_CHECK(run_lookup(0x04U, 0x08U, output, sizeof(output)) == 0);
+    IR_CHECK(!strcmp(output, "TV\tKEY_POWER\nliving_room\tPower\n"));
+    IR_CHECK(run_lookup(0x04U, 0x09U, output, sizeof(output)) == 0);
+    IR_CHECK(!strcmp(output, "TV\tKEY_MUTE\n"));
+    IR_CHECK(run_lookup(0x07U, 0x02U, output, sizeof(output)) == 0);
+    IR_CHECK(!strcmp(output, "learned\tVol_up\n"));
+
+    // The 48-bit code's first 32 bits were not indexed as NEC
+    IR_CHECK(run_lookup(0x04U, 0x11U, output, sizeof(output)) == 1);
+    IR_CHECK(output[0] == '\0');
+    IR_CHECK(run_lookup(0x05U, 0x08U, output, sizeof(output)) == 1);
+
+    unlink(index_path[0]);
+    unlink(index_path[1]);
+}
+
+int main(void)
+{
+    if(!mkdtemp(directory))
+    {
+        perror(directory);
+        return 1;
+    }
+
+    write_corpus();
+    test_parse();
+    test_index();
+
+    for(size_t i = 0; i < CORPUS_FILES; i++)
+    {
+        unlink(paths[i]);
+    }
+    rmdir(directory);
+    return IR_test_result("index");
+}
@@ -0,0 +1,367 @@
+/**
+ * test_link.c - Host Test for the IR Data Link
+ *
+ * Two ir_link.h endpoints on simulated time, as in ir_link_sim, with the
+ * timeout advanced in ATTiny13-sized steps:
+ *   - both ends send numbered payloads while whole frames are dropped or
+ *     have one data space misread; every payload arrives intact, in order
+ *     and once, unless its sender reported IR_LINK_TX_FAILED
+ *   - a silent peer ends in IR_LINK_TX_FAILED after IR_LINK_MAX_TRIES
+ *     transmissions spaced by the ACK timeout
+ *   - a restarted sender's first frame is delivered though its header
+ *     matches the last frame received
+ *   - a broken-off frame is abandoned after the idle time of its coding
+ * Author: Nghia Taarabt
+ */
+
+#include <string.h>
+#include "ir_link.h"
+#include "ir_test.h"
+
+#define SIM_LOOP_US         (1000U)                 // Main loop period
+#define SIM_TIME_LIMIT_US   (600ULL * 1000000ULL)
+#define LOSSY_PAYLOADS      (120U)                  // Payloads per direction
+#define MAX_STARTS          (16U)
+
+typedef struct {
+    IR_Link_t link;
+    unsigned long long last_edge_us;    // Last edge delivered to this end's receiver
+    unsigned long long last_sent_us;    // Last edge this end transmitted
+    uint8_t frame_dropped;              // Frame on air is not delivered
+    uint8_t frame_corrupt;              // Mark start that ends the misread space, 0: none
+    uint8_t frame_marks;
+    unsigned long long starts[MAX_STARTS];
+    uint8_t start_count;
+} Sim_End_t;
+
+static Sim_End_t ends[2];
+static unsigned long long sim_now_us;
+static unsigned long long sim_ticks;
+static uint8_t sim_lossy;
+static unsigned drop_percent;
+static unsigned corrupt_percent;
+static unsigned long long rng_state = 0x9E3779B97F4A7C15ULL;
+
+static unsigned long long sim_random(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static void sim_advance(unsigned long long us)
+{
+    sim_now_us += us;
+
+    // Timer interrupts, no more than one ATTiny13 overflow at a time
+    unsigned long long ticks = (sim_now_us * 5ULL) >> 6;
+    while(sim_ticks < ticks)
+    {
+        unsigned long long step = ticks - sim_ticks;
+        if(step > IR_LINK_TIMEOUT_STEP_TICKS)
+            step = IR_LINK_TIMEOUT_STEP_TICKS;
+        sim_ticks += step;
+        IR_link_timeout_advance(&ends[0].link, (uint16_t)step);
+        IR_link_timeout_advance(&ends[1].link, (uint16_t)step);
+    }
+}
+
+static void sim_edge(int from, uint8_t level)
+{
+    Sim_End_t* end = &ends[from];
+    Sim_End_t* peer = &ends[1 - from];
+    const unsigned long long unit = end->link.unit_us;
+
+    // A mark after more than a leader's worth of silence starts a frame
+    if(level == IR_HIGH && (end->start_count == 0U || sim_now_us - end->last_sent_us > 8U * unit))
+    {
+        end->frame_marks = 0U;
+        end->frame_dropped = 0U;
+        end->frame_corrupt = 0U;
+        if(end->start_count < MAX_STARTS)
+            end->starts[end->start_count] = sim_now_us;
+        end->start_count++;
+
+        if(sim_lossy)
+        {
+            if(sim_random() % 100U < drop_percent)
+                end->frame_dropped = 1U;
+            else if(sim_random() % 100U < corrupt_percent)
+                end->frame_corrupt = (uint8_t)(3U + sim_random() % 16U);
+        }
+    }
+    end->last_sent_us = sim_now_us;
+    if(level == IR_HIGH)
+        end->frame_marks++;
+
+    if(end->frame_dropped)
+        return;
+
+    long long us = (long long)(sim_now_us - peer->last_edge_us);
+    peer->last_edge_us = sim_now_us;
+
+    // Misread one data space as the neighbouring bit or symbol value
+    if(level == IR_HIGH && end->frame_marks == end->frame_corrupt)
+        us += (us < (long long)(2U * unit)) ? (long long)(2U * unit) : -(long long)unit;
+
+    if(us > (long long)IR_TICKS_MAX_US)
+        us = (long long)IR_TICKS_MAX_US;
+    IR_link_process_duration(&peer->link, level, IR_US_TO_TICKS(us));
+}
+
+static void sim_a_carrier_on(void)  { sim_edge(0, IR_HIGH); }
+static void sim_a_carrier_off(void) { sim_edge(0, IR_LOW); }
+static void sim_b_carrier_on(void)  { sim_edge(1, IR_HIGH); }
+static void sim_b_carrier_off(void) { sim_edge(1, IR_LOW); }
+static void sim_delay_us(uint16_t us) { sim_advance(us); }
+static void sim_delay_ms(uint16_t ms) { sim_advance(ms * 1000ULL); }
+
+static void sim_init(IR_Protocol_t coding)
+{
+    memset(ends, 0, sizeof(ends));
+    sim_now_us = 0;
+    sim_ticks = 0;
+    sim_lossy = 0U;
+
+    for(int i = 0; i < 2; i++)
+    {
+        static IR_TX_HAL_t tx_hal[2] = {
+            { sim_a_carrier_on, sim_a_carrier_off, sim_delay_us, sim_delay_ms, 0 },
+            { sim_b_carrier_on, sim_b_carrier_off, sim_delay_us, sim_delay_ms, 0 },
+        };
+        IR_HAL_t hal = {0};
+
+        IR_link_init(&ends[i].link, &tx_hal[i], &hal);
+        IR_link_set_coding(&ends[i].link, coding);
+    }
+}
+
+// Payload n: its number, then bytes derived from it; 1..IR_LINK_MAX_PAYLOAD long
+static uint8_t make_payload(unsigned n, uint8_t* data)
+{
+    uint8_t length = (uint8_t)(2U + n % (IR_LINK_MAX_PAYLOAD - 1U));
+
+    data[0] = (uint8_t)n;
+    data[1] = (uint8_t)(n >> 8);
+    for(uint8_t i = 2; i < length; i++)
+    {
+        data[i] = (uint8_t)(n * 7U + i);
+    }
+    return length;
+}
+
+// Both ends send LOSSY_PAYLOADS to each other over a lossy line
+static void test_lossy_exchange(IR_Protocol_t coding)
+{
+    unsigned next_send[2] = {0, 0};
+    unsigned next_receive[2] = {0, 0};      // Lowest payload number still expected
+    unsigned sending[2] = {0, 0};
+    uint8_t failed[2][LOSSY_PAYLOADS];
+    unsigned long crc_errors = 0;
+    unsigned long duplicates = 0;
+
+    memset(failed, 0, sizeof(failed));
+    sim_init(coding);
+    drop_percent = 20U;
+    corrupt_percent = 20U;
+
+    while(sim_now_us < SIM_TIME_LIMIT_US)
+    {
+        uint8_t done = 1U;
+
+        // A lost ACK of a RESYNC frame may deliver it twice: lose nothing
+        // until both ends are past their first frame
+        sim_lossy = (ends[0].link.tx_flags == 0U && ends[1].link.tx_flags == 0U);
+
+        for(int i = 0; i < 2; i++)
+        {
+            IR_Link_t* link = &ends[i].link;
+
+            if(!IR_link_is_busy(link))
+            {
+                if(next_send[i] > 0U && IR_link_tx_status(link) == IR_LINK_TX_FAILED)
+                    failed[i][sending[i]] = 1U;
+                if(next_send[i] < LOSSY_PAYLOADS)
+                {
+                    uint8_t data[IR_LINK_MAX_PAYLOAD];
+                    uint8_t length = make_payload(next_send[i], data);
+
+                    IR_CHECK(IR_link_send(link, data, length) == IR_SUCCESS);
+                    IR_CHECK(IR_link_tx_status(link) == IR_LINK_TX_PENDING);
+                    sending[i] = next_send[i]++;
+                }
+            }
+            if(IR_link_is_busy(link) || next_send[i] < LOSSY_PAYLOADS)
+                done = 0U;
+
+            IR_link_service(link);
+        }
+
+        for(int i = 0; i < 2; i++)
+        {
+            uint8_t data[IR_LINK_MAX_PAYLOAD];
+            uint8_t expected[IR_LINK_MAX_PAYLOAD];
+            uint8_t length;
+
+            if(IR_link_receive(&ends[i].link, data, &length) != IR_SUCCESS)
+                continue;
+
+            // In order and once; payloads skipped were given up by the sender
+            unsigned n = data[0] | ((unsigned)data[1] << 8);
+            IR_CHECK(n >= next_receive[i] && n < LOSSY_PAYLOADS);
+            for(unsigned skipped = next_receive[i]; skipped < n && skipped < LOSSY_PAYLOADS; skipped++)
+            {
+                IR_CHECK(failed[1 - i][skipped]);
+            }
+            IR_CHECK(length == make_payload(n, expected));
+            IR_CHECK(memcmp(data, expected, length) == 0);
+            next_receive[i] = n + 1U;
+        }
+
+        if(done)
+            break;
+        sim_advance(SIM_LOOP_US);
+    }
+
+    IR_CHECK(sim_now_us < SIM_TIME_LIMIT_US);
+    for(int i = 0; i < 2; i++)
+    {
+        unsigned failures = 0;
+        for(unsigned n = 0; n < LOSSY_PAYLOADS; n++)
+        {
+            failures += failed[i][n];
+        }
+        IR_CHECK(failures == ends[i].link.stats.failures);
+        IR_CHECK(ends[1 - i].link.stats.frames_received + failures >= LOSSY_PAYLOADS);
+        crc_errors += ends[i].link.stats.crc_errors;
+        duplicates += ends[i].link.stats.duplicates;
+    }
+
+    // The loss reached the CRC check and the duplicate detection
+    IR_CHECK(crc_errors > 0U);
+    IR_CHECK(duplicates > 0U);
+}
+
+static void test_silent_peer(void)
+{
+    uint8_t data[4] = {1, 2, 3, 4};
+
+    sim_init(IR_PROTOCOL_NEC);
+    IR_CHECK(IR_link_tx_status(&ends[0].link) == IR_LINK_TX_IDLE);
+    IR_CHECK(IR_link_send(&ends[0].link, data, sizeof(data)) == IR_SUCCESS);
+    IR_CHECK(IR_link_send(&ends[0].link, data, sizeof(data)) == IR_ERROR);
+    IR_CHECK(IR_link_tx_status(&ends[0].link) == IR_LINK_TX_PENDING);
+
+    // B's main loop never runs: nothing is ACKed
+    while(IR_link_is_busy(&ends[0].link) && sim_now_us < SIM_TIME_LIMIT_US)
+    {
+        IR_link_service(&ends[0].link);
+        sim_advance(SIM_LOOP_US);
+    }
+
+    IR_CHECK(IR_link_tx_status(&ends[0].link) == IR_LINK_TX_FAILED);
+    IR_CHECK(ends[0].link.stats.failures == 1U);
+    IR_CHECK(ends[0].link.stats.frames_sent == 1U);
+    IR_CHECK(ends[0].link.stats.retransmits == IR_LINK_MAX_TRIES - 1U);
+    IR_CHECK(ends[0].start_count == IR_LINK_MAX_TRIES);
+    for(uint8_t i = 1; i < ends[0].start_count && i < MAX_STARTS; i++)
+    {
+        IR_CHECK(ends[0].starts[i] - ends[0].starts[i - 1] >= IR_LINK_ACK_TIMEOUT_US);
+    }
+
+    // With B listening, the next payload goes through
+    IR_CHECK(IR_link_send(&ends[0].link, data, sizeof(data)) == IR_SUCCESS);
+    while(IR_link_is_busy(&ends[0].link) && sim_now_us < SIM_TIME_LIMIT_US)
+    {
+        uint8_t received[IR_LINK_MAX_PAYLOAD];
+        uint8_t length;
+
+        IR_link_service(&ends[0].link);
+        IR_link_service(&ends[1].link);
+        IR_link_receive(&ends[1].link, received, &length);
+        sim_advance(SIM_LOOP_US);
+    }
+    IR_CHECK(IR_link_tx_status(&ends[0].link) == IR_LINK_TX_DELIVERED);
+}
+
+static void test_resync(void)
+{
+    uint8_t data[IR_LINK_MAX_PAYLOAD];
+    uint8_t length;
+
+    sim_init(IR_PROTOCOL_NEC);
+
+    for(unsigned n = 0; n < 2U; n++)
+    {
+        // A restarts before its second payload: same header as the first
+        if(n == 1U)
+        {
+            IR_TX_HAL_t tx_hal = ends[0].link.tx_hal;
+            IR_HAL_t hal = ends[0].link.hal;
+            IR_link_init(&ends[0].link, &tx_hal, &hal);
+        }
+
+        length = make_payload(n, data);
+        IR_CHECK(IR_link_send(&ends[0].link, data, length) == IR_SUCCESS);
+        while(IR_link_is_busy(&ends[0].link) && sim_now_us < SIM_TIME_LIMIT_US)
+        {
+            IR_link_service(&ends[0].link);
+            IR_link_service(&ends[1].link);
+            sim_advance(SIM_LOOP_US);
+        }
+        IR_CHECK(IR_link_tx_status(&ends[0].link) == IR_LINK_TX_DELIVERED);
+        IR_CHECK(IR_link_receive(&ends[1].link, data, &length) == IR_SUCCESS);
+        IR_CHECK(data[0] == n);
+    }
+    IR_CHECK(ends[1].link.stats.frames_received == 2U);
+    IR_CHECK(ends[1].link.stats.duplicates == 0U);
+}
+
+// Leader and two data marks, then silence in timer-overflow steps
+static uint16_t abandon_ticks(IR_Protocol_t coding)
+{
+    IR_Link_t* link = &ends[1].link;
+    uint16_t unit;
+    uint16_t quiet = 0U;
+
+    sim_init(coding);
+    unit = link->unit_ticks;
+    IR_link_process_duration(link, IR_HIGH, 0xFFFFU);
+    IR_link_process_duration(link, IR_LOW, (uint16_t)(8U * unit));
+    IR_link_process_duration(link, IR_HIGH, (uint16_t)(4U * unit));
+    IR_link_process_duration(link, IR_LOW, unit);
+    IR_link_process_duration(link, IR_HIGH, unit);
+    IR_CHECK(link->rx_state != IR_LINK_RX_IDLE);
+
+    while(link->rx_state != IR_LINK_RX_IDLE && quiet < 0xF000U)
+    {
+        IR_link_timeout_advance(link, IR_LINK_TIMEOUT_STEP_TICKS);
+        quiet += IR_LINK_TIMEOUT_STEP_TICKS;
+    }
+
+    // Never inside the longest gap of a frame, at most one step past the idle time
+    IR_CHECK(quiet > 8U * unit);
+    IR_CHECK(quiet <= IR_LINK_IDLE_UNITS * unit + 2U * IR_LINK_TIMEOUT_STEP_TICKS);
+    IR_CHECK(link->stats.line_errors == 1U);
+    return quiet;
+}
+
+static void test_idle(void)
+{
+    uint16_t nec = abandon_ticks(IR_PROTOCOL_NEC);
+    uint16_t ppm = abandon_ticks(IR_PROTOCOL_PPM);
+
+    // PPM frames end ~10x sooner, so a broken one blocks the link for less
+    IR_CHECK(ppm < nec);
+}
+
+int main(void)
+{
+    test_lossy_exchange(IR_PROTOCOL_NEC);
+    test_lossy_exchange(IR_PROTOCOL_PPM);
+    test_silent_peer();
+    test_resync();
+    test_idle();
+    return IR_test_result("link");
+}
@@ -0,0 +1,294 @@
+/**
+ * test_store.c - Host Test for the Persistent Learned-code Store
+ *
+ * Runs ir_store.c against RAM-backed EEPROM and flash models:
+ *   - puts and gets across many passes of the page ring, with the index
+ *     rebuilt by IR_store_init() after every pass
+ *   - EEPROM: no cell is programmed more than the records need (no clearing
+ *     pass), and a cell already holding its value is not programmed
+ *   - flash: programs only clear bits, and a deferred erase waits for
+ *     IR_store_erase_now()
+ *   - a reset after every possible number of byte programs leaves each slot
+ *     with its old or its new value
+ * Author: Nghia Taarabt
+ */
+
+#include <string.h>
+#include "ir_store.h"
+#include "ir_test.h"
+
+#define EEPROM_PAGE_SIZE    (IR_STORE_RECORD_SIZE)
+#define EEPROM_PAGE_COUNT   (7U)
+#define FLASH_PAGE_SIZE     (64U)
+#define FLASH_PAGE_COUNT    (3U)
+#define MEMORY_SIZE         (FLASH_PAGE_SIZE * FLASH_PAGE_COUNT)
+
+static uint8_t memory[MEMORY_SIZE];
+static unsigned long programs;              // Byte programs issued
+static unsigned long program_budget;        // Programs left before the simulated reset, 0: power lost
+static unsigned long flash_violations;      // Programs that needed a 0 bit set back to 1
+static unsigned long erases;
+static uint8_t flash_mode;
+
+static void mock_read(uint16_t address, uint8_t* data, uint16_t length)
+{
+    memcpy(data, &memory[address], length);
+}
+
+static void mock_program(uint16_t address, uint8_t value)
+{
+    if(program_budget == 0U)
+        return;
+    program_budget--;
+    programs++;
+
+    if(flash_mode)
+    {
+        if((memory[address] & value) != value)
+            flash_violations++;
+        memory[address] &= value;
+    }
+    else
+    {
+        memory[address] = value;
+    }
+}
+
+static void mock_erase(uint8_t page)
+{
+    // Power already lost: nothing reaches the storage
+    if(program_budget == 0U)
+        return;
+    erases++;
+    memset(&memory[page * FLASH_PAGE_SIZE], 0xFF, FLASH_PAGE_SIZE);
+}
+
+static uint8_t mock_busy(void)
+{
+    return 0U;
+}
+
+static IR_Store_HAL_t mock_hal(uint8_t flash, uint8_t deferred)
+{
+    IR_Store_HAL_t hal = {0};
+
+    flash_mode = flash;
+    hal.read = mock_read;
+    hal.program = mock_program;
+    hal.erase = flash ? mock_erase : 0;
+    hal.busy = mock_busy;
+    hal.page_size = flash ? FLASH_PAGE_SIZE : EEPROM_PAGE_SIZE;
+    hal.page_count = flash ? FLASH_PAGE_COUNT : EEPROM_PAGE_COUNT;
+    hal.erase_deferred = deferred;
+    return hal;
+}
+
+static void reset_memory(void)
+{
+    memset(memory, 0xFF, sizeof(memory));
+    programs = 0U;
+    program_budget = (unsigned long)-1;
+    flash_violations = 0U;
+    erases = 0U;
+}
+
+static IR_Data_t make_data(uint32_t value)
+{
+    IR_Data_t data = {0};
+
+    data.protocol = IR_PROTOCOL_NEC;
+    data.raw_data = IR_encode_nec_data((uint8_t)value, (uint8_t)(value >> 8));
+    return data;
+}
+
+// Run the service loop, starting deferred erases as the application would
+static void drain(IR_Store_t* store)
+{
+    for(;;)
+    {
+        IR_store_flush(store);
+        if(!IR_store_erase_pending(store))
+            break;
+        IR_store_erase_now(store);
+    }
+}
+
+static void check_slots(IR_Store_t* store, const uint32_t* expected)
+{
+    for(uint8_t slot = 0; slot < IR_STORE_SLOTS; slot++)
+    {
+        IR_Data_t data;
+        IR_Data_t want = make_data(expected[slot]);
+
+        IR_CHECK(IR_store_get(store, slot, &data) == IR_SUCCESS);
+        IR_CHECK(data.raw_data == want.raw_data);
+        IR_CHECK(data.protocol == IR_PROTOCOL_NEC);
+    }
+}
+
+static void test_wrap(uint8_t flash)
+{
+    IR_Store_t store;
+    IR_Store_HAL_t hal = mock_hal(flash, flash);
+    uint32_t expected[IR_STORE_SLOTS];
+
+    reset_memory();
+    IR_CHECK(IR_store_init(&store, &hal) == IR_SUCCESS);
+
+    for(uint8_t slot = 0; slot < IR_STORE_SLOTS; slot++)
+    {
+        IR_Data_t data;
+        IR_CHECK(IR_store_get(&store, slot, &data) == IR_ERROR);
+    }
+
+    // Enough puts for many passes over the ring; reload from storage often.
+    // Slot 0 is rewritten rarely, so reclaims must carry its record forward
+    for(uint32_t i = 0; i < 40U * store.record_count; i++)
+    {
+        uint8_t slot = (i % (3U * store.record_count) == 0U) ? 0U : (uint8_t)(1U + i % (IR_STORE_SLOTS - 1U));
+        IR_Data_t data = make_data(i);
+
+        expected[slot] = i;
+        IR_CHECK(IR_store_put(&store, slot, &data) == IR_SUCCESS);
+        drain(&store);
+
+        if(i >= IR_STORE_SLOTS - 1U && i % 5U == 0U)
+        {
+            check_slots(&store, expected);
+            IR_CHECK(IR_store_init(&store, &hal) == IR_SUCCESS);
+            drain(&store);
+            check_slots(&store, expected);
+        }
+    }
+
+    if(flash)
+    {
+        IR_CHECK(flash_violations == 0U);
+        IR_CHECK(erases > 0U);
+    }
+}
+
+static void test_eeprom_wear(void)
+{
+    IR_Store_t store;
+    IR_Store_HAL_t hal = mock_hal(0U, 0U);
+    const unsigned long puts = 10U * EEPROM_PAGE_COUNT;
+
+    reset_memory();
+    IR_store_init(&store, &hal);
+
+    // One slot: its only live record is never in the page being reclaimed,
+    // so every program belongs to a put. A clearing pass would double this
+    for(unsigned long i = 0; i < puts; i++)
+    {
+        IR_Data_t data = make_data(i);
+        IR_store_put(&store, 0U, &data);
+        drain(&store);
+    }
+    IR_CHECK(programs <= puts * IR_STORE_RECORD_SIZE);
+
+    // The same record again: slot, protocol and raw data bytes are unchanged
+    unsigned long before = programs;
+    IR_Data_t data = make_data(puts - 1U);
+    IR_store_put(&store, 0U, &data);
+    drain(&store);
+    IR_CHECK(programs - before < IR_STORE_RECORD_SIZE);
+}
+
+static void test_deferred_erase(void)
+{
+    IR_Store_t store;
+    IR_Store_HAL_t hal = mock_hal(1U, 1U);
+    uint32_t i = 0U;
+
+    reset_memory();
+    IR_store_init(&store, &hal);
+
+    // Fill until a reclaim needs an erase: the service stops and waits
+    while(!IR_store_erase_pending(&store) && i < 2U * store.record_count)
+    {
+        IR_Data_t data = make_data(i);
+        IR_store_put(&store, (uint8_t)(i % IR_STORE_SLOTS), &data);
+        IR_store_flush(&store);
+        i++;
+    }
+    IR_CHECK(IR_store_erase_pending(&store));
+    IR_CHECK(erases == 0U);
+    IR_CHECK(IR_store_service(&store) == 0U);
+    IR_CHECK(erases == 0U);
+
+    IR_store_erase_now(&store);
+    IR_CHECK(erases == 1U);
+    IR_CHECK(!IR_store_erase_pending(&store));
+    drain(&store);
+    IR_CHECK(store.state == IR_STORE_IDLE);
+}
+
+// Interrupt the store after every possible number of byte programs
+static void test_power_cut(uint8_t flash)
+{
+    IR_Store_HAL_t hal = mock_hal(flash, flash);
+    const uint32_t history = 3U * EEPROM_PAGE_COUNT + 2U;
+
+    for(unsigned long cut = 0; cut < 3U * IR_STORE_RECORD_SIZE * IR_STORE_SLOTS; cut++)
+    {
+        IR_Store_t store;
+        uint32_t expected[IR_STORE_SLOTS];
+        uint8_t slot = (uint8_t)(cut % IR_STORE_SLOTS);
+
+        // Slot 0 written once, so the cut can also land in a reclaim copy
+        reset_memory();
+        IR_store_init(&store, &hal);
+        for(uint32_t i = 0; i < history + cut % 5U; i++)
+        {
+            uint8_t put_slot = (i < IR_STORE_SLOTS) ? (uint8_t)i : (uint8_t)(1U + i % (IR_STORE_SLOTS - 1U));
+            IR_Data_t data = make_data(i);
+
+            expected[put_slot] = i;
+            IR_store_put(&store, put_slot, &data);
+            drain(&store);
+        }
+
+        // New value for one slot, with the power lost part way through
+        IR_Data_t data = make_data(0xBEEFU);
+        IR_store_put(&store, slot, &data);
+        program_budget = cut;
+        drain(&store);
+        program_budget = (unsigned long)-1;
+
+        // After the reset: the slot holds the old or the new value, the others are intact
+        IR_CHECK(IR_store_init(&store, &hal) == IR_SUCCESS);
+        drain(&store);
+
+        IR_Data_t got;
+        IR_Data_t old_data = make_data(expected[slot]);
+        IR_CHECK(IR_store_get(&store, slot, &got) == IR_SUCCESS);
+        IR_CHECK(got.raw_data == old_data.raw_data || got.raw_data == data.raw_data);
+        if(got.raw_data == data.raw_data)
+            expected[slot] = 0xBEEFU;
+        check_slots(&store, expected);
+
+        // And the store keeps working
+        for(uint32_t i = 0; i < 2U * EEPROM_PAGE_COUNT; i++)
+        {
+            IR_Data_t next = make_data(i + 100U);
+            expected[i % IR_STORE_SLOTS] = i + 100U;
+            IR_CHECK(IR_store_put(&store, (uint8_t)(i % IR_STORE_SLOTS), &next) == IR_SUCCESS);
+            drain(&store);
+        }
+        check_slots(&store, expected);
+        if(flash)
+            IR_CHECK(flash_violations == 0U);
+    }
+}
+
+int main(void)
+{
+    test_wrap(0U);
+    test_wrap(1U);
+    test_eeprom_wear();
+    test_deferred_erase();
+    test_power_cut(0U);
+    test_power_cut(1U);
+    return IR_test_result("store");
+}
@@ -0,0 +1,150 @@
+/**
+ * test_trace.c - Host Test for the Binary Edge Trace Format
+ *
+ * Header written and checked, records round-tripped at every varint length
+ * boundary and clamped above IR_TRACE_DURATION_MAX, cut-short records
+ * rejected, and a NEC frame encoded as a trace decoding to the same frame
+ * when replayed into the decoder.
+ * Author: Nghia Taarabt
+ */
+
+#include <string.h>
+#include "ir_trace.h"
+#include "ir_decoder.h"
+#include "ir_test.h"
+
+static void test_header(void)
+{
+    uint8_t header[IR_TRACE_HEADER_SIZE];
+    uint32_t unit_ns = 0;
+
+    IR_CHECK(IR_trace_header(header, IR_TRACE_UNIT_US) == IR_TRACE_HEADER_SIZE);
+    IR_CHECK(memcmp(header, IR_TRACE_MAGIC, 4) == 0);
+    IR_CHECK(IR_trace_check_header(header, sizeof(header), &unit_ns) == IR_SUCCESS);
+    IR_CHECK(unit_ns == IR_TRACE_UNIT_US);
+
+    IR_trace_header(header, 0x12345678UL);
+    IR_CHECK(IR_trace_check_header(header, sizeof(header), &unit_ns) == IR_SUCCESS);
+    IR_CHECK(unit_ns == 0x12345678UL);
+
+    IR_CHECK(IR_trace_check_header(header, sizeof(header) - 1U, &unit_ns) == IR_ERROR);
+    header[4] = IR_TRACE_VERSION + 1U;
+    IR_CHECK(IR_trace_check_header(header, sizeof(header), &unit_ns) == IR_ERROR);
+    IR_trace_header(header, 0U);
+    IR_CHECK(IR_trace_check_header(header, sizeof(header), &unit_ns) == IR_ERROR);
+    IR_trace_header(header, IR_TRACE_UNIT_US);
+    header[0] = 'X';
+    IR_CHECK(IR_trace_check_header(header, sizeof(header), &unit_ns) == IR_ERROR);
+}
+
+static void check_record(uint8_t level, uint32_t duration, uint32_t expected, uint8_t expected_length)
+{
+    uint8_t record[IR_TRACE_RECORD_MAX + 1U];
+    const uint8_t* p = record;
+    uint8_t got_level = 0xFFU;
+    uint32_t got_duration = 0;
+    uint8_t length;
+
+    memset(record, 0xAA, sizeof(record));
+    length = IR_trace_encode(record, level, duration);
+    IR_CHECK(length == expected_length);
+    IR_CHECK(record[IR_TRACE_RECORD_MAX] == 0xAAU);
+
+    IR_CHECK(IR_trace_decode(&p, record + length, &got_level, &got_duration) == IR_SUCCESS);
+    IR_CHECK(p == record + length);
+    IR_CHECK(got_level == level);
+    IR_CHECK(got_duration == expected);
+
+    // Any prefix is a record cut short, and leaves the position alone
+    for(uint8_t cut = 0; cut < length; cut++)
+    {
+        p = record;
+        IR_CHECK(IR_trace_decode(&p, record + cut, &got_level, &got_duration) == IR_ERROR);
+        IR_CHECK(p == record);
+    }
+}
+
+static void test_records(void)
+{
+    // (duration << 1 | level) crosses a 7-bit group at each boundary
+    static const uint32_t boundaries[] = { 0x40UL, 0x2000UL, 0x100000UL, 0x8000000UL };
+
+    for(uint8_t level = 0; level < 2U; level++)
+    {
+        check_record(level, 0U, 0U, 1U);
+        for(uint8_t i = 0; i < sizeof(boundaries) / sizeof(boundaries[0]); i++)
+        {
+            check_record(level, boundaries[i] - 1U, boundaries[i] - 1U, (uint8_t)(i + 1U));
+            check_record(level, boundaries[i], boundaries[i], (uint8_t)(i + 2U));
+        }
+        check_record(level, IR_TRACE_DURATION_MAX, IR_TRACE_DURATION_MAX, IR_TRACE_RECORD_MAX);
+        check_record(level, 0xFFFFFFFFUL, IR_TRACE_DURATION_MAX, IR_TRACE_RECORD_MAX);
+    }
+
+    // Any nonzero level is written as IR_HIGH
+    check_record(IR_HIGH, 562U, 562U, 2U);
+    uint8_t record[IR_TRACE_RECORD_MAX];
+    const uint8_t* p = record;
+    uint8_t level = 0U;
+    uint32_t duration = 0U;
+    IR_trace_encode(record, 7U, 562U);
+    IR_CHECK(IR_trace_decode(&p, record + sizeof(record), &level, &duration) == IR_SUCCESS);
+    IR_CHECK(level == IR_HIGH && duration == 562U);
+
+    // A run of continuation bytes longer than any record is rejected
+    memset(record, 0x80, sizeof(record));
+    p = record;
+    IR_CHECK(IR_trace_decode(&p, record + sizeof(record), &level, &duration) == IR_ERROR);
+}
+
+// A NEC frame as a trace stream, replayed the way tools/ir_trace does
+static void test_replay(void)
+{
+    uint8_t stream[IR_TRACE_HEADER_SIZE + 80U * IR_TRACE_RECORD_MAX];
+    uint32_t raw = IR_encode_nec_data(0x04U, 0x08U);
+    uint32_t length = IR_trace_header(stream, IR_TRACE_UNIT_US);
+    uint32_t unit_ns;
+
+    length += IR_trace_encode(&stream[length], IR_HIGH, 100000UL);
+    length += IR_trace_encode(&stream[length], IR_LOW, 9000U);
+    length += IR_trace_encode(&stream[length], IR_HIGH, 4500U);
+    for(uint8_t bit = 0; bit < 32U; bit++)
+    {
+        length += IR_trace_encode(&stream[length], IR_LOW, 562U);
+        length += IR_trace_encode(&stream[length], IR_HIGH, ((raw >> bit) & 1U) ? 1687U : 562U);
+    }
+    length += IR_trace_encode(&stream[length], IR_LOW, 562U);
+    IR_CHECK(length <= sizeof(stream));
+
+    IR_CHECK(IR_trace_check_header(stream, length, &unit_ns) == IR_SUCCESS);
+
+    IR_Decoder_t decoder;
+    IR_HAL_t none;
+    IR_Data_t data;
+    const uint8_t* p = stream + IR_TRACE_HEADER_SIZE;
+    uint8_t level;
+    uint32_t duration;
+    uint32_t edges = 0;
+
+    memset(&none, 0, sizeof(none));
+    IR_decoder_init(&decoder, IR_PROTOCOL_NEC, &none);
+    while(IR_trace_decode(&p, stream + length, &level, &duration) == IR_SUCCESS)
+    {
+        uint32_t us = (uint32_t)((uint64_t)duration * unit_ns / 1000U);
+        IR_decoder_process_duration(&decoder, level, (us > IR_TICKS_MAX_US) ? 0xFFFFU : IR_US_TO_TICKS(us));
+        edges++;
+    }
+    IR_CHECK(p == stream + length);
+    IR_CHECK(edges == 3U + 64U + 1U);
+    IR_CHECK(IR_decoder_get_data(&decoder, &data) == IR_SUCCESS);
+    IR_CHECK(data.raw_data == raw);
+    IR_CHECK(data.address == 0x04U && data.command == 0x08U);
+}
+
+int main(void)
+{
+    test_header();
+    test_records();
+    test_replay();
+    return IR_test_result("trace");
+}